@@ -44,6 +44,7 @@
 
 #include <wiretap/secrets-types.h>
 #include <wiretap/wtap.h>
+#include <wiretap/wtap_index.h>
 
 #include "epan/etypes.h"
 #include "epan/dissectors/packet-ieee80211-radiotap-defs.h"
@@ -62,7 +63,8 @@
 #include <ui/exit_codes.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
-#include <wsutil/wsgcrypt.h>
+#include <wsutil/glib-compat.h>
+#include <wsutil/murmur3.h>
 #include <wsutil/plugins.h>
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
@@ -98,19 +100,42 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * fd_hash[] is a ring holding the last dup_window frames; fd_hash_index
+ * maps a digest and length to the newest of those frames with them, and
+ * each entry links to the next older frame with the same digest and
+ * length, so a frame is only compared with frames that are likely to be
+ * duplicates of it.
  */
 typedef struct _fd_hash_t {
-    guint8     digest[16];
+    guint8     digest[MURMUR3_128_LEN];
     guint32    len;
+    guint32    older;       /* fd_hash[] index of the next older frame with this digest and length */
+    guint64    num;         /* frame number, counting every frame checked; 0 if unused */
     nstime_t   frame_time;
+    guint8    *data;        /* the bytes that were hashed, with --dup-confirm */
+    guint32    data_len;
 } fd_hash_t;
 
+typedef struct {
+    guint32    offset;
+    guint32    length;
+} dup_ignore_range_t;
+
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define DEFAULT_DUP_TIME_DEPTH 1000000 /* window with -w but without -d or -D */
+#define MAX_DUP_DEPTH   100000000   /* the maximum window (and size of fd_hash[]) for de-duplication */
+
+#define WRITE_BUFFER_SIZE (1024*1024) /* size of the output file write buffer */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+static fd_hash_t  *fd_hash;
+static GHashTable *fd_hash_index;
+static int         dup_window    = DEFAULT_DUP_DEPTH;
+static int         cur_dup_entry = 0;
+static guint64     dup_frame_num = 0;
+static gboolean    dup_confirm   = FALSE;  /* Used with --dup-confirm */
+static GArray     *dup_ignore_ranges;      /* Used with --dup-ignore-bytes */
+static GByteArray *dup_scratch;
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
@@ -153,6 +178,7 @@ static struct select_item     selectfrm[MAX_SELECTIONS];
 static guint                  max_selected              = 0;
 static gboolean               keep_em                   = FALSE;
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    out_frame_type            = -2; /* Leave frame type alone */
 static gboolean               verbose                   = FALSE; /* Not so verbose         */
 static struct time_adjustment time_adj                  = {NSTIME_INIT_ZERO, 0}; /* no adjustment */
@@ -169,6 +195,7 @@ static gboolean               dup_detect_by_time        = FALSE;
 static gboolean               skip_radiotap             = FALSE;
 static gboolean               discard_all_secrets       = FALSE;
 static gboolean               discard_cap_comments      = FALSE;
+static gboolean               use_index                 = FALSE;
 
 static int                    do_strict_time_adjustment = FALSE;
 static struct time_adjustment strict_time_adj           = {NSTIME_INIT_ZERO, 0}; /* strict time adjustment */
@@ -342,6 +369,63 @@ selected(guint recno)
     return FALSE;
 }
 
+/* Return the number of the first selected packet after recno, or 0 if
+   there isn't one. */
+
+static guint
+next_selected(guint recno)
+{
+    guint i;
+    guint next = 0;
+    guint candidate;
+
+    for (i = 0; i < max_selected; i++) {
+        if (selectfrm[i].inclusive) {
+            if (selectfrm[i].second <= recno)
+                continue;
+            candidate = selectfrm[i].first > recno ? selectfrm[i].first : recno + 1;
+        } else {
+            if (selectfrm[i].first <= recno)
+                continue;
+            candidate = selectfrm[i].first;
+        }
+        if (next == 0 || candidate < next)
+            next = candidate;
+    }
+
+    return next;
+}
+
+/*
+ * If we have a packet index, skip over the packets before the next
+ * selected one, and the packets before the -A time, if we can, rather
+ * than reading them.
+ */
+static void
+skip_to_next_selected(wtap *wth, wtap_index *pkt_index, guint64 time_first,
+                      guint32 *read_count, unsigned int *count)
+{
+    guint64 next = *read_count + 1;
+    int err;
+
+    if (keep_em && max_selected != 0) {
+        next = next_selected(*read_count);
+        if (next == 0)
+            return;
+    }
+    if (time_first + 1 > next)
+        next = time_first + 1;
+    if (next <= *read_count + 1 || next - 1 >= wtap_index_count(pkt_index))
+        return;
+    if (wtap_index_seek(wth, pkt_index, next - 1, &err)) {
+        *count += (unsigned int)(next - 1 - *read_count);
+        *read_count = (guint32)(next - 1);
+    } else if (err != 0) {
+        fprintf(stderr, "editcap: Can't seek using the packet index: %s\n",
+                wtap_strerror(err));
+    }
+}
+
 static gboolean
 set_time_adjustment(char *optarg_str_p)
 {
@@ -582,10 +666,86 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
+static guint
+fd_hash_hash(gconstpointer key)
+{
+    const fd_hash_t *entry = (const fd_hash_t *)key;
+
+    /* The digest is already a good hash. */
+    return pletoh32(entry->digest) ^ entry->len;
+}
+
 static gboolean
-is_duplicate(guint8* fd, guint32 len) {
+fd_hash_equal(gconstpointer a, gconstpointer b)
+{
+    const fd_hash_t *entry1 = (const fd_hash_t *)a;
+    const fd_hash_t *entry2 = (const fd_hash_t *)b;
+
+    return entry1->len == entry2->len &&
+           memcmp(entry1->digest, entry2->digest, MURMUR3_128_LEN) == 0;
+}
+
+/* The next older frame with the same digest and length, if it's still
+   in fd_hash[] */
+static fd_hash_t *
+fd_hash_older(const fd_hash_t *entry)
+{
+    fd_hash_t *older;
+
+    if (entry->older == G_MAXUINT32)
+        return NULL;
+
+    /*
+     * If the entry has been reused since, it holds a frame newer than
+     * this one.
+     */
+    older = &fd_hash[entry->older];
+    if (older->num == 0 || older->num >= entry->num)
+        return NULL;
+    return older;
+}
+
+static void
+dup_detect_init(void)
+{
+    int window = dup_window > 0 ? dup_window : 1;
+
+    fd_hash = g_new0(fd_hash_t, window);
+    fd_hash_index = g_hash_table_new(fd_hash_hash, fd_hash_equal);
+    cur_dup_entry = 0;
+    dup_frame_num = 0;
+}
+
+static void
+dup_detect_cleanup(void)
+{
+    int window = dup_window > 0 ? dup_window : 1;
     int i;
+
+    if (fd_hash == NULL)
+        return;
+    for (i = 0; i < window; i++)
+        g_free(fd_hash[i].data);
+    g_free(fd_hash);
+    fd_hash = NULL;
+    g_hash_table_destroy(fd_hash_index);
+    fd_hash_index = NULL;
+    if (dup_scratch != NULL) {
+        g_byte_array_free(dup_scratch, TRUE);
+        dup_scratch = NULL;
+    }
+}
+
+/*
+ * Check whether a frame is a duplicate of one of the last dup_window
+ * frames and, if current isn't NULL, was seen no more than
+ * relative_time_window before it, and add it to fd_hash[].
+ */
+static gboolean
+is_duplicate(guint8* fd, guint32 len, const nstime_t *current) {
     const struct ieee80211_radiotap_header* tap_header;
+    int window = dup_window > 0 ? dup_window : 1;
+    fd_hash_t *entry, *newest, *cached;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
@@ -607,140 +767,121 @@ is_duplicate(guint8* fd, guint32 len) {
     new_fd  = &fd[offset];
     new_len = len - (offset);
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    /* Zero out the bytes to be ignored (--dup-ignore-bytes option) */
+    if (dup_ignore_ranges != NULL) {
+        guint i;
 
-    fd_hash[cur_dup_entry].len = len;
+        if (dup_scratch == NULL)
+            dup_scratch = g_byte_array_new();
+        g_byte_array_set_size(dup_scratch, new_len);
+        memcpy(dup_scratch->data, new_fd, new_len);
+        for (i = 0; i < dup_ignore_ranges->len; i++) {
+            const dup_ignore_range_t *range = &g_array_index(dup_ignore_ranges, dup_ignore_range_t, i);
+            guint32 start, end;
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
-
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
+            if (range->offset >= len)
+                continue;
+            start = MAX(range->offset, offset);
+            end = (range->length > len - range->offset) ? len : range->offset + range->length;
+            if (start < end)
+                memset(dup_scratch->data + (start - offset), 0, end - start);
         }
+        new_fd = dup_scratch->data;
     }
 
-    return FALSE;
-}
-
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
-
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
+    cur_dup_entry++;
+    if (cur_dup_entry >= window)
+        cur_dup_entry = 0;
 
-    if (len <= ignored_bytes) {
-        offset = 0;
+    /* Drop the oldest frame */
+    entry = &fd_hash[cur_dup_entry];
+    if (entry->num != 0) {
+        if (g_hash_table_lookup(fd_hash_index, entry) == entry)
+            g_hash_table_remove(fd_hash_index, entry);
+        g_free(entry->data);
+        entry->data = NULL;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
+    /* Calculate our digest */
+    murmur3_x64_128(new_fd, new_len, 0, entry->digest);
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+    entry->len = len;
+    entry->num = ++dup_frame_num;
+    if (current != NULL) {
+        entry->frame_time = *current;
+    } else {
+        nstime_set_unset(&entry->frame_time);
+    }
+    if (dup_confirm) {
+        entry->data = (guint8 *)g_memdup2(new_fd, new_len);
+        entry->data_len = new_len;
+    }
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    newest = (fd_hash_t *)g_hash_table_lookup(fd_hash_index, entry);
+    entry->older = newest != NULL ? (guint32)(newest - fd_hash) : G_MAXUINT32;
+    g_hash_table_replace(fd_hash_index, entry, entry);
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    /* Look for duplicates, from the newest to the oldest */
+    for (cached = newest; cached != NULL; cached = fd_hash_older(cached)) {
+        if (current != NULL) {
+            nstime_t delta;
 
-    /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
-     */
+            if (nstime_is_unset(&cached->frame_time))
+                continue;
 
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
+            nstime_delta(&delta, current, &cached->frame_time);
 
-        if (i < 0)
-            i = dup_window - 1;
+            if (delta.secs < 0 || delta.nsecs < 0) {
+                /*
+                 * A negative delta implies that the current packet
+                 * has an absolute timestamp less than the cached packet
+                 * that it is being compared to.  This is NOT a normal
+                 * situation since trace files usually have packets in
+                 * chronological order (oldest to newest).  Carry on
+                 * with the next older cached frame.
+                 */
+                continue;
+            }
 
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
+            if (nstime_cmp(&delta, &relative_time_window) > 0) {
+                /*
+                 * The delta time indicates that we are now looking at
+                 * cached packets beyond the specified dup time window.
+                 * Check no more!
+                 */
+                break;
+            }
         }
 
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
-            break;
-        }
+        /* Rule out hash collisions (--dup-confirm option) */
+        if (dup_confirm &&
+            (cached->data_len != entry->data_len ||
+             memcmp(cached->data, entry->data, entry->data_len) != 0))
+            continue;
 
-        nstime_delta(&delta, current, &fd_hash[i].frame_time);
+        return TRUE;
+    }
 
-        if (delta.secs < 0 || delta.nsecs < 0) {
-            /*
-             * A negative delta implies that the current packet
-             * has an absolute timestamp less than the cached packet
-             * that it is being compared to.  This is NOT a normal
-             * situation since trace files usually have packets in
-             * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
-             */
-            continue;
-        }
+    return FALSE;
+}
 
-        cmp = nstime_cmp(&delta, &relative_time_window);
+static gboolean
+add_dup_ignore_range(const char *optarg)
+{
+    dup_ignore_range_t range;
+    const char *p;
 
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
-            break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
+    if (!ws_strtou32(optarg, &p, &range.offset) || *p != ':' ||
+        !ws_strtou32(p + 1, NULL, &range.length) || range.length == 0) {
+        fprintf(stderr, "editcap: \"%s\" isn't a valid <offset>:<length>\n\n",
+                optarg);
+        return FALSE;
     }
 
-    return FALSE;
+    if (dup_ignore_ranges == NULL)
+        dup_ignore_ranges = g_array_new(FALSE, FALSE, sizeof(dup_ignore_range_t));
+    g_array_append_val(dup_ignore_ranges, range);
+    return TRUE;
 }
 
 static void
@@ -768,11 +909,22 @@ print_usage(FILE *output)
     fprintf(output, "  -D <dup window>        remove packet if duplicate; configurable <dup window>.\n");
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -v (verbose option) is\n");
-    fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "                         useful to print packet hashes.\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
-    fprintf(output, "                         (e.g. 0.000001).\n");
+    fprintf(output, "                         (e.g. 0.000001). If -d or -D is also given, only\n");
+    fprintf(output, "                         packets within both windows are checked; otherwise\n");
+    fprintf(output, "                         the last %d packets are.\n", DEFAULT_DUP_TIME_DEPTH);
+    fprintf(output, "  --dup-ignore-bytes <offset>:<length>\n");
+    fprintf(output, "                         ignore <length> bytes starting at <offset> in the\n");
+    fprintf(output, "                         frame when checking for duplicates, e.g. the IPv4 TTL\n");
+    fprintf(output, "                         and header checksum with --dup-ignore-bytes 22:1\n");
+    fprintf(output, "                         --dup-ignore-bytes 24:2 for Ether/IP. Can be used\n");
+    fprintf(output, "                         more than once.\n");
+    fprintf(output, "  --dup-confirm          compare the bytes of packets with the same hash when\n");
+    fprintf(output, "                         checking for duplicates, rather than relying on the\n");
+    fprintf(output, "                         hash alone.\n");
     fprintf(output, "           NOTE: The use of the 'Duplicate packet removal' options with\n");
     fprintf(output, "           other editcap options except -v may not always work as expected.\n");
     fprintf(output, "           Specifically the -r, -t or -S options will very likely NOT have the\n");
@@ -813,7 +965,7 @@ print_usage(FILE *output)
     fprintf(output, "                         the pseudo-random number generator. This allows one to\n");
     fprintf(output, "                         repeat a particular sequence of errors.\n");
     fprintf(output, "  -I <bytes to ignore>   ignore the specified number of bytes at the beginning\n");
-    fprintf(output, "                         of the frame during MD5 hash calculation, unless the\n");
+    fprintf(output, "                         of the frame during hash calculation, unless the\n");
     fprintf(output, "                         frame is too short, then the full frame is used.\n");
     fprintf(output, "                         Useful to remove duplicated packets taken on\n");
     fprintf(output, "                         several routers (different mac addresses for\n");
@@ -834,6 +986,13 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file(s) with <type>: gzip, zstd,\n");
+    fprintf(output, "                         or lz4, if supported.  zstd and lz4 output is written\n");
+    fprintf(output, "                         as independent frames with a seek table, for faster\n");
+    fprintf(output, "                         random access.\n");
+    fprintf(output, "  --use-index            use the packet index <infile>.idx, if it's up to date,\n");
+    fprintf(output, "                         to skip over packets that aren't selected, or write\n");
+    fprintf(output, "                         one while reading <infile> if it isn't.\n");
     fprintf(output, "  --inject-secrets <type>,<file>  Insert decryption secrets from <file>. List\n");
     fprintf(output, "                         supported secret types with \"--inject-secrets help\".\n");
     fprintf(output, "  --discard-all-secrets  Discard all decryption secrets from the input file\n");
@@ -853,7 +1012,7 @@ print_usage(FILE *output)
     fprintf(output, "  -v                     verbose output.\n");
     fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
     fprintf(output, "                         Removal' options (-d, -D or -w) then Packet lengths\n");
-    fprintf(output, "                         and MD5 hashes are printed to standard-error.\n");
+    fprintf(output, "                         and packet hashes are printed to standard-error.\n");
     fprintf(output, "  -V, --version          print version information and exit.\n");
 }
 
@@ -989,15 +1148,18 @@ editcap_dump_open(const char *filename, const wtap_dump_params *params,
 
     if (strcmp(filename, "-") == 0) {
         /* Write to the standard output. */
-        pdh = wtap_dump_open_stdout(out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open_stdout(out_file_type_subtype, out_compression_type,
                                     params, err, err_info);
     } else {
-        pdh = wtap_dump_open(filename, out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open(filename, out_file_type_subtype, out_compression_type,
                              params, err, err_info);
     }
     if (pdh == NULL)
         return NULL;
 
+    /* Write packets out in large pieces. */
+    wtap_dump_set_write_buffer(pdh, WRITE_BUFFER_SIZE, 0);
+
     /*
      * If the output file supporst identifying the interfaces on which
      * packets arrive, add all the IDBs we've seen so far.
@@ -1140,6 +1302,10 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_ALL_SECRETS  LONGOPT_BASE_APPLICATION+5
 #define LONGOPT_CAPTURE_COMMENT      LONGOPT_BASE_APPLICATION+6
 #define LONGOPT_DISCARD_CAPTURE_COMMENT LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_COMPRESS             LONGOPT_BASE_APPLICATION+8
+#define LONGOPT_USE_INDEX            LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_DUP_IGNORE_BYTES     LONGOPT_BASE_APPLICATION+10
+#define LONGOPT_DUP_CONFIRM          LONGOPT_BASE_APPLICATION+11
 
     static const struct option long_options[] = {
         {"novlan", no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1151,6 +1317,10 @@ main(int argc, char *argv[])
         {"version", no_argument, NULL, 'V'},
         {"capture-comment", required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
         {"discard-capture-comment", no_argument, NULL, LONGOPT_DISCARD_CAPTURE_COMMENT},
+        {"compress", required_argument, NULL, LONGOPT_COMPRESS},
+        {"use-index", no_argument, NULL, LONGOPT_USE_INDEX},
+        {"dup-ignore-bytes", required_argument, NULL, LONGOPT_DUP_IGNORE_BYTES},
+        {"dup-confirm", no_argument, NULL, LONGOPT_DUP_CONFIRM},
         {0, 0, 0, 0 }
     };
 
@@ -1190,6 +1360,11 @@ main(int argc, char *argv[])
     int                          ret = EXIT_SUCCESS;
     gboolean                     valid_seed = FALSE;
     unsigned int                 seed = 0;
+    wtap_index                  *pkt_index = NULL;
+    wtap_index_writer           *index_writer = NULL;
+    int                          index_err;
+    guint64                      time_first = 0;
+    guint64                      time_end = G_MAXUINT64;
 
     cmdarg_err_init(editcap_cmdarg_err, editcap_cmdarg_err_cont);
     memset(&read_rec, 0, sizeof *rec);
@@ -1312,6 +1487,40 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS:
+        {
+            out_compression_type = wtap_name_to_compression_type(ws_optarg);
+            if (out_compression_type == WTAP_UNKNOWN_COMPRESSION ||
+                !wtap_can_write_compression_type(out_compression_type)) {
+                fprintf(stderr, "editcap: \"%s\" isn't a supported compression type\n",
+                        ws_optarg);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
+        case LONGOPT_USE_INDEX:
+        {
+            use_index = TRUE;
+            break;
+        }
+
+        case LONGOPT_DUP_IGNORE_BYTES:
+        {
+            if (!add_dup_ignore_range(ws_optarg)) {
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
+        case LONGOPT_DUP_CONFIRM:
+        {
+            dup_confirm = TRUE;
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1401,13 +1610,11 @@ main(int argc, char *argv[])
 
         case 'd':
             dup_detect = TRUE;
-            dup_detect_by_time = FALSE;
             dup_window = DEFAULT_DUP_DEPTH;
             break;
 
         case 'D':
             dup_detect = TRUE;
-            dup_detect_by_time = FALSE;
             dup_window = get_guint32(ws_optarg, "duplicate window");
             if (dup_window > MAX_DUP_DEPTH) {
                 fprintf(stderr, "editcap: \"%d\" duplicate window value must be between 0 and %d inclusive.\n",
@@ -1526,9 +1733,7 @@ main(int argc, char *argv[])
             break;
 
         case 'w':
-            dup_detect = FALSE;
             dup_detect_by_time = TRUE;
-            dup_window = MAX_DUP_DEPTH;
             if (!set_rel_time(ws_optarg)) {
                 ret = INVALID_OPTION;
                 goto clean_exit;
@@ -1737,35 +1942,78 @@ main(int argc, char *argv[])
         max_packet_number = G_MAXUINT;
 
     if (dup_detect || dup_detect_by_time) {
-        for (i = 0; i < dup_window; i++) {
-            memset(&fd_hash[i].digest, 0, 16);
-            fd_hash[i].len = 0;
-            nstime_set_unset(&fd_hash[i].frame_time);
-        }
+        /* With just a time window, look back a long way. */
+        if (!dup_detect)
+            dup_window = DEFAULT_DUP_TIME_DEPTH;
+        dup_detect_init();
     }
 
     /* Set up an array of all IDBs seen */
     idbs_seen = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
+    if (use_index) {
+        pkt_index = wtap_index_open(wth);
+        if (pkt_index == NULL) {
+            index_writer = wtap_index_writer_new(wth, &index_err);
+            if (index_writer == NULL) {
+                fprintf(stderr, "editcap: Can't write a packet index for \"%s\": %s\n",
+                        argv[ws_optind], wtap_strerror(index_err));
+            }
+        } else if ((!(keep_em && max_selected != 0) && !check_startstop) ||
+                   dup_detect || dup_detect_by_time ||
+                   !nstime_is_unset(&secs_per_block)) {
+            /*
+             * We can only skip packets if we're keeping the selected
+             * ones, or the ones in a time range, and nothing we do
+             * depends on the packets before them.
+             */
+            wtap_index_close(pkt_index);
+            pkt_index = NULL;
+        } else if (check_startstop &&
+                   !wtap_index_find_time_range(pkt_index,
+                                               have_starttime ? &starttime : NULL,
+                                               have_stoptime ? &stoptime : NULL,
+                                               &time_first, &time_end)) {
+            time_first = 0;
+            time_end = G_MAXUINT64;
+        }
+    }
+
     /* Read all of the packets in turn */
     wtap_rec_init(&read_rec);
     ws_buffer_init(&read_buf, 1514);
+    if (pkt_index != NULL)
+        skip_to_next_selected(wth, pkt_index, time_first, &read_count, &count);
     while (wtap_read(wth, &read_rec, &read_buf, &read_err, &read_err_info, &data_offset)) {
+        if (index_writer != NULL &&
+            !wtap_index_writer_add(index_writer, wth, data_offset, &read_rec, &index_err)) {
+            fprintf(stderr, "editcap: Can't write a packet index for \"%s\": %s\n",
+                    argv[ws_optind], wtap_strerror(index_err));
+            wtap_index_writer_close(index_writer, FALSE, &index_err);
+            index_writer = NULL;
+        }
+
         /*
          * XXX - what about non-packet records in the file after this?
          * We can *probably* ignore IDBs after this point, as they
          * presumably indicate that we weren't capturing on that
          * interface at this point, but what about, for example, NRBs?
          */
-        if (max_packet_number <= read_count)
+        if (max_packet_number <= read_count || time_end <= read_count) {
+            if (index_writer != NULL) {
+                /* Keep reading, just to index the rest of the file. */
+                wtap_rec_reset(&read_rec);
+                continue;
+            }
             break;
+        }
 
         read_count++;
 
         rec = &read_rec;
 
-        /* Extra actions for the first packet */
-        if (read_count == 1) {
+        /* Extra actions for the first packet we process */
+        if (pdh == NULL) {
             if (split_packet_count != 0 || !nstime_is_unset(&secs_per_block)) {
                 if (!fileset_extract_prefix_suffix(argv[ws_optind+1], &fprefix, &fsuffix)) {
                     ret = CANT_EXTRACT_PREFIX;
@@ -2054,14 +2302,21 @@ main(int argc, char *argv[])
                     rec = &temp_rec;
                 }
 
-                /* suppress duplicates by packet window */
-                if (dup_detect) {
-                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
+                /* suppress duplicates by packet and/or time window */
+                if (dup_detect ||
+                    (dup_detect_by_time && (rec->presence_flags & WTAP_HAS_TS))) {
+                    const nstime_t *current = NULL;
+
+                    if (dup_detect_by_time && (rec->presence_flags & WTAP_HAS_TS))
+                        current = &rec->ts;
+
+                    if (is_duplicate(buf, rec->rec_header.packet_header.caplen,
+                                     current)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Skipped: %u, Len: %u, Hash: ",
                                     count,
                                     rec->rec_header.packet_header.caplen);
-                            for (i = 0; i < 16; i++)
+                            for (i = 0; i < MURMUR3_128_LEN; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                             fprintf(stderr, "\n");
@@ -2071,53 +2326,16 @@ main(int argc, char *argv[])
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Packet: %u, Len: %u, Hash: ",
                                     count,
                                     rec->rec_header.packet_header.caplen);
-                            for (i = 0; i < 16; i++)
+                            for (i = 0; i < MURMUR3_128_LEN; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                             fprintf(stderr, "\n");
                         }
                     }
                 } /* suppression of duplicates */
-
-                if (rec->presence_flags & WTAP_HAS_TS) {
-                    /* suppress duplicates by time window */
-                    if (dup_detect_by_time) {
-                        nstime_t current;
-
-                        current.secs  = rec->ts.secs;
-                        current.nsecs = rec->ts.nsecs;
-
-                        if (is_duplicate_rel_time(buf,
-                                                  rec->rec_header.packet_header.caplen,
-                                                  &current)) {
-                            if (verbose) {
-                                fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
-                                        count,
-                                        rec->rec_header.packet_header.caplen);
-                                for (i = 0; i < 16; i++)
-                                    fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                                fprintf(stderr, "\n");
-                            }
-                            duplicate_count++;
-                            count++;
-                            continue;
-                        } else {
-                            if (verbose) {
-                                fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
-                                        count,
-                                        rec->rec_header.packet_header.caplen);
-                                for (i = 0; i < 16; i++)
-                                    fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
-                                fprintf(stderr, "\n");
-                            }
-                        }
-                    }
-                } /* suppress duplicates by time window */
             }
 
             /* Random error mutation */
@@ -2255,10 +2473,21 @@ main(int argc, char *argv[])
         }
         count++;
         wtap_rec_reset(&read_rec);
+        if (pkt_index != NULL)
+            skip_to_next_selected(wth, pkt_index, time_first, &read_count, &count);
     }
     wtap_rec_cleanup(&read_rec);
     ws_buffer_free(&read_buf);
 
+    if (index_writer != NULL) {
+        /* Only keep the index if we read the whole file. */
+        if (!wtap_index_writer_close(index_writer, read_err == 0, &index_err)) {
+            fprintf(stderr, "editcap: Can't write a packet index for \"%s\": %s\n",
+                    argv[ws_optind], wtap_strerror(index_err));
+        }
+        index_writer = NULL;
+    }
+
     g_free(fprefix);
     g_free(fsuffix);
 
@@ -2296,7 +2525,13 @@ main(int argc, char *argv[])
         g_tree_destroy(frames_user_comments);
     }
 
-    if (dup_detect) {
+    if (dup_detect && dup_detect_by_time) {
+        fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate window of %i packets and time window equal to or less than %ld.%09ld seconds.\n",
+                count - 1, plurality(count - 1, "", "s"), duplicate_count,
+                plurality(duplicate_count, "", "s"), dup_window,
+                (long)relative_time_window.secs,
+                (long int)relative_time_window.nsecs);
+    } else if (dup_detect) {
         fprintf(stderr, "%u packet%s seen, %u packet%s skipped with duplicate window of %i packets.\n",
                 count - 1, plurality(count - 1, "", "s"), duplicate_count,
                 plurality(duplicate_count, "", "s"), dup_window);
@@ -2309,6 +2544,9 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    dup_detect_cleanup();
+    if (dup_ignore_ranges != NULL)
+        g_array_free(dup_ignore_ranges, TRUE);
     if (dsb_filenames) {
         g_array_free(dsb_types, TRUE);
         g_ptr_array_free(dsb_filenames, TRUE);
@@ -2322,6 +2560,10 @@ clean_exit:
     }
     g_free(params.idb_inf);
     wtap_dump_params_cleanup(&params);
+    if (index_writer != NULL)
+        wtap_index_writer_close(index_writer, FALSE, &index_err);
+    if (pkt_index != NULL)
+        wtap_index_close(pkt_index);
     if (wth != NULL)
         wtap_close(wth);
     wtap_rec_reset(&read_rec);
@@ -65,6 +65,34 @@ static wmem_map_t *conversation_hashtable_no_addr2_or_port2 = NULL;
 
 static guint32 new_index;
 
+/*
+ * Incremented whenever a conversation is added to or removed from one of
+ * the hash tables, which is the only way the result of a lookup can change.
+ */
+static guint64 conversation_generation;
+
+/*
+ * The most recent find_conversation() lookup between two IPv4 or two IPv6
+ * addresses, and its result.  Dissectors at several layers usually look up
+ * the same conversation for each packet, so this saves doing the hash table
+ * lookups all over again.  The addresses are held inline so that the entry
+ * doesn't depend on the lifetime of the caller's address data.
+ */
+typedef struct {
+	guint64 generation;	/* conversation_generation when filled in */
+	guint32 frame_num;
+	address_type addr_type;	/* AT_NONE if the entry is unused */
+	guint8 addr_a[16];
+	guint8 addr_b[16];
+	endpoint_type etype;
+	guint32 port_a;
+	guint32 port_b;
+	guint options;
+	conversation_t *conversation;
+} conversation_lookup_cache_t;
+
+static conversation_lookup_cache_t last_lookup;
+
 /*
  * Placeholder for address-less conversations.
  */
@@ -175,25 +203,42 @@ conversation_create_from_template(conversation_t *conversation, const address *a
  * (formerly at http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing)
  * One-at-a-Time hash
  */
+/*
+ * The exact table holds most conversations and is searched for nearly every
+ * packet, so it mixes in the address data a 32-bit word at a time rather
+ * than a byte at a time.
+ */
+static inline guint
+add_address_words_to_hash(guint hash_val, const address *addr)
+{
+	const guint8 *hash_data = (const guint8 *)addr->data;
+	guint32 word;
+	int idx;
+
+	for (idx = 0; idx + 4 <= addr->len; idx += 4) {
+		memcpy(&word, hash_data + idx, sizeof word);
+		hash_val = (hash_val ^ word) * 0x9E3779B1U;
+		hash_val ^= ( hash_val >> 15 );
+	}
+	for (; idx < addr->len; idx++) {
+		hash_val = (hash_val ^ hash_data[idx]) * 0x9E3779B1U;
+	}
+	return hash_val;
+}
+
 guint
 conversation_hash_exact(gconstpointer v)
 {
 	const conversation_key_t key = (const conversation_key_t)v;
 	guint hash_val;
-	address tmp_addr;
 
 	hash_val = 0;
-	tmp_addr.len  = 4;
-
-	hash_val = add_address_to_hash(hash_val, &key->addr1);
-
-	tmp_addr.data = &key->port1;
-	hash_val = add_address_to_hash(hash_val, &tmp_addr);
 
-	hash_val = add_address_to_hash(hash_val, &key->addr2);
+	hash_val = add_address_words_to_hash(hash_val, &key->addr1);
+	hash_val = (hash_val ^ key->port1) * 0x9E3779B1U;
 
-	tmp_addr.data = &key->port2;
-	hash_val = add_address_to_hash(hash_val, &tmp_addr);
+	hash_val = add_address_words_to_hash(hash_val, &key->addr2);
+	hash_val = (hash_val ^ key->port2) * 0x9E3779B1U;
 
 	hash_val += ( hash_val << 3 );
 	hash_val ^= ( hash_val >> 11 );
@@ -470,6 +515,7 @@ conversation_init(void)
 	    wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_no_addr2_or_port2,
 	      conversation_match_no_addr2_or_port2);
 
+	conversation_generation++;
 }
 
 /**
@@ -481,6 +527,11 @@ void conversation_epan_reset(void)
 	 * Start the conversation indices over at 0.
 	 */
 	new_index = 0;
+
+	/*
+	 * The conversations are freed along with the file scope.
+	 */
+	conversation_generation++;
 }
 
 /*
@@ -494,6 +545,8 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *chain_tail, *cur, *prev;
 
+	conversation_generation++;
+
 	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
 	if (NULL==chain_head) {
@@ -550,6 +603,8 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *cur, *prev;
 
+	conversation_generation++;
+
 	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
 	if (conv == chain_head) {
@@ -893,6 +948,52 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 }
 
 
+/*
+ * Can the result of this lookup be kept in last_lookup?
+ */
+static inline gboolean
+conversation_lookup_cacheable(const address *addr_a, const address *addr_b)
+{
+	return addr_b != NULL && addr_a->type == addr_b->type &&
+	    ((addr_a->type == AT_IPv4 && addr_a->len == 4 && addr_b->len == 4) ||
+	     (addr_a->type == AT_IPv6 && addr_a->len == 16 && addr_b->len == 16));
+}
+
+static inline gboolean
+conversation_lookup_cache_hit(const guint32 frame_num, const address *addr_a, const address *addr_b, const endpoint_type etype,
+    const guint32 port_a, const guint32 port_b, const guint options)
+{
+	return last_lookup.addr_type == addr_a->type &&
+	    last_lookup.generation == conversation_generation &&
+	    last_lookup.frame_num == frame_num &&
+	    last_lookup.port_a == port_a &&
+	    last_lookup.port_b == port_b &&
+	    last_lookup.etype == etype &&
+	    last_lookup.options == options &&
+	    memcmp(last_lookup.addr_a, addr_a->data, addr_a->len) == 0 &&
+	    memcmp(last_lookup.addr_b, addr_b->data, addr_b->len) == 0;
+}
+
+static void
+conversation_lookup_cache_fill(const guint32 frame_num, const address *addr_a, const address *addr_b, const endpoint_type etype,
+    const guint32 port_a, const guint32 port_b, const guint options, conversation_t *conversation)
+{
+	last_lookup.generation = conversation_generation;
+	last_lookup.frame_num = frame_num;
+	last_lookup.addr_type = addr_a->type;
+	memcpy(last_lookup.addr_a, addr_a->data, addr_a->len);
+	memcpy(last_lookup.addr_b, addr_b->data, addr_b->len);
+	last_lookup.etype = etype;
+	last_lookup.port_a = port_a;
+	last_lookup.port_b = port_b;
+	last_lookup.options = options;
+	last_lookup.conversation = conversation;
+}
+
+static conversation_t *
+find_conversation_uncached(const guint32 frame_num, const address *addr_a, const address *addr_b, const endpoint_type etype,
+    const guint32 port_a, const guint32 port_b, const guint options);
+
 /*
  * Given two address/port pairs for a packet, search for a conversation
  * containing packets between those address/port pairs.  Returns NULL if
@@ -935,6 +1036,36 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 {
 	conversation_t *conversation;
 
+	/*
+	 * TCP and UDP over IP look up the same conversation several times
+	 * for each packet; if this is a repeat of the last such lookup,
+	 * and no conversations have been added or changed since, the
+	 * answer is the same as last time.
+	 */
+	if (!conversation_lookup_cacheable(addr_a, addr_b)) {
+		return find_conversation_uncached(frame_num, addr_a, addr_b, etype,
+		    port_a, port_b, options);
+	}
+
+	if (conversation_lookup_cache_hit(frame_num, addr_a, addr_b, etype,
+	    port_a, port_b, options)) {
+		return last_lookup.conversation;
+	}
+
+	conversation = find_conversation_uncached(frame_num, addr_a, addr_b, etype,
+	    port_a, port_b, options);
+	conversation_lookup_cache_fill(frame_num, addr_a, addr_b, etype,
+	    port_a, port_b, options, conversation);
+
+	return conversation;
+}
+
+static conversation_t *
+find_conversation_uncached(const guint32 frame_num, const address *addr_a, const address *addr_b, const endpoint_type etype,
+    const guint32 port_a, const guint32 port_b, const guint options)
+{
+	conversation_t *conversation;
+
 	DINSTR(gchar *addr_a_str = address_to_str(NULL, addr_a));
 	DINSTR(gchar *addr_b_str = address_to_str(NULL, addr_b));
 	/*
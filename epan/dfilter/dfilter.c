@@ -438,6 +438,156 @@ dfilter_deprecated_tokens(dfilter_t *df) {
 	return NULL;
 }
 
+/* Is the field one of the given time fields? */
+static gboolean
+is_time_field(const header_field_info *hfinfo, const char * const *fields)
+{
+	for (; *fields != NULL; fields++) {
+		if (strcmp(hfinfo->abbrev, *fields) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Is the register loaded from the protocol tree? */
+static gboolean
+is_field_register(const dfilter_t *df, guint32 reg)
+{
+	dfvm_insn_t *insn;
+	guint i;
+
+	for (i = 0; i < df->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		if (insn->op == READ_TREE && insn->arg2->value.numeric == reg)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Get the time constant in a register, if that's what it holds. */
+static gboolean
+get_time_const(const dfilter_t *df, guint32 reg, nstime_t *t)
+{
+	dfvm_insn_t *insn;
+	fvalue_t *fv;
+	guint i;
+
+	for (i = 0; i < df->consts->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+		if (insn->op != PUT_FVALUE || insn->arg2->value.numeric != reg)
+			continue;
+		fv = insn->arg1->value.fvalue;
+		switch (fvalue_type_ftenum(fv)) {
+			case FT_ABSOLUTE_TIME:
+			case FT_RELATIVE_TIME:
+				*t = *(const nstime_t *)fvalue_get(fv);
+				return TRUE;
+			default:
+				return FALSE;
+		}
+	}
+	return FALSE;
+}
+
+/* The time one nanosecond after t. */
+static void
+nstime_next(nstime_t *t)
+{
+	if (t->nsecs < 999999999) {
+		t->nsecs++;
+	} else {
+		t->secs++;
+		t->nsecs = 0;
+	}
+}
+
+gboolean
+dfilter_get_time_range(const dfilter_t *df, const char * const *fields,
+		nstime_t *start, nstime_t *stop)
+{
+	dfvm_insn_t *insn;
+	dfvm_opcode_t op;
+	guint32 reg1, reg2;
+	nstime_t t;
+	guint i, last;
+
+	nstime_set_unset(start);
+	nstime_set_unset(stop);
+	if (df == NULL || df->insns->len == 0)
+		return FALSE;
+	last = df->insns->len - 1;
+
+	/*
+	 * A conjunction of relations between fields and constants is
+	 * compiled to a straight run of field loads and comparisons,
+	 * where every failed load or comparison jumps to the final
+	 * RETURN; anything else, such as an "or", a "not", a function
+	 * or a slice, makes the filter something we don't handle.
+	 */
+	for (i = 0; i <= last; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		switch (insn->op) {
+			case READ_TREE:
+				if (!is_time_field(insn->arg1->value.hfinfo, fields))
+					return FALSE;
+				break;
+
+			case IF_FALSE_GOTO:
+				if (insn->arg1->value.numeric != last)
+					return FALSE;
+				break;
+
+			case RETURN:
+				if (i != last)
+					return FALSE;
+				break;
+
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+				op = insn->op;
+				reg1 = insn->arg1->value.numeric;
+				reg2 = insn->arg2->value.numeric;
+				if (is_field_register(df, reg1) && get_time_const(df, reg2, &t)) {
+					/* field op time */
+				} else if (is_field_register(df, reg2) && get_time_const(df, reg1, &t)) {
+					/* time op field; turn it around */
+					switch (op) {
+						case ANY_GT: op = ANY_LT; break;
+						case ANY_GE: op = ANY_LE; break;
+						case ANY_LT: op = ANY_GT; break;
+						default:     op = ANY_GE; break;
+					}
+				} else {
+					return FALSE;
+				}
+
+				switch (op) {
+					case ANY_GT:
+						nstime_next(&t);
+						/* FALL THROUGH */
+					case ANY_GE:
+						if (nstime_is_unset(start) || nstime_cmp(&t, start) > 0)
+							*start = t;
+						break;
+					case ANY_LE:
+						nstime_next(&t);
+						/* FALL THROUGH */
+					default:
+						if (nstime_is_unset(stop) || nstime_cmp(&t, stop) < 0)
+							*stop = t;
+						break;
+				}
+				break;
+
+			default:
+				return FALSE;
+		}
+	}
+	return !nstime_is_unset(start) || !nstime_is_unset(stop);
+}
+
 void
 dfilter_dump(dfilter_t *df)
 {
@@ -76,6 +76,21 @@ WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
 
+/* If the filter does nothing but compare one or more of the given
+ * time fields with constant times, joined with "and", get the range of
+ * times it selects: [*start, *stop), with *start or *stop unset if the
+ * range has no lower or upper bound.  The fields must be absolute or
+ * relative time fields that all have the same, single, value in any
+ * packet that has them, and packets without them don't match the
+ * filter.
+ *
+ * Returns TRUE if the filter has that form, FALSE otherwise.
+ */
+WS_DLL_PUBLIC
+gboolean
+dfilter_get_time_range(const dfilter_t *df, const char * const *fields,
+		nstime_t *start, nstime_t *stop);
+
 /* Print bytecode of dfilter to stdout */
 WS_DLL_PUBLIC
 void
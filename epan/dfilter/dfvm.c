@@ -126,6 +126,17 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_LT:
 			case ANY_LE:
 			case ANY_BITWISE_AND:
+			case ANY_EQ_INT32:
+			case ANY_NE_INT32:
+			case ANY_GT_UINT32:
+			case ANY_GT_SINT32:
+			case ANY_GE_UINT32:
+			case ANY_GE_SINT32:
+			case ANY_LT_UINT32:
+			case ANY_LT_SINT32:
+			case ANY_LE_UINT32:
+			case ANY_LE_SINT32:
+			case ANY_BITWISE_AND_INT32:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
@@ -258,6 +269,61 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_EQ_INT32:
+				fprintf(f, "%05d ANY_EQ_INT32\treg#%u == reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_NE_INT32:
+				fprintf(f, "%05d ANY_NE_INT32\treg#%u != reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_UINT32:
+				fprintf(f, "%05d ANY_GT_UINT32\treg#%u > reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_SINT32:
+				fprintf(f, "%05d ANY_GT_SINT32\treg#%u > reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_UINT32:
+				fprintf(f, "%05d ANY_GE_UINT32\treg#%u >= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_SINT32:
+				fprintf(f, "%05d ANY_GE_SINT32\treg#%u >= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_UINT32:
+				fprintf(f, "%05d ANY_LT_UINT32\treg#%u < reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_SINT32:
+				fprintf(f, "%05d ANY_LT_SINT32\treg#%u < reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_UINT32:
+				fprintf(f, "%05d ANY_LE_UINT32\treg#%u <= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_SINT32:
+				fprintf(f, "%05d ANY_LE_SINT32\treg#%u <= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_BITWISE_AND_INT32:
+				fprintf(f, "%05d ANY_BITWISE_AND_INT32\treg#%u & reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
 			case ANY_CONTAINS:
 				fprintf(f, "%05d ANY_CONTAINS\treg#%u contains reg#%u\n",
 					id, arg1->value.numeric, arg2->value.numeric);
@@ -394,6 +460,45 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 	return FALSE;
 }
 
+/*
+ * Integer fields are by far the most common operands of comparisons,
+ * and for those the generic fvalue_*() functions just compare one member
+ * of the value union through the ftype's function pointers.  gencode
+ * uses these instructions instead when both registers are known to hold
+ * values of the same 32-bit integer type, so they compare the members
+ * inline.
+ */
+#define ANY_TEST_INT32(name, test) \
+static gboolean \
+name(dfilter_t *df, int reg1, int reg2) \
+{ \
+	GList	*list_a, *list_b; \
+	const fvalue_t *a, *b; \
+\
+	for (list_a = df->registers[reg1]; list_a; list_a = g_list_next(list_a)) { \
+		a = (const fvalue_t *)list_a->data; \
+		for (list_b = df->registers[reg2]; list_b; list_b = g_list_next(list_b)) { \
+			b = (const fvalue_t *)list_b->data; \
+			if (test) { \
+				return TRUE; \
+			} \
+		} \
+	} \
+	return FALSE; \
+}
+
+ANY_TEST_INT32(any_eq_int32, a->value.uinteger == b->value.uinteger)
+ANY_TEST_INT32(any_ne_int32, a->value.uinteger != b->value.uinteger)
+ANY_TEST_INT32(any_gt_uint32, a->value.uinteger > b->value.uinteger)
+ANY_TEST_INT32(any_gt_sint32, a->value.sinteger > b->value.sinteger)
+ANY_TEST_INT32(any_ge_uint32, a->value.uinteger >= b->value.uinteger)
+ANY_TEST_INT32(any_ge_sint32, a->value.sinteger >= b->value.sinteger)
+ANY_TEST_INT32(any_lt_uint32, a->value.uinteger < b->value.uinteger)
+ANY_TEST_INT32(any_lt_sint32, a->value.sinteger < b->value.sinteger)
+ANY_TEST_INT32(any_le_uint32, a->value.uinteger <= b->value.uinteger)
+ANY_TEST_INT32(any_le_sint32, a->value.sinteger <= b->value.sinteger)
+ANY_TEST_INT32(any_bitwise_and_int32, (a->value.uinteger & b->value.uinteger) != 0)
+
 static gboolean
 any_matches(dfilter_t *df, int reg1, int reg2)
 {
@@ -508,6 +613,7 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
+	dfvm_insn_t	**insns;
 	dfvm_insn_t	*insn;
 	dfvm_value_t	*arg1;
 	dfvm_value_t	*arg2;
@@ -519,12 +625,13 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 	ws_assert(tree);
 
+	insns = (dfvm_insn_t **)df->insns->pdata;
 	length = df->insns->len;
 
 	for (id = 0; id < length; id++) {
 
 	  AGAIN:
-		insn = (dfvm_insn_t	*)g_ptr_array_index(df->insns, id);
+		insn = insns[id];
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
 
@@ -607,6 +714,61 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_EQ_INT32:
+				accum = any_eq_int32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_NE_INT32:
+				accum = any_ne_int32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_UINT32:
+				accum = any_gt_uint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_SINT32:
+				accum = any_gt_sint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_UINT32:
+				accum = any_ge_uint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_SINT32:
+				accum = any_ge_sint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_UINT32:
+				accum = any_lt_uint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_SINT32:
+				accum = any_lt_sint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_UINT32:
+				accum = any_le_uint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_SINT32:
+				accum = any_le_sint32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_BITWISE_AND_INT32:
+				accum = any_bitwise_and_int32(df,
+						arg1->value.numeric, arg2->value.numeric);
+				break;
+
 			case ANY_CONTAINS:
 				accum = any_test(df, fvalue_contains,
 						arg1->value.numeric, arg2->value.numeric);
@@ -708,6 +870,17 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_LT:
 			case ANY_LE:
 			case ANY_BITWISE_AND:
+			case ANY_EQ_INT32:
+			case ANY_NE_INT32:
+			case ANY_GT_UINT32:
+			case ANY_GT_SINT32:
+			case ANY_GE_UINT32:
+			case ANY_GE_SINT32:
+			case ANY_LT_UINT32:
+			case ANY_LT_SINT32:
+			case ANY_LE_UINT32:
+			case ANY_LE_SINT32:
+			case ANY_BITWISE_AND_INT32:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
@@ -59,6 +59,17 @@ typedef enum {
 	ANY_LT,
 	ANY_LE,
 	ANY_BITWISE_AND,
+	ANY_EQ_INT32,
+	ANY_NE_INT32,
+	ANY_GT_UINT32,
+	ANY_GT_SINT32,
+	ANY_GE_UINT32,
+	ANY_GE_SINT32,
+	ANY_LT_UINT32,
+	ANY_LT_SINT32,
+	ANY_LE_UINT32,
+	ANY_LE_SINT32,
+	ANY_BITWISE_AND_INT32,
 	ANY_CONTAINS,
 	ANY_MATCHES,
 	MK_RANGE,
@@ -254,6 +254,110 @@ dfw_append_put_pcre(dfwork_t *dfw, GRegex *pcre)
 }
 
 
+/*
+ * Integer fields are by far the most common operands of comparisons.
+ * If both operands are known to hold values of the same 32-bit integer
+ * type, use an instruction that compares them inline rather than
+ * through the ftype's function pointers.
+ */
+typedef enum {
+	INT32_NONE,
+	INT32_UNSIGNED,
+	INT32_SIGNED
+} int32_class_t;
+
+/* Returns the ftype of all the values of an operand, or FT_NONE if
+ * that isn't known when the filter is compiled. */
+static ftenum_t
+entity_ftype(stnode_t *st_arg)
+{
+	header_field_info *hfinfo;
+	ftenum_t	ftype;
+
+	switch (stnode_type_id(st_arg)) {
+		case STTYPE_FIELD:
+			hfinfo = (header_field_info*)stnode_data(st_arg);
+
+			/* Rewind to find the first field of this name. */
+			while (hfinfo->same_name_prev_id != -1) {
+				hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+			}
+
+			/* Fields that share a name can have different types. */
+			ftype = hfinfo->type;
+			for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+				if (hfinfo->type != ftype)
+					return FT_NONE;
+			}
+			return ftype;
+
+		case STTYPE_FVALUE:
+			return fvalue_type_ftenum((fvalue_t*)stnode_data(st_arg));
+
+		default:
+			return FT_NONE;
+	}
+}
+
+static int32_class_t
+entity_int32_class(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	ftenum_t	ftype;
+
+	ftype = entity_ftype(st_arg1);
+	if (ftype != entity_ftype(st_arg2))
+		return INT32_NONE;
+
+	switch (ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+			return INT32_UNSIGNED;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return INT32_SIGNED;
+		default:
+			return INT32_NONE;
+	}
+}
+
+/* Returns the instruction to use for a relation between two operands.
+ * This has to be called before their code is generated, which takes
+ * the values of constants from the syntax tree. */
+static dfvm_opcode_t
+relation_opcode(dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	int32_class_t	cls;
+
+	cls = entity_int32_class(st_arg1, st_arg2);
+	if (cls == INT32_NONE)
+		return op;
+
+	switch (op) {
+		case ANY_EQ:
+			return ANY_EQ_INT32;
+		case ANY_NE:
+			return ANY_NE_INT32;
+		case ANY_GT:
+			return cls == INT32_UNSIGNED ? ANY_GT_UINT32 : ANY_GT_SINT32;
+		case ANY_GE:
+			return cls == INT32_UNSIGNED ? ANY_GE_UINT32 : ANY_GE_SINT32;
+		case ANY_LT:
+			return cls == INT32_UNSIGNED ? ANY_LT_UINT32 : ANY_LT_SINT32;
+		case ANY_LE:
+			return cls == INT32_UNSIGNED ? ANY_LE_UINT32 : ANY_LE_SINT32;
+		case ANY_BITWISE_AND:
+			return ANY_BITWISE_AND_INT32;
+		default:
+			return op;
+	}
+}
+
 /**
  * Adds an instruction for a relation operator where the values are already
  * loaded in registers.
@@ -280,6 +384,8 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
 
+	op = relation_opcode(op, st_arg1, st_arg2);
+
 	/* Create code for the LHS and RHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 	reg2 = gen_entity(dfw, st_arg2, &jmp2);
@@ -354,12 +460,14 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 			dfw_append_insn(dfw, insn);
 		} else {
 			int	reg2;
+			dfvm_opcode_t	op;
 
 			/* Normal element: add equality test. */
+			op = relation_opcode(ANY_EQ, st_arg1, node1);
 			reg2 = gen_entity(dfw, node1, &jmp2);
 
 			/* Add test to see if the item matches */
-			gen_relation_regs(dfw, ANY_EQ, reg1, reg2);
+			gen_relation_regs(dfw, op, reg1, reg2);
 		}
 
 		/* Exit as soon as we find a match */
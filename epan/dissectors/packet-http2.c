@@ -528,6 +528,12 @@ static const fragment_items http2_body_fragment_items = {
 static wmem_map_t *http2_hdrcache_map = NULL;
 /* Header name_length + name + value_length + value */
 static char *http2_header_pstr = NULL;
+/* Decompressed header blocks are often the same as earlier ones, e.g. when
+   many requests are made with the same header fields, which are then all
+   referenced from the dynamic table.  As header fields are cached above,
+   we keep one copy of each header block in this wmem_map_t, and share it
+   between the packets it's in. */
+static wmem_map_t *http2_hdrblock_map = NULL;
 #endif
 
 #ifdef HAVE_NGHTTP2
@@ -1146,6 +1152,7 @@ hd_inflate_del_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_, vo
     nghttp2_hd_inflate_del((nghttp2_hd_inflater*)user_data);
     http2_hdrcache_map = NULL;
     http2_header_pstr = NULL;
+    http2_hdrblock_map = NULL;
 
     return FALSE;
 }
@@ -1467,15 +1474,13 @@ process_http2_header_repr_info(wmem_array_t *headers,
 
         if(header_repr_info->complete) {
             if(header_repr_info->type == HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
-                http2_header_t *out;
+                http2_header_t out;
 
-                out = wmem_new(wmem_file_scope(), http2_header_t);
+                out.type = header_repr_info->type;
+                out.length = i - start;
+                out.table.header_table_size = header_repr_info->integer;
 
-                out->type = header_repr_info->type;
-                out->length = i - start;
-                out->table.header_table_size = header_repr_info->integer;
-
-                wmem_array_append(headers, out, 1);
+                wmem_array_append(headers, &out, 1);
 
                 reset_http2_header_repr_info(header_repr_info);
                 /* continue to decode header table size update or
@@ -1517,6 +1522,79 @@ static gboolean http2_hdrcache_equal(gconstpointer lhs, gconstpointer rhs)
     return alen == blen && memcmp(a, b, alen) == 0;
 }
 
+static guint http2_hdrblock_hash(gconstpointer key)
+{
+    wmem_array_t *headers = (wmem_array_t *)key;
+    guint count = wmem_array_get_count(headers);
+    guint hash = count;
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        const http2_header_t *h = (const http2_header_t *)wmem_array_index(headers, i);
+
+        hash = hash * 31 + h->type;
+        hash = hash * 31 + h->length;
+        if (h->type == HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
+            hash = hash * 31 + h->table.header_table_size;
+        } else {
+            /* Header fields are cached, so the same field has the same data. */
+            hash = hash * 31 + g_direct_hash(h->table.data.data);
+            hash = hash * 31 + h->table.data.idx;
+        }
+    }
+    return hash;
+}
+
+static gboolean http2_hdrblock_equal(gconstpointer lhs, gconstpointer rhs)
+{
+    wmem_array_t *a = (wmem_array_t *)lhs;
+    wmem_array_t *b = (wmem_array_t *)rhs;
+    guint count = wmem_array_get_count(a);
+    guint i;
+
+    if (count != wmem_array_get_count(b)) {
+        return FALSE;
+    }
+    for (i = 0; i < count; i++) {
+        const http2_header_t *ha = (const http2_header_t *)wmem_array_index(a, i);
+        const http2_header_t *hb = (const http2_header_t *)wmem_array_index(b, i);
+
+        if (ha->type != hb->type || ha->length != hb->length) {
+            return FALSE;
+        }
+        if (ha->type == HTTP2_HD_HEADER_TABLE_SIZE_UPDATE) {
+            if (ha->table.header_table_size != hb->table.header_table_size) {
+                return FALSE;
+            }
+        } else if (ha->table.data.data != hb->table.data.data ||
+                   ha->table.data.datalen != hb->table.data.datalen ||
+                   ha->table.data.idx != hb->table.data.idx) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Return the file scoped copy of a header block, which is kept for as long
+   as the capture file is open. */
+static wmem_array_t *
+cache_http2_header_block(wmem_array_t *headers)
+{
+    wmem_array_t *cached;
+    guint count;
+
+    cached = (wmem_array_t *)wmem_map_lookup(http2_hdrblock_map, headers);
+    if (!cached) {
+        count = wmem_array_get_count(headers);
+        cached = wmem_array_sized_new(wmem_file_scope(), sizeof(http2_header_t), count);
+        if (count > 0) {
+            wmem_array_append(cached, wmem_array_get_raw(headers), count);
+        }
+        wmem_map_insert(http2_hdrblock_map, cached, cached);
+    }
+    return cached;
+}
+
 static int
 is_in_header_context(tvbuff_t *tvb, packet_info *pinfo, http2_session_t* h2session)
 {
@@ -1790,6 +1868,9 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
     if (!http2_hdrcache_map) {
         http2_hdrcache_map = wmem_map_new(wmem_file_scope(), http2_hdrcache_hash, http2_hdrcache_equal);
     }
+    if (!http2_hdrblock_map) {
+        http2_hdrblock_map = wmem_map_new(wmem_file_scope(), http2_hdrblock_hash, http2_hdrblock_equal);
+    }
 
     header_data = (http2_header_data_t*)p_get_proto_data(wmem_file_scope(), pinfo, proto_http2, 0);
     header_list = header_data->header_list;
@@ -1816,7 +1897,9 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
 
         final = flags & HTTP2_FLAGS_END_HEADERS;
 
-        headers = wmem_array_sized_new(wmem_file_scope(), sizeof(http2_header_t), 16);
+        /* The header block is built up in packet scope, and then replaced by
+           its cached copy below. */
+        headers = wmem_array_sized_new(pinfo->pool, sizeof(http2_header_t), 16);
 
         for(;;) {
             nghttp2_nv nv;
@@ -1843,7 +1926,7 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                 char *cached_pstr;
                 guint32 len;
                 guint datalen = (guint)(4 + nv.namelen + 4 + nv.valuelen);
-                http2_header_t *out;
+                http2_header_t out;
 
                 if (decompressed_bytes + datalen >= MAX_HTTP2_HEADER_SIZE) {
                     header_data->header_size_reached = decompressed_bytes;
@@ -1851,13 +1934,11 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                     break;
                 }
 
-                out = wmem_new(wmem_file_scope(), http2_header_t);
-
-                out->type = header_repr_info->type;
-                out->length = rv;
-                out->table.data.idx = header_repr_info->integer;
+                out.type = header_repr_info->type;
+                out.length = rv;
+                out.table.data.idx = header_repr_info->integer;
 
-                out->table.data.datalen = datalen;
+                out.table.data.datalen = datalen;
                 decompressed_bytes += datalen;
 
                 /* Prepare buffer... with the following format
@@ -1866,7 +1947,7 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
                    value length (uint32)
                    value (string)
                 */
-                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, out->table.data.datalen);
+                http2_header_pstr = (char *)wmem_realloc(wmem_file_scope(), http2_header_pstr, out.table.data.datalen);
 
                 /* nv.namelen and nv.valuelen are of size_t.  In order
                    to get length in 4 bytes, we have to copy it to
@@ -1881,14 +1962,14 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
 
                 cached_pstr = (char *)wmem_map_lookup(http2_hdrcache_map, http2_header_pstr);
                 if (cached_pstr) {
-                    out->table.data.data = cached_pstr;
+                    out.table.data.data = cached_pstr;
                 } else {
                     wmem_map_insert(http2_hdrcache_map, http2_header_pstr, http2_header_pstr);
-                    out->table.data.data = http2_header_pstr;
+                    out.table.data.data = http2_header_pstr;
                     http2_header_pstr = NULL;
                 }
 
-                wmem_array_append(headers, out, 1);
+                wmem_array_append(headers, &out, 1);
 
                 reset_http2_header_repr_info(header_repr_info);
             }
@@ -1902,6 +1983,7 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
             }
         }
 
+        headers = cache_http2_header_block(headers);
         wmem_list_append(header_list, headers);
 
         if(!header_data->current) {
@@ -2005,12 +2087,18 @@ inflate_http2_header_block(tvbuff_t *tvb, packet_info *pinfo, guint offset, prot
         // check if field is http2 header https://tools.ietf.org/html/rfc7541#appendix-A
         try_add_named_header_field(header_tree, header_tvb, hoffset, header_value_length, header_name, header_value);
 
-        /* Add header unescaped. */
-        header_unescaped = g_uri_unescape_string(header_value, NULL);
-        if (header_unescaped != NULL) {
-            ti = proto_tree_add_string(header_tree, hf_http2_header_unescaped, header_tvb, hoffset, header_value_length, header_unescaped);
+        /* Add header unescaped.  Most values have nothing to unescape, and
+           needn't be copied to be added. */
+        if (strchr(header_value, '%') == NULL) {
+            ti = proto_tree_add_string(header_tree, hf_http2_header_unescaped, header_tvb, hoffset, header_value_length, header_value);
             proto_item_set_generated(ti);
-            g_free(header_unescaped);
+        } else {
+            header_unescaped = g_uri_unescape_string(header_value, NULL);
+            if (header_unescaped != NULL) {
+                ti = proto_tree_add_string(header_tree, hf_http2_header_unescaped, header_tvb, hoffset, header_value_length, header_unescaped);
+                proto_item_set_generated(ti);
+                g_free(header_unescaped);
+            }
         }
         hoffset += header_value_length;
 
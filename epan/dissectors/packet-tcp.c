@@ -29,6 +29,7 @@
 #include <epan/exported_pdu.h>
 #include <epan/in_cksum.h>
 #include <epan/proto_data.h>
+#include <epan/unit_strings.h>
 
 #include <wsutil/utf8_entities.h>
 #include <wsutil/str_util.h>
@@ -192,6 +193,8 @@ static int hf_tcp_analysis_push_bytes_sent = -1;
 static int hf_tcp_analysis_acks_frame = -1;
 static int hf_tcp_analysis_ack_rtt = -1;
 static int hf_tcp_analysis_first_rtt = -1;
+static int hf_tcp_analysis_unacked_peak = -1;
+static int hf_tcp_analysis_state_size = -1;
 static int hf_tcp_analysis_rto = -1;
 static int hf_tcp_analysis_rto_frame = -1;
 static int hf_tcp_analysis_duplicate_ack = -1;
@@ -1453,6 +1456,7 @@ static gboolean tcp_analyze_seq           = TRUE;
 static gboolean tcp_relative_seq          = TRUE;
 static gboolean tcp_track_bytes_in_flight = TRUE;
 static gboolean tcp_bif_seq_based         = FALSE;
+static guint    tcp_analyze_seq_window    = 0;
 static gboolean tcp_calculate_ts          = TRUE;
 
 static gboolean tcp_analyze_mptcp                   = TRUE;
@@ -1941,33 +1945,110 @@ pdu_store_window_scale_option(guint8 ws, struct tcp_analysis *tcpd)
 static void
 tcp_analyze_get_acked_struct(guint32 frame, guint32 seq, guint32 ack, gboolean createflag, struct tcp_analysis *tcpd)
 {
+    struct tcp_acked *head, *ta;
 
-    wmem_tree_key_t key[4];
+    if (!tcpd) {
+        return;
+    }
 
-    key[0].length = 1;
-    key[0].key = &frame;
+    /* Nearly always there's only one segment of a conversation in a
+     * frame, so key the table by frame alone and search the few ta's
+     * chained from there, rather than having a tree level each for
+     * seq and ack.
+     */
+    head = (struct tcp_acked *)wmem_tree_lookup32(tcpd->acked_table, frame);
+    for (ta = head; ta; ta = ta->next) {
+        if (ta->seq == seq && ta->ack == ack) {
+            break;
+        }
+    }
+    if (!ta && createflag) {
+        ta = wmem_new0(wmem_file_scope(), struct tcp_acked);
+        ta->seq = seq;
+        ta->ack = ack;
+        ta->next = head;
+        wmem_tree_insert32(tcpd->acked_table, frame, (void *)ta);
+    }
+    tcpd->ta = ta;
+}
 
-    key[1].length = 1;
-    key[1].key = &seq;
+#define TCP_UNACKED_MIN_SIZE 8
 
-    key[2].length = 1;
-    key[2].key = &ack;
+/* Index into the arrays of the i'th oldest unacked segment */
+#define TCP_UNACKED_INDEX(ring, i) (((ring)->first + (i)) & ((ring)->size - 1))
 
-    key[3].length = 0;
-    key[3].key = NULL;
+/* Bytes of analysis state kept for a flow */
+static guint32
+tcp_analyze_seq_state_size(const tcp_analyze_seq_flow_info_t *seq_info)
+{
+    return (guint32)(sizeof(tcp_analyze_seq_flow_info_t) +
+        seq_info->unacked.size * (3 * sizeof(guint32) + sizeof(nstime_t)));
+}
 
-    if (!tcpd) {
+static void
+tcp_unacked_grow(tcp_unacked_ring_t *ring)
+{
+    guint32 size = ring->size ? ring->size * 2 : TCP_UNACKED_MIN_SIZE;
+    guint32 *frame = wmem_alloc_array(wmem_file_scope(), guint32, size);
+    guint32 *seq = wmem_alloc_array(wmem_file_scope(), guint32, size);
+    guint32 *nextseq = wmem_alloc_array(wmem_file_scope(), guint32, size);
+    nstime_t *ts = wmem_alloc_array(wmem_file_scope(), nstime_t, size);
+    guint32 i, j;
+
+    /* Unwrap the ring, oldest first, into the new arrays */
+    for (i = 0; i < ring->count; i++) {
+        j = TCP_UNACKED_INDEX(ring, i);
+        frame[i] = ring->frame[j];
+        seq[i] = ring->seq[j];
+        nextseq[i] = ring->nextseq[j];
+        ts[i] = ring->ts[j];
+    }
+    wmem_free(wmem_file_scope(), ring->frame);
+    wmem_free(wmem_file_scope(), ring->seq);
+    wmem_free(wmem_file_scope(), ring->nextseq);
+    wmem_free(wmem_file_scope(), ring->ts);
+
+    ring->frame = frame;
+    ring->seq = seq;
+    ring->nextseq = nextseq;
+    ring->ts = ts;
+    ring->first = 0;
+    ring->size = size;
+}
+
+/* Add a segment to the newest end of the unacked segments.  If as many
+ * are stored as we keep, either the oldest is dropped, if the analysis
+ * window is limited, or the new one isn't added (e.g., we're not seeing
+ * the ACKs).
+ */
+static void
+tcp_unacked_add(tcp_unacked_ring_t *ring, guint32 frame, guint32 seq, guint32 nextseq, const nstime_t *ts)
+{
+    guint32 j;
+
+    if (tcp_analyze_seq_window) {
+        while (ring->count >= tcp_analyze_seq_window) {
+            ring->first = TCP_UNACKED_INDEX(ring, 1);
+            ring->count--;
+        }
+    } else if (ring->count >= TCP_MAX_UNACKED_SEGMENTS) {
         return;
     }
 
-    tcpd->ta = (struct tcp_acked *)wmem_tree_lookup32_array(tcpd->acked_table, key);
-    if((!tcpd->ta) && createflag) {
-        tcpd->ta = wmem_new0(wmem_file_scope(), struct tcp_acked);
-        wmem_tree_insert32_array(tcpd->acked_table, key, (void *)tcpd->ta);
+    if (ring->count == ring->size) {
+        tcp_unacked_grow(ring);
+    }
+    j = TCP_UNACKED_INDEX(ring, ring->count);
+    ring->frame[j] = frame;
+    ring->seq[j] = seq;
+    ring->nextseq[j] = nextseq;
+    ring->ts[j] = *ts;
+    ring->count++;
+    if (ring->count > ring->peak) {
+        ring->peak = ring->count;
     }
 }
 
-
 /* fwd contains a list of all segments processed but not yet ACKed in the
  *     same direction as the current segment.
  * rev contains a list of all segments received but not yet ACKed in the
@@ -1981,19 +2062,22 @@ tcp_analyze_get_acked_struct(guint32 frame, guint32 seq, guint32 ack, gboolean c
 static void
 tcp_analyze_sequence_number(packet_info *pinfo, guint32 seq, guint32 ack, guint32 seglen, guint16 flags, guint32 window, struct tcp_analysis *tcpd)
 {
-    tcp_unacked_t *ual=NULL;
-    tcp_unacked_t *prevual=NULL;
+    tcp_unacked_ring_t *ring;
+    guint32 i, j, w;
+    gboolean matched;
     guint32 nextseq;
     int ackcount;
 
 #if 0
     printf("\nanalyze_sequence numbers   frame:%u\n",pinfo->num);
     printf("FWD list lastflags:0x%04x base_seq:%u: nextseq:%u lastack:%u\n",tcpd->fwd->lastsegmentflags,tcpd->fwd->base_seq,tcpd->fwd->tcp_analyze_seq_info->nextseq,tcpd->rev->tcp_analyze_seq_info->lastack);
-    for(ual=tcpd->fwd->tcp_analyze_seq_info->segments; ual; ual=ual->next)
-            printf("Frame:%d Seq:%u Nextseq:%u\n",ual->frame,ual->seq,ual->nextseq);
+    ring=&tcpd->fwd->tcp_analyze_seq_info->unacked;
+    for(i=ring->count; i-- > 0; )
+            printf("Frame:%d Seq:%u Nextseq:%u\n",ring->frame[TCP_UNACKED_INDEX(ring, i)],ring->seq[TCP_UNACKED_INDEX(ring, i)],ring->nextseq[TCP_UNACKED_INDEX(ring, i)]);
     printf("REV list lastflags:0x%04x base_seq:%u nextseq:%u lastack:%u\n",tcpd->rev->lastsegmentflags,tcpd->rev->base_seq,tcpd->rev->tcp_analyze_seq_info->nextseq,tcpd->fwd->tcp_analyze_seq_info->lastack);
-    for(ual=tcpd->rev->tcp_analyze_seq_info->segments; ual; ual=ual->next)
-            printf("Frame:%d Seq:%u Nextseq:%u\n",ual->frame,ual->seq,ual->nextseq);
+    ring=&tcpd->rev->tcp_analyze_seq_info->unacked;
+    for(i=ring->count; i-- > 0; )
+            printf("Frame:%d Seq:%u Nextseq:%u\n",ring->frame[TCP_UNACKED_INDEX(ring, i)],ring->seq[TCP_UNACKED_INDEX(ring, i)],ring->nextseq[TCP_UNACKED_INDEX(ring, i)]);
 #endif
 
     if (!tcpd) {
@@ -2353,11 +2437,11 @@ finished_fwd:
              * go back to the eldest one, which in theory is likely to be the one retransmitted here.
              * It's not always the perfect match, particularly when original captured packet used LSO
              */
-            ual = tcpd->fwd->tcp_analyze_seq_info->segments;
-            while(ual) {
-                nstime_delta(&tcpd->ta->rto_ts, &pinfo->abs_ts, &ual->ts );
-                tcpd->ta->rto_frame=ual->frame;
-                ual=ual->next;
+            ring = &tcpd->fwd->tcp_analyze_seq_info->unacked;
+            if(ring->count) {
+                j = TCP_UNACKED_INDEX(ring, 0);
+                nstime_delta(&tcpd->ta->rto_ts, &pinfo->abs_ts, &ring->ts[j]);
+                tcpd->ta->rto_frame=ring->frame[j];
             }
         }
     }
@@ -2365,23 +2449,14 @@ finished_fwd:
 finished_checking_retransmission_type:
 
     nextseq = seq+seglen;
-    if ((seglen || flags&(TH_SYN|TH_FIN)) && tcpd->fwd->tcp_analyze_seq_info->segment_count < TCP_MAX_UNACKED_SEGMENTS) {
-        /* Add this new sequence number to the fwd list.  But only if there
-         * aren't "too many" unacked segments (e.g., we're not seeing the ACKs).
-         */
-        ual = wmem_new(wmem_file_scope(), tcp_unacked_t);
-        ual->next=tcpd->fwd->tcp_analyze_seq_info->segments;
-        tcpd->fwd->tcp_analyze_seq_info->segments=ual;
-        tcpd->fwd->tcp_analyze_seq_info->segment_count++;
-        ual->frame=pinfo->num;
-        ual->seq=seq;
-        ual->ts=pinfo->abs_ts;
-
+    if (seglen || flags&(TH_SYN|TH_FIN)) {
         /* next sequence number is seglen bytes away, plus SYN/FIN which counts as one byte */
         if( (flags&(TH_SYN|TH_FIN)) ) {
             nextseq+=1;
         }
-        ual->nextseq=nextseq;
+        /* Add this new sequence number to the fwd list. */
+        tcp_unacked_add(&tcpd->fwd->tcp_analyze_seq_info->unacked,
+            pinfo->num, seq, nextseq, &pinfo->abs_ts);
     }
 
     /* Store the highest number seen so far for nextseq so we can detect
@@ -2428,54 +2503,71 @@ finished_checking_retransmission_type:
         tcpd->fwd->lastsegmentflags=0;
     }
 
+    /* if the analysis window is limited, remember how much of the flow's
+     * analysis state is kept as of this frame, for later passes to show
+     */
+    if (tcp_analyze_seq_window) {
+        tcp_analyze_get_acked_struct(pinfo->num, seq, ack, TRUE, tcpd);
+        tcpd->ta->unacked_peak=tcpd->fwd->tcp_analyze_seq_info->unacked.peak;
+        tcpd->ta->state_size=tcp_analyze_seq_state_size(tcpd->fwd->tcp_analyze_seq_info);
+    }
+
 
     /* remove all segments this ACKs and we don't need to keep around any more
      */
     ackcount=0;
-    prevual = NULL;
-    ual = tcpd->rev->tcp_analyze_seq_info->segments;
-    while(ual) {
-        tcp_unacked_t *tmpual;
+    matched=FALSE;
+    ring = &tcpd->rev->tcp_analyze_seq_info->unacked;
+    for(i = 0, w = 0; i < ring->count; i++) {
+        gboolean keep = FALSE;
 
-        /* If this ack matches the segment, process accordingly */
-        if(ack==ual->nextseq) {
-            tcp_analyze_get_acked_struct(pinfo->num, seq, ack, TRUE, tcpd);
-            tcpd->ta->frame_acked=ual->frame;
-            nstime_delta(&tcpd->ta->ts, &pinfo->abs_ts, &ual->ts);
+        j = TCP_UNACKED_INDEX(ring, i);
+
+        /* If this ack matches the segment, process accordingly; if
+         * it matches more than one, it's for the eldest of them */
+        if(ack==ring->nextseq[j]) {
+            if(!matched) {
+                tcp_analyze_get_acked_struct(pinfo->num, seq, ack, TRUE, tcpd);
+                tcpd->ta->frame_acked=ring->frame[j];
+                nstime_delta(&tcpd->ta->ts, &pinfo->abs_ts, &ring->ts[j]);
+                matched=TRUE;
+            }
         }
         /* If this acknowledges part of the segment, adjust the segment info for the acked part */
-        else if (GT_SEQ(ack, ual->seq) && LE_SEQ(ack, ual->nextseq)) {
-            ual->seq = ack;
-            continue;
+        else if (GT_SEQ(ack, ring->seq[j]) && LE_SEQ(ack, ring->nextseq[j])) {
+            ring->seq[j] = ack;
+            keep = TRUE;
         }
         /* If this acknowledges a segment prior to this one, leave this segment alone and move on */
-        else if (GT_SEQ(ual->nextseq,ack)) {
-            prevual = ual;
-            ual = ual->next;
-            continue;
+        else if (GT_SEQ(ring->nextseq[j],ack)) {
+            keep = TRUE;
         }
 
-        /* This segment is old, or an exact match.  Delete the segment from the list */
-        ackcount++;
-        tmpual=ual->next;
+        if (!keep) {
+            /* This segment is old, or an exact match.  Delete the segment from the list */
+            ackcount++;
 
-        if (tcpd->rev->scps_capable) {
-          /* Track largest segment successfully sent for SNACK analysis*/
-          if ((ual->nextseq - ual->seq) > tcpd->fwd->maxsizeacked) {
-            tcpd->fwd->maxsizeacked = (ual->nextseq - ual->seq);
-          }
+            if (tcpd->rev->scps_capable) {
+              /* Track largest segment successfully sent for SNACK analysis*/
+              if ((ring->nextseq[j] - ring->seq[j]) > tcpd->fwd->maxsizeacked) {
+                tcpd->fwd->maxsizeacked = (ring->nextseq[j] - ring->seq[j]);
+              }
+            }
+            continue;
         }
 
-        if (!prevual) {
-            tcpd->rev->tcp_analyze_seq_info->segments = tmpual;
-        }
-        else{
-            prevual->next = tmpual;
+        /* Move the segments we keep down over the ones we've deleted */
+        if (w != i) {
+            guint32 k = TCP_UNACKED_INDEX(ring, w);
+
+            ring->frame[k] = ring->frame[j];
+            ring->seq[k] = ring->seq[j];
+            ring->nextseq[k] = ring->nextseq[j];
+            ring->ts[k] = ring->ts[j];
         }
-        wmem_free(wmem_file_scope(), ual);
-        ual = tmpual;
-        tcpd->rev->tcp_analyze_seq_info->segment_count--;
+        w++;
     }
+    ring->count = w;
 
     /* how many bytes of data are there in flight after this frame
      * was sent
@@ -2497,23 +2589,24 @@ finished_checking_retransmission_type:
          * by now still the default.
          */
         if(!tcp_bif_seq_based) {
-            ual=tcpd->fwd->tcp_analyze_seq_info->segments;
+            ring=&tcpd->fwd->tcp_analyze_seq_info->unacked;
 
-            if (seglen!=0 && ual && tcpd->fwd->valid_bif) {
+            if (seglen!=0 && ring->count && tcpd->fwd->valid_bif) {
                 guint32 first_seq, last_seq;
 
                 dry_bif_handling = TRUE;
 
-                first_seq = ual->seq - tcpd->fwd->base_seq;
-                last_seq = ual->nextseq - tcpd->fwd->base_seq;
-                while (ual) {
-                    if ((ual->nextseq-tcpd->fwd->base_seq)>last_seq) {
-                        last_seq = ual->nextseq-tcpd->fwd->base_seq;
+                j = TCP_UNACKED_INDEX(ring, ring->count - 1);
+                first_seq = ring->seq[j] - tcpd->fwd->base_seq;
+                last_seq = ring->nextseq[j] - tcpd->fwd->base_seq;
+                for (i = 0; i < ring->count; i++) {
+                    j = TCP_UNACKED_INDEX(ring, i);
+                    if ((ring->nextseq[j]-tcpd->fwd->base_seq)>last_seq) {
+                        last_seq = ring->nextseq[j]-tcpd->fwd->base_seq;
                     }
-                    if ((ual->seq-tcpd->fwd->base_seq)<first_seq) {
-                        first_seq = ual->seq-tcpd->fwd->base_seq;
+                    if ((ring->seq[j]-tcpd->fwd->base_seq)<first_seq) {
+                        first_seq = ring->seq[j]-tcpd->fwd->base_seq;
                     }
-                    ual = ual->next;
                 }
                 in_flight = last_seq-first_seq;
             }
@@ -3187,6 +3280,15 @@ tcp_print_sequence_number_analysis(packet_info *pinfo, tvbuff_t *tvb, proto_tree
                 tvb, 0, 0, &(tcpd->ts_first_rtt));
         proto_item_set_generated(item);
     }
+    if (ta->state_size) {
+        /* report how much the analysis of this flow was holding on to */
+        item = proto_tree_add_uint(tree, hf_tcp_analysis_unacked_peak,
+                tvb, 0, 0, ta->unacked_peak);
+        proto_item_set_generated(item);
+        item = proto_tree_add_uint(tree, hf_tcp_analysis_state_size,
+                tvb, 0, 0, ta->state_size);
+        proto_item_set_generated(item);
+    }
 
     if(ta->bytes_in_flight) {
         /* print results for amount of data in flight */
@@ -7535,6 +7637,14 @@ proto_register_tcp(void)
           { "iRTT",            "tcp.analysis.initial_rtt", FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
             "How long it took for the SYN to ACK handshake (iRTT)", HFILL}},
 
+        { &hf_tcp_analysis_unacked_peak,
+          { "Most unacked segments kept", "tcp.analysis.unacked_peak", FT_UINT32, BASE_DEC, NULL, 0x0,
+            "The most segments of this flow kept at once for sequence analysis while waiting for them to be ACKed, up to this segment", HFILL}},
+
+        { &hf_tcp_analysis_state_size,
+          { "Sequence analysis state", "tcp.analysis.state_size", FT_UINT32, BASE_DEC|BASE_UNIT_STRING, &units_byte_bytes, 0x0,
+            "How much memory the sequence analysis of this flow was using after this segment", HFILL}},
+
         { &hf_tcp_analysis_rto,
           { "The RTO for this segment was",            "tcp.analysis.rto", FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
             "How long transmission was delayed before this segment was retransmitted (RTO)", HFILL}},
@@ -8404,6 +8514,13 @@ proto_register_tcp(void)
         "Analyze TCP sequence numbers",
         "Make the TCP dissector analyze TCP sequence numbers to find and flag segment retransmissions, missing segments and RTT",
         &tcp_analyze_seq);
+    prefs_register_uint_preference(tcp_module, "analyze_sequence_numbers_window",
+        "Unacked segments kept for sequence analysis",
+        "If nonzero, keep at most this many of the latest segments of each flow that haven't been ACKed, "
+        "dropping the oldest, so that long flows with lost ACKs take bounded memory; retransmissions and "
+        "RTTs are then only found within that window, and the memory used by each flow is shown. "
+        "If zero, up to 10000 are kept, and later segments aren't analyzed once that many are waiting for an ACK.",
+        10, &tcp_analyze_seq_window);
     prefs_register_bool_preference(tcp_module, "relative_sequence_numbers",
         "Relative sequence numbers (Requires \"Analyze TCP sequence numbers\")",
         "Make the TCP dissector use relative sequence numbers instead of absolute ones. "
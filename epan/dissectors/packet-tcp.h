@@ -146,19 +146,34 @@ tcp_dissect_pdus(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 extern struct tcp_multisegment_pdu *
 pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, guint32 seq, guint32 nxtpdu, wmem_tree_t *multisegment_pdus);
 
-typedef struct _tcp_unacked_t {
-	struct _tcp_unacked_t *next;
-	guint32 frame;
-	guint32	seq;
-	guint32	nextseq;
-	nstime_t ts;
-} tcp_unacked_t;
+/* Segments for which we haven't seen an ACK, oldest first.  They're kept
+ * in a ring of parallel arrays, which costs much less per segment than a
+ * list, and lets the oldest be dropped cheaply when only a limited
+ * number of them are kept.
+ */
+typedef struct _tcp_unacked_ring_t {
+	guint32 *frame;
+	guint32 *seq;
+	guint32 *nextseq;
+	nstime_t *ts;
+	guint32 first;		/* index of the oldest segment */
+	guint32 count;		/* how many unacked segments we're currently storing */
+	guint32 size;		/* how many we have room for; a power of 2 */
+	guint32 peak;		/* the most we've stored at once */
+} tcp_unacked_ring_t;
 
 struct tcp_acked {
+	struct tcp_acked *next;	/* another segment in the same frame */
+	guint32 seq;		/* seq and ack of the segment, to tell them apart */
+	guint32 ack;
 	guint32 frame_acked;
+	guint32 unacked_peak;	/* most unacked segments kept for the flow,
+				   as of this frame */
 	nstime_t ts;
 
 	guint32  rto_frame;
+	guint32 state_size;	/* bytes of analysis state for the flow,
+				   as of this frame */
 	nstime_t rto_ts;	/* Time since previous packet for
 				   retransmissions. */
 	guint16 flags; /* see TCP_A_* in packet-tcp.c */
@@ -294,8 +309,7 @@ typedef enum {
  * is enabled, so save the memory when it isn't
  */
 typedef struct tcp_analyze_seq_flow_info_t {
-	tcp_unacked_t *segments;/* List of segments for which we haven't seen an ACK */
-	guint16 segment_count;	/* How many unacked segments we're currently storing */
+	tcp_unacked_ring_t unacked;	/* Segments for which we haven't seen an ACK */
     guint32 lastack;	/* Last seen ack for the reverse flow */
 	nstime_t lastacktime;	/* Time of the last ack packet */
 	guint32 lastnondupack;	/* frame number of last seen non dupack */
@@ -427,7 +441,9 @@ struct tcp_analysis {
 	 */
 	struct tcp_acked *ta;
 	/* This structure contains a tree containing all the various ta's
-	 * keyed by frame number.
+	 * keyed by frame number; the ta's for frames with more than one
+	 * segment of this conversation are chained through their next
+	 * pointers.
 	 */
 	wmem_tree_t	*acked_table;
 
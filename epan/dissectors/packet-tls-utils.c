@@ -3810,8 +3810,9 @@ ssl_decrypt_pre_master_secret(SslDecryptSession *ssl_session,
 #endif /* HAVE_LIBGNUTLS */
 
 static gboolean
-ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
-                       gboolean is_pre_master, GHashTable *ht, StringInfo *key);
+ssl_restore_master_key(SslDecryptSession *ssl, const ssl_master_key_map_t *mk_map,
+                       const char *label, gboolean is_pre_master, GHashTable *ht,
+                       StringInfo *key);
 
 gboolean
 ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
@@ -3838,7 +3839,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
     }
 
     /* check to see if the PMS was provided to us*/
-    if (ssl_restore_master_key(ssl_session, "Unencrypted pre-master secret", TRUE,
+    if (ssl_restore_master_key(ssl_session, mk_map, "Unencrypted pre-master secret", TRUE,
            mk_map->pms, &ssl_session->client_random)) {
         return TRUE;
     }
@@ -3949,7 +3950,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
         /* try to find the pre-master secret from the encrypted one. The
          * ssl key logfile stores only the first 8 bytes, so truncate it */
         encrypted_pre_master.data_len = 8;
-        if (ssl_restore_master_key(ssl_session, "Encrypted pre-master secret",
+        if (ssl_restore_master_key(ssl_session, mk_map, "Encrypted pre-master secret",
             TRUE, mk_map->pre_master, &encrypted_pre_master))
             return TRUE;
     }
@@ -5489,6 +5490,9 @@ ssl_get_record_info(tvbuff_t *parent_tvb, int proto, packet_info *pinfo, gint re
 }
 /* Links SSL records with the real packet data. }}} */
 
+static void
+tls_keylog_index_close(struct tls_keylog_index *idx);
+
 /* initialize/reset per capture state data (ssl sessions cache). {{{ */
 void
 ssl_common_init(ssl_master_key_map_t *mk_map,
@@ -5506,6 +5510,7 @@ ssl_common_init(ssl_master_key_map_t *mk_map,
     mk_map->tls13_server_appdata = g_hash_table_new(ssl_hash, ssl_equal);
     mk_map->tls13_early_exporter = g_hash_table_new(ssl_hash, ssl_equal);
     mk_map->tls13_exporter = g_hash_table_new(ssl_hash, ssl_equal);
+    mk_map->keylog_index = NULL;
     ssl_data_alloc(decrypted_data, 32);
     ssl_data_alloc(compressed_data, 32);
 }
@@ -5536,6 +5541,10 @@ ssl_common_cleanup(ssl_master_key_map_t *mk_map, FILE **ssl_keylog_file,
         fclose(*ssl_keylog_file);
         *ssl_keylog_file = NULL;
     }
+    if (mk_map->keylog_index) {
+        tls_keylog_index_close(mk_map->keylog_index);
+        mk_map->keylog_index = NULL;
+    }
 }
 /* }}} */
 
@@ -5669,8 +5678,9 @@ ssl_save_master_key(const char *label, GHashTable *ht, StringInfo *key,
 
 /** restore a (pre-)master secret given some key in the cache */
 static gboolean
-ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
-                       gboolean is_pre_master, GHashTable *ht, StringInfo *key)
+ssl_restore_master_key(SslDecryptSession *ssl, const ssl_master_key_map_t *mk_map,
+                       const char *label, gboolean is_pre_master, GHashTable *ht,
+                       StringInfo *key)
 {
     StringInfo *ms;
 
@@ -5680,7 +5690,7 @@ ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
         return FALSE;
     }
 
-    ms = (StringInfo *)g_hash_table_lookup(ht, key);
+    ms = ssl_master_key_lookup(mk_map, ht, key);
     if (!ms) {
         ssl_debug_printf("%s can't find %smaster secret by %s\n", G_STRFUNC,
                          is_pre_master ? "pre-" : "", label);
@@ -5735,12 +5745,12 @@ ssl_finalize_decryption(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map)
      * from pre-master secret). If missing, try to pick a master key from cache
      * (an earlier packet in the capture or key logfile). */
     if (!(ssl->state & (SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET)) &&
-        !ssl_restore_master_key(ssl, "Session ID", FALSE,
+        !ssl_restore_master_key(ssl, mk_map, "Session ID", FALSE,
                                 mk_map->session, &ssl->session_id) &&
         (!ssl->session.is_session_resumed ||
-         !ssl_restore_master_key(ssl, "Session Ticket", FALSE,
+         !ssl_restore_master_key(ssl, mk_map, "Session Ticket", FALSE,
                                  mk_map->tickets, &ssl->session_ticket)) &&
-        !ssl_restore_master_key(ssl, "Client Random", FALSE,
+        !ssl_restore_master_key(ssl, mk_map, "Client Random", FALSE,
                                 mk_map->crandom, &ssl->client_random)) {
         if (ssl->cipher_suite->enc != ENC_NULL) {
             /* how unfortunate, the master secret could not be found */
@@ -5820,7 +5830,7 @@ tls13_load_secret(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map,
     ssl_debug_printf("%s transitioning to new key, old state 0x%02x\n", G_STRFUNC, ssl->state);
     ssl->state &= ~(SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET | SSL_HAVE_SESSION_KEY);
 
-    StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
+    StringInfo *secret = ssl_master_key_lookup(mk_map, key_map, &ssl->client_random);
     if (!secret) {
         ssl_debug_printf("%s Cannot find %s, decryption impossible\n", G_STRFUNC, label);
         /* Disable decryption, the keys are invalid. */
@@ -6110,9 +6120,515 @@ tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data,
     }
 }
 
+/*
+ * Key log files with many secrets can be indexed, so that the secrets of
+ * the sessions in a capture are read when they're looked up instead of
+ * all of them being loaded whenever the capture is dissected.
+ *
+ * The index is a file next to the key log file, with ".idx" appended to
+ * its name, giving the label and key (Client Random, Session ID, ...) of
+ * each line of the key log file and where the line is, sorted by label
+ * and key, so that the lines for a key can be found with a binary search.
+ * It covers the complete lines the key log file had when it was written.
+ * Lines appended since, as they are to a key log file written during a
+ * live capture, are loaded as they're read, as they are without an
+ * index; once there are tls.keylog_index_min_size MiB of them, the index
+ * is written again.
+ *
+ * Index file format; all integers are little-endian.
+ *
+ * Header:
+ *
+ *     magic, "TLSKIDX\0"                          8 bytes
+ *     version, TLS_KEYLOG_INDEX_VERSION            4 bytes
+ *     entry size, TLS_KEYLOG_INDEX_ENTRY_SIZE      4 bytes
+ *     length of the key log file covered           8 bytes
+ *     number of entries                            8 bytes
+ *     SHA-256 of the first and last
+ *     TLS_KEYLOG_INDEX_HASH_SPAN bytes covered    32 bytes
+ *
+ * followed by one entry per line, sorted by label, key, key length and
+ * line offset:
+ *
+ *     label, index in tls_keylog_labels           1 byte
+ *     key length                                  1 byte
+ *     reserved                                    2 bytes
+ *     first TLS_KEYLOG_INDEX_KEY_LEN bytes of
+ *     the key, padded with zeroes                16 bytes
+ *     line length                                 4 bytes
+ *     line offset                                 8 bytes
+ *
+ * Keys are random, so lines whose keys start with the same
+ * TLS_KEYLOG_INDEX_KEY_LEN bytes are rare; all of them are loaded when one
+ * of them is looked up.
+ */
+#define TLS_KEYLOG_INDEX_MAGIC          "TLSKIDX"
+#define TLS_KEYLOG_INDEX_VERSION        1
+#define TLS_KEYLOG_INDEX_HEADER_SIZE    64
+#define TLS_KEYLOG_INDEX_ENTRY_SIZE     32
+#define TLS_KEYLOG_INDEX_KEY_LEN        16
+#define TLS_KEYLOG_INDEX_HASH_SIZE      32
+#define TLS_KEYLOG_INDEX_HASH_SPAN      65536
+#define TLS_KEYLOG_INDEX_MAX_LINE       4096        /* longer lines aren't indexed */
+#define TLS_KEYLOG_INDEX_READ_SIZE      (1024 * 1024)
+
+static guint tls_keylog_index_min_size = 0;    /* MiB; 0 disables indexing */
+
+/* Line labels, and the map the secrets they give go into. */
+static const struct {
+    const char *label;
+    glong       map_offset;
+} tls_keylog_labels[] = {
+    /* "RSA Session-ID:" must come before "RSA ". */
+    { "RSA Session-ID:",                    G_STRUCT_OFFSET(ssl_master_key_map_t, session) },
+    { "RSA ",                               G_STRUCT_OFFSET(ssl_master_key_map_t, pre_master) },
+    { "CLIENT_RANDOM ",                     G_STRUCT_OFFSET(ssl_master_key_map_t, crandom) },
+    { "PMS_CLIENT_RANDOM ",                 G_STRUCT_OFFSET(ssl_master_key_map_t, pms) },
+    { "CLIENT_EARLY_TRAFFIC_SECRET ",       G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_early) },
+    { "CLIENT_HANDSHAKE_TRAFFIC_SECRET ",   G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_handshake) },
+    { "SERVER_HANDSHAKE_TRAFFIC_SECRET ",   G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_server_handshake) },
+    { "CLIENT_TRAFFIC_SECRET_0 ",           G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_client_appdata) },
+    { "SERVER_TRAFFIC_SECRET_0 ",           G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_server_appdata) },
+    { "EARLY_EXPORTER_SECRET ",             G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_early_exporter) },
+    { "EXPORTER_SECRET ",                   G_STRUCT_OFFSET(ssl_master_key_map_t, tls13_exporter) },
+};
+
+typedef struct {
+    guint8  label;
+    guint8  key_len;
+    guint8  key[TLS_KEYLOG_INDEX_KEY_LEN];
+    guint32 line_len;
+    guint64 offset;
+} tls_keylog_index_entry_t;
+
+struct tls_keylog_index {
+    FILE    *fh;            /* the index */
+    FILE    *keylog_fh;     /* the key log file, for reading indexed lines */
+    gint64   length;        /* length of the key log file covered */
+    guint64  count;         /* number of entries */
+    guint64  lookups;
+    guint64  lines_loaded;
+};
+
+static GHashTable *
+tls_keylog_label_map(const ssl_master_key_map_t *mk_map, guint label)
+{
+    return *(GHashTable * const *)((const guint8 *)mk_map + tls_keylog_labels[label].map_offset);
+}
+
+/* Find the label and key of a key log line. */
+static gboolean
+tls_keylog_index_parse_line(const char *line, gsize linelen, tls_keylog_index_entry_t *entry)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(tls_keylog_labels); i++) {
+        gsize label_len = strlen(tls_keylog_labels[i].label);
+        gsize pos = label_len;
+        guint key_len = 0;
+
+        if (linelen < label_len || memcmp(line, tls_keylog_labels[i].label, label_len) != 0) {
+            continue;
+        }
+        memset(entry, 0, sizeof(*entry));
+        while (pos + 1 < linelen && g_ascii_isxdigit(line[pos]) && g_ascii_isxdigit(line[pos + 1])) {
+            if (key_len < TLS_KEYLOG_INDEX_KEY_LEN) {
+                entry->key[key_len] = (g_ascii_xdigit_value(line[pos]) << 4) |
+                                      g_ascii_xdigit_value(line[pos + 1]);
+            }
+            key_len++;
+            pos += 2;
+        }
+        if (key_len == 0 || key_len > G_MAXUINT8) {
+            return FALSE;
+        }
+        entry->label = i;
+        entry->key_len = key_len;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static int
+tls_keylog_index_key_cmp(const tls_keylog_index_entry_t *a, const tls_keylog_index_entry_t *b)
+{
+    int ret;
+
+    if (a->label != b->label) {
+        return a->label < b->label ? -1 : 1;
+    }
+    ret = memcmp(a->key, b->key, TLS_KEYLOG_INDEX_KEY_LEN);
+    if (ret != 0) {
+        return ret;
+    }
+    if (a->key_len != b->key_len) {
+        return a->key_len < b->key_len ? -1 : 1;
+    }
+    return 0;
+}
+
+static gint
+tls_keylog_index_entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const tls_keylog_index_entry_t *ea = (const tls_keylog_index_entry_t *)a;
+    const tls_keylog_index_entry_t *eb = (const tls_keylog_index_entry_t *)b;
+    int ret = tls_keylog_index_key_cmp(ea, eb);
+
+    if (ret == 0 && ea->offset != eb->offset) {
+        ret = ea->offset < eb->offset ? -1 : 1;
+    }
+    return ret;
+}
+
+static gboolean
+tls_keylog_index_get_entry(struct tls_keylog_index *idx, guint64 n, tls_keylog_index_entry_t *entry)
+{
+    guint8 buf[TLS_KEYLOG_INDEX_ENTRY_SIZE];
+
+    if (ws_fseek64(idx->fh, TLS_KEYLOG_INDEX_HEADER_SIZE + n * TLS_KEYLOG_INDEX_ENTRY_SIZE, SEEK_SET) == -1 ||
+        fread(buf, 1, sizeof(buf), idx->fh) != sizeof(buf)) {
+        return FALSE;
+    }
+    entry->label = buf[0];
+    entry->key_len = buf[1];
+    memcpy(entry->key, &buf[4], TLS_KEYLOG_INDEX_KEY_LEN);
+    entry->line_len = pletoh32(&buf[20]);
+    entry->offset = pletoh64(&buf[24]);
+    return TRUE;
+}
+
+/*
+ * Hash the first and last TLS_KEYLOG_INDEX_HASH_SPAN bytes of the part of
+ * the key log file covered by an index; that's enough to catch a file
+ * that's been rewritten, without reading all of a large file.
+ */
+static gboolean
+tls_keylog_index_hash(FILE *keylog_fh, gint64 length, guint8 *hash)
+{
+    GChecksum *checksum;
+    guint8 *buf;
+    gsize hash_len = TLS_KEYLOG_INDEX_HASH_SIZE;
+    gint64 tail_start;
+    size_t want;
+    gboolean ok = TRUE;
+
+    buf = (guint8 *)g_malloc(TLS_KEYLOG_INDEX_HASH_SPAN);
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+    want = (size_t)MIN(length, TLS_KEYLOG_INDEX_HASH_SPAN);
+    if (ws_fseek64(keylog_fh, 0, SEEK_SET) == -1 || fread(buf, 1, want, keylog_fh) != want) {
+        ok = FALSE;
+    } else {
+        g_checksum_update(checksum, buf, want);
+        if (length > TLS_KEYLOG_INDEX_HASH_SPAN) {
+            tail_start = MAX(length - TLS_KEYLOG_INDEX_HASH_SPAN, TLS_KEYLOG_INDEX_HASH_SPAN);
+            want = (size_t)(length - tail_start);
+            if (ws_fseek64(keylog_fh, tail_start, SEEK_SET) == -1 ||
+                fread(buf, 1, want, keylog_fh) != want) {
+                ok = FALSE;
+            } else {
+                g_checksum_update(checksum, buf, want);
+            }
+        }
+    }
+    if (ok) {
+        g_checksum_get_digest(checksum, hash, &hash_len);
+    }
+    g_checksum_free(checksum);
+    g_free(buf);
+    return ok;
+}
+
+/* Index the complete lines of a key log file. */
+static gboolean
+tls_keylog_index_write(FILE *keylog_fh, const char *index_path)
+{
+    GArray *entries;
+    tls_keylog_index_entry_t entry;
+    guint8 header[TLS_KEYLOG_INDEX_HEADER_SIZE];
+    guint8 buf[TLS_KEYLOG_INDEX_ENTRY_SIZE];
+    char *data, *line, *nl, *tmp_path;
+    gsize buffered = 0, got;
+    gint64 length = 0;          /* offset in the key log file of data[0] */
+    gboolean skipping = FALSE;  /* in a line too long for the buffer */
+    gboolean ok = TRUE;
+    FILE *out;
+    guint i;
+
+    if (ws_fseek64(keylog_fh, 0, SEEK_SET) == -1) {
+        return FALSE;
+    }
+
+    entries = g_array_new(FALSE, FALSE, sizeof(tls_keylog_index_entry_t));
+    data = (char *)g_malloc(TLS_KEYLOG_INDEX_READ_SIZE);
+    while ((got = fread(data + buffered, 1, TLS_KEYLOG_INDEX_READ_SIZE - buffered, keylog_fh)) > 0) {
+        buffered += got;
+        line = data;
+        while ((nl = (char *)memchr(line, '\n', buffered - (line - data))) != NULL) {
+            gsize linelen = nl + 1 - line;
+            if (!skipping && linelen <= TLS_KEYLOG_INDEX_MAX_LINE &&
+                tls_keylog_index_parse_line(line, linelen, &entry)) {
+                entry.line_len = (guint32)linelen;
+                entry.offset = length + (line - data);
+                g_array_append_val(entries, entry);
+            }
+            skipping = FALSE;
+            line = nl + 1;
+        }
+        if (line == data && buffered == TLS_KEYLOG_INDEX_READ_SIZE) {
+            /* Skip the rest of an overlong line. */
+            skipping = TRUE;
+            line = data + buffered;
+        }
+        length += line - data;
+        buffered -= line - data;
+        memmove(data, line, buffered);
+    }
+    g_free(data);
+    if (ferror(keylog_fh)) {
+        g_array_free(entries, TRUE);
+        return FALSE;
+    }
+
+    g_array_sort(entries, tls_keylog_index_entry_cmp);
+
+    tmp_path = g_strdup_printf("%s.tmp", index_path);
+    out = ws_fopen(tmp_path, "wb");
+    if (!out) {
+        ssl_debug_printf("%s can't write %s: %s\n", G_STRFUNC, tmp_path, g_strerror(errno));
+        g_free(tmp_path);
+        g_array_free(entries, TRUE);
+        return FALSE;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(&header[0], TLS_KEYLOG_INDEX_MAGIC, sizeof(TLS_KEYLOG_INDEX_MAGIC));
+    phtole32(&header[8], TLS_KEYLOG_INDEX_VERSION);
+    phtole32(&header[12], TLS_KEYLOG_INDEX_ENTRY_SIZE);
+    phtole64(&header[16], (guint64)length);
+    phtole64(&header[24], entries->len);
+    if (!tls_keylog_index_hash(keylog_fh, length, &header[32]) ||
+        fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+        ok = FALSE;
+    }
+    for (i = 0; ok && i < entries->len; i++) {
+        const tls_keylog_index_entry_t *e = &g_array_index(entries, tls_keylog_index_entry_t, i);
+        buf[0] = e->label;
+        buf[1] = e->key_len;
+        buf[2] = buf[3] = 0;
+        memcpy(&buf[4], e->key, TLS_KEYLOG_INDEX_KEY_LEN);
+        phtole32(&buf[20], e->line_len);
+        phtole64(&buf[24], e->offset);
+        if (fwrite(buf, 1, sizeof(buf), out) != sizeof(buf)) {
+            ok = FALSE;
+        }
+    }
+    if (fclose(out) == EOF) {
+        ok = FALSE;
+    }
+    if (ok) {
+        /* Windows won't rename over an existing file. */
+        ws_unlink(index_path);
+        ok = ws_rename(tmp_path, index_path) == 0;
+    }
+    if (!ok) {
+        ssl_debug_printf("%s failed to write %s\n", G_STRFUNC, index_path);
+        ws_unlink(tmp_path);
+    }
+    g_free(tmp_path);
+    g_array_free(entries, TRUE);
+    return ok;
+}
+
+/* Check that an index is complete, and for this version of the key log file. */
+static gboolean
+tls_keylog_index_check(FILE *fh, FILE *keylog_fh, gint64 keylog_size,
+                       gint64 *length, guint64 *count)
+{
+    guint8 header[TLS_KEYLOG_INDEX_HEADER_SIZE];
+    guint8 hash[TLS_KEYLOG_INDEX_HASH_SIZE];
+    gint64 index_size;
+
+    if (fread(header, 1, sizeof(header), fh) != sizeof(header) ||
+        memcmp(&header[0], TLS_KEYLOG_INDEX_MAGIC, sizeof(TLS_KEYLOG_INDEX_MAGIC)) != 0 ||
+        pletoh32(&header[8]) != TLS_KEYLOG_INDEX_VERSION ||
+        pletoh32(&header[12]) != TLS_KEYLOG_INDEX_ENTRY_SIZE) {
+        return FALSE;
+    }
+    *length = (gint64)pletoh64(&header[16]);
+    *count = pletoh64(&header[24]);
+
+    if (ws_fseek64(fh, 0, SEEK_END) == -1) {
+        return FALSE;
+    }
+    index_size = ws_ftell64(fh);
+    if (index_size < 0 || *count > G_MAXINT64 / TLS_KEYLOG_INDEX_ENTRY_SIZE ||
+        (guint64)index_size != TLS_KEYLOG_INDEX_HEADER_SIZE + *count * TLS_KEYLOG_INDEX_ENTRY_SIZE) {
+        return FALSE;
+    }
+
+    if (*length < 0 || *length > keylog_size ||
+        !tls_keylog_index_hash(keylog_fh, *length, hash) ||
+        memcmp(hash, &header[32], TLS_KEYLOG_INDEX_HASH_SIZE) != 0) {
+        ssl_debug_printf("%s ignoring stale key log index\n", G_STRFUNC);
+        return FALSE;
+    }
+
+    /* Don't leave too much to be loaded without the index. */
+    if (keylog_size - *length >= (gint64)tls_keylog_index_min_size * 1024 * 1024) {
+        ssl_debug_printf("%s key log index is out of date\n", G_STRFUNC);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Open the index of a key log file, writing it if there isn't an up to
+ * date one.  Returns NULL if the key log file is too small to be indexed
+ * or the index can't be written.
+ */
+static struct tls_keylog_index *
+tls_keylog_index_open(const char *keylog_path)
+{
+    struct tls_keylog_index *idx;
+    FILE *fh, *keylog_fh;
+    char *index_path;
+    gint64 start_time = g_get_monotonic_time();
+    gint64 keylog_size, length = 0;
+    guint64 count = 0;
+    gboolean written = FALSE;
+
+    if (!tls_keylog_index_min_size) {
+        return NULL;
+    }
+
+    keylog_fh = ws_fopen(keylog_path, "rb");
+    if (!keylog_fh) {
+        return NULL;
+    }
+    if (ws_fseek64(keylog_fh, 0, SEEK_END) == -1 ||
+        (keylog_size = ws_ftell64(keylog_fh)) < (gint64)tls_keylog_index_min_size * 1024 * 1024) {
+        fclose(keylog_fh);
+        return NULL;
+    }
+
+    index_path = g_strdup_printf("%s.idx", keylog_path);
+    for (;;) {
+        fh = ws_fopen(index_path, "rb");
+        if (fh && tls_keylog_index_check(fh, keylog_fh, keylog_size, &length, &count)) {
+            break;
+        }
+        if (fh) {
+            fclose(fh);
+            fh = NULL;
+        }
+        if (written || !tls_keylog_index_write(keylog_fh, index_path)) {
+            break;
+        }
+        written = TRUE;
+    }
+    g_free(index_path);
+    if (!fh) {
+        fclose(keylog_fh);
+        return NULL;
+    }
+
+    ssl_debug_printf("%s %s index of %s: %" G_GUINT64_FORMAT " lines covering %" G_GINT64_FORMAT " bytes, in %" G_GINT64_FORMAT " ms\n",
+                     G_STRFUNC, written ? "wrote" : "opened", keylog_path, count, length,
+                     (g_get_monotonic_time() - start_time) / 1000);
+
+    idx = g_new0(struct tls_keylog_index, 1);
+    idx->fh = fh;
+    idx->keylog_fh = keylog_fh;
+    idx->length = length;
+    idx->count = count;
+    return idx;
+}
+
+static void
+tls_keylog_index_close(struct tls_keylog_index *idx)
+{
+    ssl_debug_printf("%s %" G_GUINT64_FORMAT " lookups, %" G_GUINT64_FORMAT " lines loaded from the key log index\n",
+                     G_STRFUNC, idx->lookups, idx->lines_loaded);
+    fclose(idx->fh);
+    fclose(idx->keylog_fh);
+    g_free(idx);
+}
+
+/* Load the lines of the indexed part of the key log file that have a key. */
+static gboolean
+tls_keylog_index_load(const ssl_master_key_map_t *mk_map, GHashTable *ht, const StringInfo *key)
+{
+    struct tls_keylog_index *idx = mk_map->keylog_index;
+    tls_keylog_index_entry_t want, entry;
+    guint8 line[TLS_KEYLOG_INDEX_MAX_LINE];
+    guint64 lo, hi, mid;
+    gboolean loaded = FALSE;
+    guint label;
+
+    if (!idx || key->data_len == 0 || key->data_len > G_MAXUINT8) {
+        return FALSE;
+    }
+    for (label = 0; label < G_N_ELEMENTS(tls_keylog_labels); label++) {
+        if (tls_keylog_label_map(mk_map, label) == ht) {
+            break;
+        }
+    }
+    if (label == G_N_ELEMENTS(tls_keylog_labels)) {
+        /* Not a map filled from the key log file, e.g. session tickets. */
+        return FALSE;
+    }
+
+    memset(&want, 0, sizeof(want));
+    want.label = label;
+    want.key_len = key->data_len;
+    memcpy(want.key, key->data, MIN(key->data_len, TLS_KEYLOG_INDEX_KEY_LEN));
+    idx->lookups++;
+
+    /* Find the first entry for the key... */
+    lo = 0;
+    hi = idx->count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (!tls_keylog_index_get_entry(idx, mid, &entry)) {
+            return FALSE;
+        }
+        if (tls_keylog_index_key_cmp(&entry, &want) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* ...and load the lines in the order they're in the file, so that the
+     * later ones replace the earlier ones, as they would without an index. */
+    for (; lo < idx->count; lo++) {
+        if (!tls_keylog_index_get_entry(idx, lo, &entry) ||
+            tls_keylog_index_key_cmp(&entry, &want) != 0 ||
+            entry.line_len > sizeof(line) ||
+            ws_fseek64(idx->keylog_fh, (gint64)entry.offset, SEEK_SET) == -1 ||
+            fread(line, 1, entry.line_len, idx->keylog_fh) != entry.line_len) {
+            break;
+        }
+        tls_keylog_process_lines(mk_map, line, entry.line_len);
+        idx->lines_loaded++;
+        loaded = TRUE;
+    }
+    return loaded;
+}
+
+StringInfo *
+ssl_master_key_lookup(const ssl_master_key_map_t *mk_map, GHashTable *ht, const StringInfo *key)
+{
+    StringInfo *secret = (StringInfo *)g_hash_table_lookup(ht, key);
+
+    if (!secret && tls_keylog_index_load(mk_map, ht, key)) {
+        secret = (StringInfo *)g_hash_table_lookup(ht, key);
+    }
+    return secret;
+}
+
 void
 ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
-                 const ssl_master_key_map_t *mk_map)
+                 ssl_master_key_map_t *mk_map)
 {
     /* no need to try if no key log file is configured. */
     if (!tls_keylog_filename || !*tls_keylog_filename) {
@@ -6133,14 +6649,29 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
         ssl_debug_printf("%s file got deleted, trying to re-open\n", G_STRFUNC);
         fclose(*keylog_file);
         *keylog_file = NULL;
+        if (mk_map->keylog_index) {
+            tls_keylog_index_close(mk_map->keylog_index);
+            mk_map->keylog_index = NULL;
+        }
     }
 
     if (*keylog_file == NULL) {
-        *keylog_file = ws_fopen(tls_keylog_filename, "r");
+        *keylog_file = ws_fopen(tls_keylog_filename, "rb");
         if (!*keylog_file) {
             ssl_debug_printf("%s failed to open SSL keylog\n", G_STRFUNC);
             return;
         }
+
+        /* The secrets in the indexed part of a large file are loaded when
+         * they're looked up; only read what follows it. */
+        if (!mk_map->keylog_index) {
+            mk_map->keylog_index = tls_keylog_index_open(tls_keylog_filename);
+        }
+        if (mk_map->keylog_index &&
+            ws_fseek64(*keylog_file, mk_map->keylog_index->length, SEEK_SET) == -1) {
+            tls_keylog_index_close(mk_map->keylog_index);
+            mk_map->keylog_index = NULL;
+        }
     }
 
     for (;;) {
@@ -10371,6 +10902,17 @@ ssl_common_register_options(module_t *module, ssl_common_options_t *options, gbo
              "\n"
              "(All fields are in hex notation)",
              &(options->keylog_filename), FALSE);
+
+        prefs_register_obsolete_preference(module, "decryption_cache_size");
+
+        prefs_register_uint_preference(module, "keylog_index_min_size",
+             "Index key log files larger than (MiB)",
+             "Key log files at least this large are indexed, in a file next to them with "
+             "\".idx\" appended to the name, and secrets are read from them as they're "
+             "needed instead of all being loaded whenever the capture is dissected. Lines "
+             "appended to the key log file later are loaded as they're read. "
+             "0 disables indexing.",
+             10, &tls_keylog_index_min_size);
 }
 
 void
@@ -547,6 +547,10 @@ typedef struct {
     GHashTable *tls13_server_appdata;
     GHashTable *tls13_early_exporter;
     GHashTable *tls13_exporter;
+
+    /* Index of a large key log file whose secrets are loaded when they're
+     * looked up, or NULL. */
+    struct tls_keylog_index *keylog_index;
 } ssl_master_key_map_t;
 
 gint ssl_get_keyex_alg(gint cipher);
@@ -755,7 +759,13 @@ tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data,
 /* tries to update the secrets cache from the given filename */
 extern void
 ssl_load_keyfile(const gchar *ssl_keylog_filename, FILE **keylog_file,
-                 const ssl_master_key_map_t *mk_map);
+                 ssl_master_key_map_t *mk_map);
+
+/* Look up a secret in one of the maps of mk_map, loading it from the key log
+ * file index if there is one and the secret isn't loaded yet. */
+extern StringInfo *
+ssl_master_key_lookup(const ssl_master_key_map_t *mk_map, GHashTable *ht,
+                      const StringInfo *key);
 
 #ifdef HAVE_LIBGNUTLS
 /* parse ssl related preferences (private keys and ports association strings) */
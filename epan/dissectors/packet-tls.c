@@ -3876,7 +3876,7 @@ tls13_get_quic_secret(packet_info *pinfo, gboolean is_from_server, int type, gui
         ws_assert_not_reached();
     }
 
-    StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
+    StringInfo *secret = ssl_master_key_lookup(&ssl_master_key_map, key_map, &ssl->client_random);
     if (!secret || secret->data_len < secret_min_len || secret->data_len > secret_max_len) {
         ssl_debug_printf("%s Cannot find QUIC %s of size %d..%d, found bad size %d!\n",
                          G_STRFUNC, label, secret_min_len, secret_max_len, secret ? secret->data_len : 0);
@@ -3989,7 +3989,7 @@ tls13_exporter(packet_info *pinfo, gboolean is_early,
     ssl_load_keyfile(ssl_options.keylog_filename, &ssl_keylog_file, &ssl_master_key_map);
     key_map = is_early ? ssl_master_key_map.tls13_early_exporter
                        : ssl_master_key_map.tls13_exporter;
-    secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl_session->client_random);
+    secret = ssl_master_key_lookup(&ssl_master_key_map, key_map, &ssl_session->client_random);
     if (!secret) {
         return FALSE;
     }
@@ -2326,6 +2326,48 @@ gboolean output_fields_has_cols(output_fields_t* fields)
     return fields->includes_col_fields;
 }
 
+void output_fields_prime_edt(epan_dissect_t *edt, output_fields_t* fields)
+{
+    gsize i;
+    header_field_info *hfinfo;
+
+    ws_assert(fields);
+
+    if (fields->fields == NULL)
+        return;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        hfinfo = proto_registrar_get_byname((const gchar *)g_ptr_array_index(fields->fields, i));
+        /* Fields with the same abbreviation are printed together. */
+        for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+            epan_dissect_prime_with_hfid(edt, hfinfo->id);
+        }
+    }
+}
+
+gboolean output_fields_need_visible_tree(output_fields_t* fields)
+{
+    gsize i;
+    header_field_info *hfinfo;
+
+    ws_assert(fields);
+
+    if (fields->fields == NULL)
+        return FALSE;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        hfinfo = proto_registrar_get_byname((const gchar *)g_ptr_array_index(fields->fields, i));
+        /*
+         * Protocols and text items are printed using their labels, which
+         * are only generated for a visible tree; see get_node_field_value().
+         */
+        if (hfinfo != NULL &&
+            (hfinfo->type == FT_PROTOCOL || hfinfo->id == hf_text_only))
+            return TRUE;
+    }
+    return FALSE;
+}
+
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
     gsize i;
@@ -71,6 +71,14 @@ WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* op
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
 
+/** Prime the epan_dissect_t with the fields to be printed, so that they
+ * are added to the protocol tree even if the tree isn't visible. */
+WS_DLL_PUBLIC void output_fields_prime_edt(epan_dissect_t *edt, output_fields_t* info);
+
+/** Return TRUE if any of the fields to be printed can only be printed
+ * from a visible protocol tree, FALSE if a primed, invisible tree will do. */
+WS_DLL_PUBLIC gboolean output_fields_need_visible_tree(output_fields_t* info);
+
 /*
  * Higher-level packet-printing code.
  */
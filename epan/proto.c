@@ -742,14 +742,25 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 	g_ptr_array_free(ptrs, TRUE);
 }
 
+/*
+ * The nodes and field_infos of a tree are allocated from the packet
+ * scope and are released in bulk with it; only the field values that
+ * own memory of their own need to be cleaned up, and those are
+ * remembered as they're created, so the tree doesn't have to be walked.
+ */
 static void
-proto_tree_free_node(proto_node *node, gpointer data _U_)
+proto_tree_cleanup_fvalues(tree_data_t *tree_data)
 {
-	field_info *finfo  = PNODE_FINFO(node);
+	guint i;
 
-	proto_tree_children_foreach(node, proto_tree_free_node, NULL);
+	if (tree_data->owned_fvalues == NULL)
+		return;
 
-	FVALUE_CLEANUP(&finfo->value);
+	for (i = 0; i < tree_data->owned_fvalues->len; i++) {
+		fvalue_t *fv = (fvalue_t *)g_ptr_array_index(tree_data->owned_fvalues, i);
+		FVALUE_CLEANUP(fv);
+	}
+	g_ptr_array_set_size(tree_data->owned_fvalues, 0);
 }
 
 void
@@ -757,7 +768,7 @@ proto_tree_reset(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_tree_cleanup_fvalues(tree_data);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -781,7 +792,9 @@ proto_tree_free(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_tree_cleanup_fvalues(tree_data);
+	if (tree_data->owned_fvalues)
+		g_ptr_array_free(tree_data->owned_fvalues, TRUE);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -6230,6 +6243,13 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	fvalue_init(&fi->value, fi->hfinfo->type);
 	fi->rep        = NULL;
 
+	/* Remember values that will need to be cleaned up with the tree. */
+	if (fi->value.ftype->free_value) {
+		if (PTREE_DATA(tree)->owned_fvalues == NULL)
+			PTREE_DATA(tree)->owned_fvalues = g_ptr_array_new();
+		g_ptr_array_add(PTREE_DATA(tree)->owned_fvalues, &fi->value);
+	}
+
 	/* add the data source tvbuff */
 	fi->ds_tvb = tvb ? tvb_get_ds_tvb(tvb) : NULL;
 
@@ -7122,6 +7142,7 @@ proto_tree_create_root(packet_info *pinfo)
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
 	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->owned_fvalues = NULL;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -10402,8 +10423,8 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in tree.
  * This only works if the hfindex was "primed" before the dissection
  * took place, as we just pass back the already-created GPtrArray*.
- * The caller should *not* free the GPtrArray*; proto_tree_free_node()
- * handles that. */
+ * The caller should *not* free the GPtrArray*; proto_tree_reset() and
+ * proto_tree_free() handle that. */
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
@@ -862,6 +862,7 @@ typedef struct {
     gboolean             fake_protocols;
     guint                count;
     struct _packet_info *pinfo;
+    GPtrArray           *owned_fvalues; /**< field values that own memory and must be cleaned up */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -10,6 +10,8 @@
 
 #include "config.h"
 
+#define WS_LOG_DOMAIN LOG_DOMAIN_EPAN
+
 #include <string.h>
 
 #include <epan/packet.h>
@@ -19,6 +21,25 @@
 
 #include <wsutil/str_util.h>
 #include <wsutil/ws_assert.h>
+#include <wsutil/wslog.h>
+
+/*
+ * Reassembled data shorter than this is copied into a single buffer
+ * even when it could be made a composite of the fragments' data; for
+ * short PDUs the copy costs less than the composite's bookkeeping, and
+ * than the copy a dissector reading across fragments would force later.
+ */
+#define REASSEMBLE_COMPOSITE_MIN_LEN	4096
+
+/*
+ * How the data of completed reassemblies has been put together since
+ * the registered reassembly tables were last initialized.
+ */
+static guint64 reassembly_count;
+static guint64 reassembly_bytes;
+static guint64 reassembly_copied_bytes;
+static guint64 reassembly_referenced_bytes;
+static guint64 reassembly_flattened_base;
 
 /*
  * Functions for reassembly tables where the endpoint addresses, and a
@@ -943,8 +964,14 @@ LINK_FRAG(fragment_head *fd_head,fragment_item *fd)
 {
 	fragment_item *fd_i;
 
-	/* add fragment to list, keep list sorted */
-	for(fd_i= fd_head; fd_i->next;fd_i=fd_i->next) {
+	/* add fragment to list, keep list sorted.
+	 * Fragments mostly arrive in order, so if this one goes after the
+	 * end of the contiguous data, start looking from there instead of
+	 * from the start of the list. */
+	fd_i = fd_head;
+	if (fd_head->contig_last && fd_head->contig_last->offset <= fd->offset)
+		fd_i = fd_head->contig_last;
+	for(; fd_i->next;fd_i=fd_i->next) {
 		if (fd->offset < fd_i->next->offset )
 			break;
 	}
@@ -969,6 +996,158 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	fd_i->next = fd;
 }
 
+/*
+ * Update the amount of contiguous data available from the start of the
+ * reassembly after fd has been linked into the (sorted) list.
+ *
+ * This is the same as walking the whole list and extending the contiguous
+ * data by each fragment that starts at or before its end, but as fragments
+ * are never taken out of the list the result only ever grows, so we can
+ * carry on from where the last call left off.
+ */
+static void
+fragment_update_contiguous(fragment_head *fd_head, fragment_item *fd)
+{
+	fragment_item *fd_i;
+	guint32 max = fd_head->contig_len;
+
+	/* fd may have gone in before contig_last, in which case the loop
+	 * below won't see it */
+	if ((fd->offset <= max) && ((fd->offset+fd->len) > max)) {
+		max = fd->offset+fd->len;
+	}
+
+	fd_i = fd_head->contig_last ? fd_head->contig_last->next : fd_head->next;
+	for (; fd_i; fd_i=fd_i->next) {
+		if (fd_i->offset > max) {
+			/* a gap; as the list is sorted, nothing after this
+			 * can extend the contiguous data either */
+			break;
+		}
+		if ((fd_i->offset+fd_i->len) > max) {
+			max = fd_i->offset+fd_i->len;
+		}
+		fd_head->contig_last = fd_i;
+	}
+
+	fd_head->contig_len = max;
+}
+
+/*
+ * Once all the data of a reassembly has arrived, make the reassembled
+ * data a composite of the fragments' own data instead of copying it all
+ * into a new buffer.  That's only done if the fragments follow on from
+ * one another with no gaps, overlaps or data past the end; anything else
+ * is left to be copied by the caller, which flags the problems as it
+ * goes.  Returns TRUE if it was done, in which case the fragments' data
+ * now belongs to the reassembled data, as does the data of an earlier
+ * reassembly of this PDU if any of it was used, and *old_tvb_data is
+ * then set to NULL.
+ */
+static gboolean
+fragment_defragment_composite(fragment_head *fd_head, tvbuff_t **old_tvb_data)
+{
+	fragment_item *fd_i;
+	fragment_item *last_fd = NULL;
+	tvbuff_t *composite;
+	guint32 dfpos = 0;
+	guint pieces = 0;
+	gboolean uses_old = FALSE;
+
+	if (fd_head->datalen < REASSEMBLE_COMPOSITE_MIN_LEN)
+		return FALSE;
+
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (!fd_i->len)
+			continue;
+		if (fd_i->offset != dfpos || !fd_i->tvb_data ||
+		    fd_i->len > fd_head->datalen - dfpos)
+			return FALSE;
+		if (fd_i->flags & FD_SUBSET_TVB) {
+			/*
+			 * This is data from an earlier reassembly of
+			 * this PDU.  If that was a composite, copy,
+			 * rather than nesting composites deeper each
+			 * time a PDU is extended.
+			 */
+			if ((fd_head->flags & FD_COMPOSITE_TVB) ||
+			    tvb_captured_length(fd_i->tvb_data) < fd_i->len)
+				return FALSE;
+			uses_old = TRUE;
+		}
+		last_fd = fd_i;
+		dfpos += fd_i->len;
+		pieces++;
+	}
+	if (dfpos != fd_head->datalen)
+		return FALSE;
+
+	if (pieces == 1 && !uses_old) {
+		/* Nothing to put together; use the fragment as it is. */
+		fd_head->tvb_data = last_fd->tvb_data;
+		fd_head->flags &= ~FD_COMPOSITE_TVB;
+		last_fd->tvb_data = NULL;
+		return TRUE;
+	}
+
+	composite = tvb_new_composite_standalone();
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (!fd_i->len)
+			continue;
+		if (fd_i->flags & FD_SUBSET_TVB) {
+			/* The subset is freed along with the earlier data. */
+			tvb_composite_append(composite,
+			    tvb_new_subset_length(fd_i->tvb_data, 0, fd_i->len));
+			fd_i->flags &= ~FD_SUBSET_TVB;
+		} else {
+			tvb_composite_append(composite, fd_i->tvb_data);
+			tvb_composite_own(composite, fd_i->tvb_data);
+		}
+		fd_i->tvb_data = NULL;
+	}
+	if (uses_old) {
+		tvb_composite_own(composite, *old_tvb_data);
+		*old_tvb_data = NULL;
+	}
+	tvb_composite_finalize(composite);
+
+	fd_head->tvb_data = composite;
+	fd_head->flags |= FD_COMPOSITE_TVB;
+	return TRUE;
+}
+
+/*
+ * If the reassembled data is a composite of the fragments' data that has
+ * since been made contiguous, because a dissector read across fragments,
+ * the table is holding that data twice.  Keep the contiguous copy, and
+ * free the composite, along with the fragments' data, once the frame in
+ * tvb has been dissected, as the previous dissection of a frame with the
+ * reassembled data may still be reading it through the composite until
+ * then.
+ */
+static void
+fragment_release_flattened(fragment_head *fd_head, tvbuff_t *tvb)
+{
+	tvbuff_t *flattened;
+
+	/*
+	 * While a reassembly is being extended, the fragments can hold
+	 * subsets of its earlier data, so only do this once it's done.
+	 */
+	if ((fd_head->flags & (FD_DEFRAGMENTED|FD_COMPOSITE_TVB)) !=
+	    (FD_DEFRAGMENTED|FD_COMPOSITE_TVB))
+		return;
+
+	flattened = tvb_composite_take_flattened(fd_head->tvb_data);
+	if (!flattened)
+		return;
+	tvb_add_to_chain(tvb, fd_head->tvb_data);
+	fd_head->tvb_data = flattened;
+	fd_head->flags &= ~FD_COMPOSITE_TVB;
+	reassembly_referenced_bytes -= fd_head->datalen;
+	reassembly_copied_bytes += fd_head->datalen;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -997,7 +1176,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 {
 	fragment_item *fd;
 	fragment_item *fd_i;
-	guint32 max, dfpos, fraglen, overlap;
+	guint32 dfpos, fraglen, overlap;
 	tvbuff_t *old_tvb_data;
 	guint8 *data;
 
@@ -1011,6 +1190,8 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->contig_last = NULL;
+	fd->contig_len = 0;
 
 	/*
 	 * Are we adding to an already-completed reassembly?
@@ -1135,6 +1316,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		}
 		/* it was just an overlap, link it and return */
 		LINK_FRAG(fd_head,fd);
+		fragment_update_contiguous(fd_head,fd);
 		return TRUE;
 	}
 
@@ -1149,6 +1331,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	}
 	fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
 	LINK_FRAG(fd_head,fd);
+	fragment_update_contiguous(fd_head,fd);
 
 
 	if( !(fd_head->flags & FD_DATALEN_SET) ){
@@ -1161,23 +1344,10 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 	/*
 	 * Check if we have received the entire fragment.
-	 * This is easy since the list is sorted and the head is faked.
-	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
-	 * fragments that don't start before or at the end of the
-	 * previous fragment, i.e. fragments that have a gap between
-	 * them and the previous fragment.)
+	 * fragment_update_contiguous() has kept track of the amount of
+	 * contiguous data that's available.
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
-
-	if (max < (fd_head->datalen)) {
+	if (fd_head->contig_len < (fd_head->datalen)) {
 		/*
 		 * The amount of contiguous data we have is less than the
 		 * amount of data we're trying to reassemble, so we haven't
@@ -1191,6 +1361,14 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
+	reassembly_count++;
+	reassembly_bytes += fd_head->datalen;
+	if (fragment_defragment_composite(fd_head, &old_tvb_data)) {
+		reassembly_referenced_bytes += fd_head->datalen;
+		goto defragmented;
+	}
+	fd_head->flags &= ~FD_COMPOSITE_TVB;
+	reassembly_copied_bytes += fd_head->datalen;
 	data = (guint8 *) g_malloc(fd_head->datalen);
 	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
@@ -1317,6 +1495,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		}
 	}
 
+defragmented:
 	if (old_tvb_data)
 		tvb_add_to_chain(tvb, old_tvb_data);
 	/* mark this packet as defragmented.
@@ -1355,6 +1534,8 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 	DISSECTOR_ASSERT(tvb_bytes_exist(tvb, offset, frag_data_len));
 
 	fd_head = lookup_fd_head(table, pinfo, id, data, NULL);
+	if (fd_head != NULL)
+		fragment_release_flattened(fd_head, tvb);
 
 #if 0
 	/* debug output of associated fragments. */
@@ -1565,7 +1746,10 @@ fragment_add_check(reassembly_table *table, tvbuff_t *tvb, const int offset,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		if (fd_head != NULL)
+			fragment_release_flattened(fd_head, tvb);
+		return fd_head;
 	}
 
 	/* Looks up a key in the GHashTable, returning the original key and the associated value
@@ -1639,6 +1823,9 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
+	reassembly_count++;
+	reassembly_bytes += size;
+	reassembly_copied_bytes += size;
 	data = (guint8 *) g_malloc(size);
 	fd_head->tvb_data = tvb_new_real_data(data, size, size);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
@@ -1753,6 +1940,8 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->contig_last = NULL;
+	fd->contig_len = 0;
 
 	/* fd_head->frame is the maximum of the frame numbers of all the
 	 * fragments added to the reassembly. */
@@ -2510,6 +2699,8 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
 		fd_head->tvb_data = NULL;
 		fd_head->error = NULL;
+		fd_head->contig_last = NULL;
+		fd_head->contig_len = 0;
 
 		insert_fd_head(table, fd_head, pinfo, id, data);
 	}
@@ -2871,6 +3062,11 @@ reassembly_table_init_reg_table(gpointer p, gpointer user_data _U_)
 static void
 reassembly_table_init_reg_tables(void)
 {
+	reassembly_count = 0;
+	reassembly_bytes = 0;
+	reassembly_copied_bytes = 0;
+	reassembly_referenced_bytes = 0;
+	reassembly_flattened_base = tvb_composite_get_flattened_bytes();
 	g_list_foreach(reassembly_table_list, reassembly_table_init_reg_table, NULL);
 }
 
@@ -2884,9 +3080,30 @@ reassembly_table_cleanup_reg_table(gpointer p, gpointer user_data _U_)
 static void
 reassembly_table_cleanup_reg_tables(void)
 {
+	reassembly_memory_stats stats;
+
+	reassembly_get_memory_stats(&stats);
+	if (stats.reassemblies) {
+		ws_debug("%" G_GUINT64_FORMAT " reassemblies, %" G_GUINT64_FORMAT
+		    " bytes: %" G_GUINT64_FORMAT " copied, %" G_GUINT64_FORMAT
+		    " referenced, %" G_GUINT64_FORMAT " flattened",
+		    stats.reassemblies, stats.reassembled_bytes,
+		    stats.copied_bytes, stats.referenced_bytes,
+		    stats.flattened_bytes);
+	}
 	g_list_foreach(reassembly_table_list, reassembly_table_cleanup_reg_table, NULL);
 }
 
+void
+reassembly_get_memory_stats(reassembly_memory_stats *stats)
+{
+	stats->reassemblies = reassembly_count;
+	stats->reassembled_bytes = reassembly_bytes;
+	stats->copied_bytes = reassembly_copied_bytes;
+	stats->referenced_bytes = reassembly_referenced_bytes;
+	stats->flattened_bytes = tvb_composite_get_flattened_bytes() - reassembly_flattened_base;
+}
+
 void reassembly_tables_init(void)
 {
 	register_init_routine(&reassembly_table_init_reg_tables);
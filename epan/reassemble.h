@@ -49,6 +49,10 @@
  */
 #define FD_DATALEN_SET		0x0400
 
+/* only in fd_head: tvb_data is a composite of the fragments' data, rather
+ * than a copy of it */
+#define FD_COMPOSITE_TVB	0x0800
+
 typedef struct _fragment_item {
 	struct _fragment_item *next;
 	guint32 frame;			/* XXX - does this apply to reassembly heads? */
@@ -83,6 +87,14 @@ typedef struct _fragment_item {
 	 * reassembly and for the fragments in a reassembly.
 	 */
 	const char *error;
+	/**
+	 * Only used in the reassembly head by fragment_add() and friends:
+	 * the last fragment in the list that is part of the contiguous data
+	 * at the start of the reassembly, and the length of that data, so
+	 * that adding a fragment doesn't have to walk the whole list.
+	 */
+	struct _fragment_item *contig_last;
+	guint32 contig_len;
 } fragment_item, fragment_head;
 
 
@@ -462,6 +474,24 @@ WS_DLL_PUBLIC gboolean
 show_fragment_seq_tree(fragment_head *ipfd_head, const fragment_items *fit,
     proto_tree *tree, packet_info *pinfo, tvbuff_t *tvb, proto_item **fi);
 
+/*
+ * How the data of completed reassemblies was put together, since the
+ * registered reassembly tables were last initialized (normally, since
+ * the current capture file was opened).
+ */
+typedef struct {
+	guint64 reassemblies;		/**< reassemblies completed */
+	guint64 reassembled_bytes;	/**< total length of their data */
+	guint64 copied_bytes;		/**< bytes copied into a new buffer, or
+					     whose flattened copy has since
+					     replaced the fragments' buffers */
+	guint64 referenced_bytes;	/**< bytes left in the fragments' buffers */
+	guint64 flattened_bytes;	/**< bytes copied later to read across fragments */
+} reassembly_memory_stats;
+
+WS_DLL_PUBLIC void
+reassembly_get_memory_stats(reassembly_memory_stats *stats);
+
 /* Initialize internal structures
  */
 extern void reassembly_tables_init(void);
@@ -104,6 +104,7 @@ static struct _fd_flags {
     {FD_OVERLAPCONFLICT      ,"OC"},
     {FD_MULTIPLETAILS        ,"MT"},
     {FD_TOOLONGFRAGMENT      ,"TL"},
+    {FD_COMPOSITE_TVB        ,"CT"},
 };
 #define N_FD_FLAGS (signed)(sizeof(fd_flags)/sizeof(struct _fd_flags))
 
@@ -2386,6 +2387,194 @@ test_fragment_add_duplicate_conflict(void)
     }
 }
 
+/* Fragments that make up a large datagram with no gaps or overlaps are
+ * referenced by a composite tvbuff rather than copied.  We add:
+ *    seq_off   frame  tvb_off   len        (initial) more_frags
+ *    -------   -----  -------   ---        --------------------
+ *        0       1        0     BIG_LEN    true
+ *  BIG_LEN       2  BIG_LEN     BIG_LEN    true
+ *  2*BIG_LEN     3  2*BIG_LEN   BIG_LEN    false
+ *  3*BIG_LEN     4  3*BIG_LEN   BIG_LEN    false  (after partial reassembly)
+ *  4*BIG_LEN     5  4*BIG_LEN   BIG_LEN    false  (after partial reassembly)
+ *
+ * The first extension uses data from a composite, so it's copied; the
+ * second uses data from that copy, so it's a composite again.
+ */
+#define BIG_LEN 2048
+
+static void
+test_fragment_add_composite(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    reassembly_memory_stats before, after;
+    guint8 *big_data;
+    tvbuff_t *big_tvb;
+    guint i;
+
+    printf("Starting test test_fragment_add_composite\n");
+
+    big_data = (guint8 *)g_malloc(5*BIG_LEN);
+    for (i = 0; i < 5*BIG_LEN; i++) {
+        big_data[i] = (guint8)(i * 7);
+    }
+    big_tvb = tvb_new_real_data(big_data, 5*BIG_LEN, 5*BIG_LEN);
+
+    reassembly_get_memory_stats(&before);
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 0, &pinfo, 14, NULL,
+                         0, BIG_LEN, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, BIG_LEN, &pinfo, 14, NULL,
+                         BIG_LEN, BIG_LEN, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 3;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 2*BIG_LEN, &pinfo, 14, NULL,
+                         2*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(3*BIG_LEN,fd_head->datalen);
+    ASSERT_EQ(3,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_COMPOSITE_TVB,fd_head->flags);
+    for (fd = fd_head->next; fd; fd = fd->next) {
+        ASSERT_EQ(0,fd->flags);
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+
+    reassembly_get_memory_stats(&after);
+    ASSERT_EQ(1,after.reassemblies - before.reassemblies);
+    ASSERT_EQ(0,after.copied_bytes - before.copied_bytes);
+    ASSERT_EQ(3*BIG_LEN,after.referenced_bytes - before.referenced_bytes);
+
+    /* test the actual reassembly; reading within a fragment, or searching
+     * across fragments, shouldn't copy anything */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,BIG_LEN+10,big_data+BIG_LEN+10,100));
+    ASSERT_EQ(BIG_LEN+2,tvb_find_guint8(fd_head->tvb_data,BIG_LEN-4,8,big_data[BIG_LEN+2]));
+    reassembly_get_memory_stats(&after);
+    ASSERT_EQ(0,after.flattened_bytes - before.flattened_bytes);
+    /* check it a fragment at a time, so that it stays a composite */
+    for (i = 0; i < 3; i++) {
+        ASSERT(!tvb_memeql(fd_head->tvb_data,i*BIG_LEN,big_data+i*BIG_LEN,BIG_LEN));
+    }
+
+    /* now extend it */
+    fragment_set_partial_reassembly(&test_reassembly_table, &pinfo, 14, NULL);
+    pinfo.num = 4;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 3*BIG_LEN, &pinfo, 14, NULL,
+                         3*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(4*BIG_LEN,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    for (fd = fd_head->next; fd; fd = fd->next) {
+        ASSERT_EQ(0,fd->flags);
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,big_data,4*BIG_LEN));
+
+    /* and again */
+    fragment_set_partial_reassembly(&test_reassembly_table, &pinfo, 14, NULL);
+    pinfo.num = 5;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 4*BIG_LEN, &pinfo, 14, NULL,
+                         4*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(5*BIG_LEN,fd_head->datalen);
+    ASSERT_EQ(5,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_COMPOSITE_TVB,fd_head->flags);
+    for (fd = fd_head->next; fd; fd = fd->next) {
+        ASSERT_EQ(0,fd->flags);
+        ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    }
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,big_data,5*BIG_LEN));
+
+    reassembly_get_memory_stats(&after);
+    ASSERT_EQ(3,after.reassemblies - before.reassemblies);
+    ASSERT_EQ(4*BIG_LEN,after.copied_bytes - before.copied_bytes);
+    ASSERT_EQ(8*BIG_LEN,after.referenced_bytes - before.referenced_bytes);
+
+    if (debug) {
+        print_fragment_table();
+    }
+
+    /* frees the data of the first reassembly, which was chained to it */
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
+
+/* Test case for a composite reassembly that's been made contiguous by a
+ * read across fragments.  The next time the reassembly is looked up, the
+ * table should keep only the contiguous copy, and count it as copied.
+ */
+static void
+test_fragment_add_composite_flattened(void)
+{
+    fragment_head *fd_head;
+    reassembly_memory_stats before, after;
+    guint8 *big_data;
+    tvbuff_t *big_tvb;
+    guint i;
+
+    printf("Starting test test_fragment_add_composite_flattened\n");
+
+    big_data = (guint8 *)g_malloc(3*BIG_LEN);
+    for (i = 0; i < 3*BIG_LEN; i++) {
+        big_data[i] = (guint8)(i * 11);
+    }
+    big_tvb = tvb_new_real_data(big_data, 3*BIG_LEN, 3*BIG_LEN);
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 0, &pinfo, 15, NULL,
+                         0, BIG_LEN, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, BIG_LEN, &pinfo, 15, NULL,
+                         BIG_LEN, BIG_LEN, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 3;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 2*BIG_LEN, &pinfo, 15, NULL,
+                         2*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_COMPOSITE_TVB,fd_head->flags);
+
+    /* read across the fragments */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,big_data,3*BIG_LEN));
+    reassembly_get_memory_stats(&before);
+
+    /* dissect the last frame again */
+    pinfo.fd->visited = 1;
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 2*BIG_LEN, &pinfo, 15, NULL,
+                         2*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT_EQ(3*BIG_LEN,tvb_captured_length(fd_head->tvb_data));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,big_data,3*BIG_LEN));
+
+    reassembly_get_memory_stats(&after);
+    ASSERT_EQ(3*BIG_LEN,after.copied_bytes - before.copied_bytes);
+    ASSERT_EQ(3*BIG_LEN,before.referenced_bytes - after.referenced_bytes);
+
+    /* and again; there's nothing left to release */
+    fd_head=fragment_add(&test_reassembly_table, big_tvb, 2*BIG_LEN, &pinfo, 15, NULL,
+                         2*BIG_LEN, BIG_LEN, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    reassembly_get_memory_stats(&before);
+    ASSERT_EQ(after.copied_bytes,before.copied_bytes);
+    pinfo.fd->visited = 0;
+
+    if (debug) {
+        print_fragment_table();
+    }
+
+    /* frees the composite and the fragments' data, which were chained to it */
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
+
 /**********************************************************************************
  *
  * fragment_add_check
@@ -3267,6 +3456,65 @@ test_fragment_add_check_duplicate_conflict(void)
         print_fragment_table();
     }
 }
+/* Test case for fragment_add_check with a large stream made up of many
+ * segments, each of which overlaps the previous one by a single byte.
+ * This used to take time quadratic in the number of segments; a few
+ * thousand segments are enough to make that noticeable.
+ */
+#define LARGE_STREAM_SEGS       4000
+#define LARGE_STREAM_SEG_LEN    1460
+
+static void
+test_fragment_add_check_large_overlapping(void)
+{
+    fragment_head *fd_head = NULL;
+    tvbuff_t *seg_tvb;
+    guint8 seg_data[LARGE_STREAM_SEG_LEN];
+    const guint8 *reassembled;
+    guint32 n_segs, frag_offset, i;
+
+    printf("Starting test test_fragment_add_check_large_overlapping\n");
+
+    /* Every segment carries the same data, which repeats with a period of
+     * one byte less than the segment length, so that the overlapping bytes
+     * always agree and the stream byte at offset N is N % period. */
+    for (i = 0; i < LARGE_STREAM_SEG_LEN; i++) {
+        seg_data[i] = (guint8)(i % (LARGE_STREAM_SEG_LEN - 1));
+    }
+    seg_tvb = tvb_new_real_data(seg_data, LARGE_STREAM_SEG_LEN, LARGE_STREAM_SEG_LEN);
+
+    n_segs = LARGE_STREAM_SEGS;
+    for (i = 0, frag_offset = 0; i < n_segs; i++, frag_offset += LARGE_STREAM_SEG_LEN - 1) {
+        pinfo.num = i + 1;
+        fd_head=fragment_add_check(&test_reassembly_table, seg_tvb, 0, &pinfo, 12,
+                                   NULL, frag_offset, LARGE_STREAM_SEG_LEN, i + 1 < n_segs);
+        if (i + 1 < n_segs) {
+            ASSERT_EQ_POINTER(NULL,fd_head);
+        }
+    }
+
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(n_segs,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    /* check the contents of the structure */
+    ASSERT_EQ(n_segs,fd_head->frame);
+    ASSERT_EQ(n_segs * (LARGE_STREAM_SEG_LEN - 1) + 1,fd_head->datalen);
+    ASSERT_EQ(n_segs,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP,fd_head->flags);
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+
+    /* test the actual reassembly */
+    reassembled = tvb_get_ptr(fd_head->tvb_data, 0, fd_head->datalen);
+    for (i = 0; i < fd_head->datalen; i++) {
+        if (reassembled[i] != (guint8)(i % (LARGE_STREAM_SEG_LEN - 1))) {
+            ASSERT_EQ(i % (LARGE_STREAM_SEG_LEN - 1),reassembled[i]);
+        }
+    }
+
+    tvb_free(seg_tvb);
+}
+
 /**********************************************************************************
  *
  * main
@@ -3305,6 +3553,8 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_duplicate_middle,
         test_fragment_add_duplicate_last,
         test_fragment_add_duplicate_conflict,
+        test_fragment_add_composite,
+        test_fragment_add_composite_flattened,
         test_simple_fragment_add_check,              /* frag table only   */
 #if 0
         test_fragment_add_check_partial_reassembly,
@@ -3315,6 +3565,7 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_check_duplicate_last,
 #endif
         test_fragment_add_check_duplicate_conflict,
+        test_fragment_add_check_large_overlapping,
     };
 
     /* a tvbuff for testing with */
@@ -1377,10 +1377,17 @@ epan_memmem(const guint8 *haystack, guint haystack_len,
         return NULL;
     }
 
+    /*
+     * Let memchr() find the candidate positions; it's usually vectorized
+     * and much faster than checking the first byte one position at a time.
+     */
     for (begin = haystack ; begin <= last_possible; ++begin) {
-        if (begin[0] == needle[0] &&
-                !memcmp(&begin[1], needle + 1,
-                    needle_len - 1)) {
+        begin = (const guint8 *)memchr(begin, needle[0],
+                                       last_possible - begin + 1);
+        if (begin == NULL) {
+            return NULL;
+        }
+        if (!memcmp(&begin[1], needle + 1, needle_len - 1)) {
             return begin;
         }
     }
@@ -78,6 +78,12 @@ typedef struct _tap_packet_t {
 static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
 static guint tap_packet_index;
 
+typedef enum {
+	TAP_FILTER_NOT_APPLIED,
+	TAP_FILTER_PASSED,
+	TAP_FILTER_FAILED
+} tap_filter_result_t;
+
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
 	int tap_id;
@@ -86,6 +92,11 @@ typedef struct _tap_listener_t {
 	guint flags;
 	gchar *fstring;
 	dfilter_t *code;
+	/* Listener with the same filter whose result is shared by this one,
+	 * or NULL if this listener evaluates its own filter. */
+	struct _tap_listener_t *filter_leader;
+	/* Result of evaluating the filter on the current packet */
+	tap_filter_result_t filter_result;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -95,6 +106,52 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/*
+ * Several tap listeners often use the same filter (e.g. the graphs of an
+ * I/O graph, or the statistics dialogs opened with the current display
+ * filter).  The result of a filter only depends on the protocol tree, so
+ * evaluate each distinct filter string only once per packet and let the
+ * other listeners with the same filter share its result.  This has to be
+ * redone whenever a listener or its filter changes.
+ */
+static void
+tap_update_filter_leaders(void)
+{
+	tap_listener_t *tl, *tl2;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		tl->filter_leader=NULL;
+		tl->filter_result=TAP_FILTER_NOT_APPLIED;
+		if(!tl->code){
+			continue;
+		}
+		for(tl2=tap_listener_queue;tl2!=tl;tl2=tl2->next){
+			if(tl2->code && tl2->filter_leader==NULL &&
+			    !strcmp(tl2->fstring, tl->fstring)){
+				tl->filter_leader=tl2;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Return TRUE if the packet passes the filter of the listener, evaluating
+ * the filter only if neither this listener nor the one it shares its
+ * filter with has already done so for this packet.
+ */
+static gboolean
+tap_listener_apply_filter(tap_listener_t *tl, epan_dissect_t *edt)
+{
+	tap_listener_t *owner = tl->filter_leader ? tl->filter_leader : tl;
+
+	if(owner->filter_result==TAP_FILTER_NOT_APPLIED){
+		owner->filter_result = dfilter_apply_edt(owner->code, edt) ?
+		    TAP_FILTER_PASSED : TAP_FILTER_FAILED;
+	}
+	return owner->filter_result==TAP_FILTER_PASSED;
+}
+
 static GSList *tap_plugins = NULL;
 
 #ifdef HAVE_PLUGINS
@@ -272,7 +329,7 @@ void tap_build_interesting (epan_dissect_t *edt)
 	/* loop over all tap listeners and build the list of all
 	   interesting hf_fields */
 	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
+		if(tl->code && !tl->filter_leader){
 			epan_dissect_prime_with_dfilter(edt, tl->code);
 		}
 	}
@@ -319,6 +376,11 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
+	/* No filter has been applied to this packet yet. */
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		tl->filter_result=TAP_FILTER_NOT_APPLIED;
+	}
+
 	/* loop over all tap listeners and call the listener callback
 	   for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
@@ -349,7 +411,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 					 * packet passes.
 					 */
 					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
+						if (!tap_listener_apply_filter(tl, edt)){
 							/* The packet didn't
 							 * pass the filter. */
 							continue;
@@ -573,6 +635,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_update_filter_leaders();
 
 	return NULL;
 }
@@ -613,6 +676,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		if(fstring){
 			if(!dfilter_compile(fstring, &code, &err_msg)){
 				tl->fstring=NULL;
+				tap_update_filter_leaders();
 				error_string = g_string_new("");
 				g_string_printf(error_string,
 						 "Filter \"%s\" is invalid - %s",
@@ -623,6 +687,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		}
 		tl->fstring=g_strdup(fstring);
 		tl->code=code;
+		tap_update_filter_leaders();
 	}
 
 	return NULL;
@@ -655,6 +720,7 @@ tap_listeners_dfilter_recompile(void)
 		}
 		tl->code=code;
 	}
+	tap_update_filter_leaders();
 }
 
 /* this function removes a tap listener
@@ -686,6 +752,7 @@ remove_tap_listener(void *tapdata)
 		}
 	}
 	free_tap_listener(tl);
+	tap_update_filter_leaders();
 }
 
 /*
@@ -207,6 +207,27 @@ WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
 
+/** Create an empty composite tvbuff that isn't added to the chain of its
+ * first member, so that it can outlive the frame its members came from.
+ * The caller must keep its members around until it's freed, for example
+ * by handing them over with tvb_composite_own(). */
+WS_DLL_PUBLIC tvbuff_t *tvb_new_composite_standalone(void);
+
+/** Hand a tvbuff chain over to a composite tvbuff created with
+ * tvb_new_composite_standalone(); the chain is freed along with it. */
+WS_DLL_PUBLIC void tvb_composite_own(tvbuff_t *tvb, tvbuff_t *chain);
+
+/** If a composite tvbuff created with tvb_new_composite_standalone() has
+ * been made contiguous, because data spanning more than one member was
+ * asked for, return a new tvbuff that takes over that contiguous copy of
+ * its data, and NULL otherwise.  The composite goes on reading from the
+ * copy, so it must be freed before the new tvbuff. */
+WS_DLL_PUBLIC tvbuff_t *tvb_composite_take_flattened(tvbuff_t *tvb);
+
+/** Get the number of bytes copied so far to make composite tvbuffs
+ * contiguous, when data spanning more than one member was asked for. */
+WS_DLL_PUBLIC guint64 tvb_composite_get_flattened_bytes(void);
+
 
 /* Get amount of captured data in the buffer (which is *NOT* necessarily the
  * length of the packet). You probably want tvb_reported_length instead. */
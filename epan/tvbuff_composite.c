@@ -18,12 +18,26 @@
 typedef struct {
 	GSList		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* The members, and the offsets at which
+	 * they start and end, for looking them
+	 * up with a binary search; set up by
+	 * tvb_composite_finalize(). */
+	tvbuff_t	**members;
+	guint		num_members;
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* TRUE if the composite isn't attached to
+	 * the chain of its first member, in which
+	 * case it frees the chains in "owned". */
+	gboolean	standalone;
+	GSList		*owned;
+
+	/* TRUE if the contiguous copy of the data
+	 * in real_data has been handed over by
+	 * tvb_composite_take_flattened(). */
+	gboolean	flattened_taken;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -32,17 +46,28 @@ struct tvb_composite {
 	tvb_comp_t	composite;
 };
 
+/* Bytes copied to make composite tvbuffs contiguous */
+static guint64 composite_flattened_bytes;
+
 static void
 composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	GSList	   *slist;
 
 	g_slist_free(composite->tvbs);
 
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
-	g_free((gpointer)tvb->real_data);
+	if (!composite->flattened_taken)
+		g_free((gpointer)tvb->real_data);
+
+	for (slist = composite->owned; slist != NULL; slist = slist->next) {
+		tvb_free_chain((tvbuff_t *)slist->data);
+	}
+	g_slist_free(composite->owned);
 }
 
 static guint
@@ -51,37 +76,50 @@ composite_offset(const tvbuff_t *tvb _U_, const guint counter)
 	return counter;
 }
 
+/* Find the member that abs_offset is in; returns num_members if
+ * abs_offset is at (or past) the end of the composite. */
+static guint
+composite_member(const tvb_comp_t *composite, const guint abs_offset)
+{
+	guint low = 0, high = composite->num_members;
+
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (composite->end_offsets[mid] < abs_offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+static void *
+composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length);
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -94,8 +132,9 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 	else {
 		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
 		void *real_data = g_malloc(tvb->length);
-		tvb_memcpy(tvb, real_data, 0, tvb->length);
+		composite_memcpy(tvb, real_data, 0, tvb->length);
 		tvb->real_data = (const guint8 *)real_data;
+		composite_flattened_bytes += tvb->length;
 		return tvb->real_data + abs_offset;
 	}
 
@@ -108,63 +147,96 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	composite = &composite_tvb->composite;
+	i = composite_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
-	member_offset = abs_offset - composite->start_offsets[i];
+	/* Copy the part that's in the first member tvb, then
+	 * iterate across the other member tvb's, copying their
+	 * portions until we have copied all data.
+	 */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(abs_length,
+		    (guint) tvb_captured_length_remaining(member_tvb, member_offset));
+
+		/* We can't make progress with a member_length of zero. */
+		DISSECTOR_ASSERT(member_length > 0);
 
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target      += member_length;
+		abs_offset  += member_length;
+		abs_length  -= member_length;
+		i++;
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+	return _target;
+}
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+
+	/* Search each member in turn rather than making
+	 * the whole composite contiguous. */
+	for (i = composite_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		tvbuff_t *member_tvb = composite->members[i];
+		guint member_offset = abs_offset - composite->start_offsets[i];
+		guint member_limit = MIN(limit,
+		    (guint) tvb_captured_length_remaining(member_tvb, member_offset));
+		gint result;
+
+		result = tvb_find_guint8(member_tvb, member_offset, member_limit, needle);
+		if (result != -1)
+			return (gint) (composite->start_offsets[i] + result);
+		abs_offset += member_limit;
+		limit      -= member_limit;
+	}
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+	return -1;
+}
 
-		return target;
+static gint
+composite_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+
+	for (i = composite_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		tvbuff_t *member_tvb = composite->members[i];
+		guint member_offset = abs_offset - composite->start_offsets[i];
+		guint member_limit = MIN(limit,
+		    (guint) tvb_captured_length_remaining(member_tvb, member_offset));
+		gint result;
+
+		result = tvb_ws_mempbrk_pattern_guint8(member_tvb, member_offset, member_limit, pattern, found_needle);
+		if (result != -1)
+			return (gint) (composite->start_offsets[i] + result);
+		abs_offset += member_limit;
+		limit      -= member_limit;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -174,8 +246,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_ws_mempbrk_pattern_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
@@ -199,12 +271,82 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = NULL;
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->standalone	 = FALSE;
+	composite->owned	 = NULL;
+	composite->flattened_taken = FALSE;
+
+	return tvb;
+}
+
+/*
+ * Standalone composite tvb
+ *
+ * A standalone composite TVB isn't added to the chain of its first member,
+ * so it can be kept and freed on its own; its members need not be part of
+ * the same chain, but the caller must make sure that they outlive it, which
+ * it can do by handing their chains over with tvb_composite_own().  This is
+ * for data that outlives the dissection of the frame its members came from,
+ * such as reassembled data.
+ */
+tvbuff_t *
+tvb_new_composite_standalone(void)
+{
+	tvbuff_t *tvb = tvb_new_composite();
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	composite_tvb->composite.standalone = TRUE;
 
 	return tvb;
 }
 
+void
+tvb_composite_own(tvbuff_t *tvb, tvbuff_t *chain)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite;
+
+	DISSECTOR_ASSERT(tvb && chain);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
+
+	composite = &composite_tvb->composite;
+	DISSECTOR_ASSERT(composite->standalone);
+
+	composite->owned = g_slist_prepend(composite->owned, chain);
+}
+
+tvbuff_t *
+tvb_composite_take_flattened(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite;
+	tvbuff_t   *flattened;
+
+	DISSECTOR_ASSERT(tvb && tvb->ops == &tvb_composite_ops);
+
+	composite = &composite_tvb->composite;
+	DISSECTOR_ASSERT(composite->standalone);
+	if (!tvb->real_data || composite->flattened_taken)
+		return NULL;
+
+	/* The composite keeps reading from the copy, so the new
+	 * tvbuff must outlive it. */
+	flattened = tvb_new_real_data(tvb->real_data, tvb->length, tvb->reported_length);
+	tvb_set_free_cb(flattened, g_free);
+	composite->flattened_taken = TRUE;
+
+	return flattened;
+}
+
+guint64
+tvb_composite_get_flattened_bytes(void)
+{
+	return composite_flattened_bytes;
+}
+
 void
 tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 {
@@ -223,7 +365,7 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	composite->tvbs = g_slist_append(composite->tvbs, member);
 
 	/* Attach the composite TVB to the first TVB only. */
-	if (!composite->tvbs->next) {
+	if (!composite->standalone && !composite->tvbs->next) {
 		tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb);
 	}
 }
@@ -246,7 +388,7 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	composite->tvbs = g_slist_prepend(composite->tvbs, member);
 
 	/* Attach the composite TVB to the first TVB only. */
-	if (!composite->tvbs->next) {
+	if (!composite->standalone && !composite->tvbs->next) {
 		tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb);
 	}
 }
@@ -276,12 +418,15 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = (tvbuff_t *)slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -591,6 +591,9 @@ cf_read(capture_file *cf, gboolean reloading)
     float   progbar_val;
     gchar   status_str[100];
 
+    /* Overlap reading and decompressing the file with dissection. */
+    wtap_start_read_ahead(cf->provider.wth);
+
     while ((wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info,
             &data_offset))) {
       if (size >= 0) {
@@ -1178,6 +1181,25 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
                                 &cf->provider.ref, cf->provider.prev_dis);
   cf->provider.prev_cap = fdata;
 
+  if (edt == NULL) {
+    /*
+     * The caller has determined that nothing needs the results of
+     * dissecting this frame, so don't read or dissect it; with no
+     * display filter every frame is displayed.
+     */
+    ws_assert(dfcode == NULL);
+    fdata->passed_dfilter = 1;
+    cf->displayed_count++;
+    if (add_to_packet_list)
+      packet_list_append(cinfo, fdata);
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+    return;
+  }
+
   if (dfcode != NULL) {
       epan_dissect_prime_with_dfilter(edt, dfcode);
   }
@@ -1363,8 +1385,13 @@ merge_callback(merge_event event, int num _U_,
             float  progbar_val;
             gint64 file_pos = 0;
             /* Get the sum of the seek positions in all of the files. */
-            for (i = 0; i < in_file_count; i++)
-              file_pos += wtap_read_so_far(in_files[i].wth);
+            for (i = 0; i < in_file_count; i++) {
+              /* Files waiting for their turn or at EOF are closed. */
+              if (in_files[i].wth != NULL)
+                file_pos += wtap_read_so_far(in_files[i].wth);
+              else if (in_files[i].state == AT_EOF)
+                file_pos += in_files[i].size;
+            }
 
             progbar_val = (gfloat) file_pos / (gfloat) cb_data->f_len;
             if (progbar_val > 1.0f) {
@@ -1641,6 +1668,7 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   dfilter_t  *dfcode;
   column_info *cinfo;
   gboolean    create_proto_tree;
+  gboolean    need_dissection, dissect_frame;
   guint       tap_flags;
   gboolean    add_to_packet_list = FALSE;
   gboolean    compiled _U_;
@@ -1733,6 +1761,17 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     add_to_packet_list = TRUE;
   }
 
+  /*
+   * If we're not redissecting, every frame has already been through
+   * the sequential pass and had its state recorded.  If, in addition,
+   * we have no display filter and no tap listeners that want to see
+   * the packets (e.g., the display filter was just cleared), nothing
+   * will look at the dissection, so skip reading and dissecting the
+   * frames entirely; every frame will be displayed.
+   */
+  need_dissection = redissect || dfcode != NULL ||
+                    tap_listeners_require_dissection();
+
   /* We don't yet know which will be the first and last frames displayed. */
   cf->first_displayed = 0;
   cf->last_displayed = 0;
@@ -1858,7 +1897,11 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata, &rec, &buf))
+    /* A frame that hasn't been dissected yet (e.g., because an earlier
+       redissection was aborted) still needs its state built. */
+    dissect_frame = need_dissection || !fdata->visited;
+
+    if (dissect_frame && !cf_read_record(cf, fdata, &rec, &buf))
       break; /* error reading the frame */
 
     /* If the previous frame is displayed, and we haven't yet seen the
@@ -1869,8 +1912,8 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &rec, &buf,
+    add_packet_to_packet_list(fdata, cf, dissect_frame ? &edt : NULL,
+                                    dfcode, cinfo, &rec, &buf,
                                     add_to_packet_list);
 
     /* If this frame is displayed, and this is the first frame we've
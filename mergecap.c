@@ -128,7 +128,7 @@ merge_callback(merge_event event, int num,
     case MERGE_EVENT_INPUT_FILES_OPENED:
       for (i = 0; i < in_file_count; i++) {
         fprintf(stderr, "mergecap: %s is type %s.\n", in_files[i].filename,
-                wtap_file_type_subtype_description(wtap_file_type_subtype(in_files[i].wth)));
+                wtap_file_type_subtype_description(in_files[i].file_type_subtype));
       }
       break;
 
@@ -140,9 +140,9 @@ merge_callback(merge_event event, int num,
          */
         int first_frame_type, this_frame_type;
 
-        first_frame_type = wtap_file_encap(in_files[0].wth);
+        first_frame_type = in_files[0].file_encap;
         for (i = 1; i < in_file_count; i++) {
-          this_frame_type = wtap_file_encap(in_files[i].wth);
+          this_frame_type = in_files[i].file_encap;
           if (first_frame_type != this_frame_type) {
             fprintf(stderr, "mergecap: multiple frame encapsulation types detected\n");
             fprintf(stderr, "          defaulting to WTAP_ENCAP_PER_PACKET\n");
@@ -19,10 +19,12 @@
 
 #include <wiretap/wtap.h>
 
+#include <ui/clopts_common.h>
 #include <ui/cmdarg_err.h>
 #include <ui/exit_codes.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
+#include <wsutil/glib-compat.h>
 #include <wsutil/privileges.h>
 #include <cli_main.h>
 #include <ui/version_info.h>
@@ -49,6 +51,12 @@ print_usage(FILE *output)
     fprintf(output, "\n");
     fprintf(output, "Options:\n");
     fprintf(output, "  -n        don't write to output file if the input file is ordered.\n");
+    fprintf(output, "  -m <frames per run>\n");
+    fprintf(output, "            sort runs of this many frames into temporary files,\n");
+    fprintf(output, "            then merge them into the output file.\n");
+    fprintf(output, "  -s <max skew>\n");
+    fprintf(output, "            only reorder frames that are at most this many seconds\n");
+    fprintf(output, "            (with up to nanosecond precision) out of order.\n");
     fprintf(output, "  -h        display this help and exit.\n");
     fprintf(output, "  -v        print version information and exit.\n");
 }
@@ -131,6 +139,587 @@ frames_compare(gconstpointer a, gconstpointer b)
     return nstime_cmp(time1, time2);
 }
 
+/*
+ * A frame kept in memory, for the modes that read the input file once,
+ * from start to end, without seeking back (so that it can be a pipe).
+ */
+typedef struct BufferedFrame_t {
+    wtap_rec     rec;
+    guint8       *data;
+    guint        num;
+
+    nstime_t     frame_time;
+} BufferedFrame_t;
+
+/* Length of the data wtap_read() put in the buffer for a record */
+static guint32
+rec_data_length(const wtap_rec *rec)
+{
+    switch (rec->rec_type) {
+        case REC_TYPE_PACKET:
+            return rec->rec_header.packet_header.caplen;
+        case REC_TYPE_FT_SPECIFIC_EVENT:
+        case REC_TYPE_FT_SPECIFIC_REPORT:
+            return rec->rec_header.ft_specific_header.record_len;
+        case REC_TYPE_SYSCALL:
+            return rec->rec_header.syscall_header.event_filelen;
+        case REC_TYPE_SYSTEMD_JOURNAL_EXPORT:
+            return rec->rec_header.systemd_journal_export_header.record_len;
+        case REC_TYPE_CUSTOM_BLOCK:
+            return rec->rec_header.custom_block_header.length;
+        default:
+            return 0;
+    }
+}
+
+/* Make a copy of the record just read; the record's block is taken over */
+static BufferedFrame_t *
+buffered_frame_new(wtap_rec *rec, Buffer *buf, guint num)
+{
+    BufferedFrame_t *frame = g_new(BufferedFrame_t, 1);
+
+    wtap_rec_init(&frame->rec);
+    frame->rec.rec_type = rec->rec_type;
+    frame->rec.presence_flags = rec->presence_flags;
+    frame->rec.ts = rec->ts;
+    frame->rec.tsprec = rec->tsprec;
+    frame->rec.rec_header = rec->rec_header;
+    frame->rec.block = rec->block;
+    frame->rec.block_was_modified = rec->block_was_modified;
+    rec->block = NULL;
+
+    frame->data = (guint8 *)g_memdup2(ws_buffer_start_ptr(buf),
+                                      rec_data_length(rec));
+    frame->num = num;
+    if (rec->presence_flags & WTAP_HAS_TS) {
+        frame->frame_time = rec->ts;
+    } else {
+        nstime_set_unset(&frame->frame_time);
+    }
+    return frame;
+}
+
+static void
+buffered_frame_free(BufferedFrame_t *frame)
+{
+    wtap_rec_cleanup(&frame->rec);
+    g_free(frame->data);
+    g_free(frame);
+}
+
+static void
+buffered_frame_write(BufferedFrame_t *frame, wtap_dumper *pdh,
+                     const char *infile, const char *outfile,
+                     int file_type_subtype)
+{
+    int    err;
+    gchar  *err_info;
+
+    DEBUG_PRINT("\nDumping frame %u\n", frame->num);
+
+    if (!wtap_dump(pdh, &frame->rec, frame->data, &err, &err_info)) {
+        cfile_write_failure_message(infile, outfile, err, err_info, frame->num,
+                                    file_type_subtype);
+        exit(1);
+    }
+}
+
+/* As frames_compare(), with frames that have the same time stamp kept in
+   the order in which they were read. */
+static int
+buffered_frames_compare(gconstpointer a, gconstpointer b)
+{
+    const BufferedFrame_t *frame1 = *(const BufferedFrame_t *const *) a;
+    const BufferedFrame_t *frame2 = *(const BufferedFrame_t *const *) b;
+    int cmp;
+
+    cmp = nstime_cmp(&frame1->frame_time, &frame2->frame_time);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (frame1->num > frame2->num) - (frame1->num < frame2->num);
+}
+
+/* Binary min-heap in a GPtrArray, ordered by compare (called as for
+   g_ptr_array_sort(), with pointers to the elements). */
+static void
+heap_push(GPtrArray *heap, gpointer item, GCompareFunc compare)
+{
+    guint i;
+
+    g_ptr_array_add(heap, item);
+    for (i = heap->len - 1; i > 0; ) {
+        guint parent = (i - 1) / 2;
+        gpointer tmp;
+
+        if (compare(&heap->pdata[i], &heap->pdata[parent]) >= 0) {
+            break;
+        }
+        tmp = heap->pdata[i];
+        heap->pdata[i] = heap->pdata[parent];
+        heap->pdata[parent] = tmp;
+        i = parent;
+    }
+}
+
+static gpointer
+heap_pop(GPtrArray *heap, GCompareFunc compare)
+{
+    gpointer top = heap->pdata[0];
+    guint i = 0;
+
+    heap->pdata[0] = heap->pdata[heap->len - 1];
+    g_ptr_array_set_size(heap, heap->len - 1);
+    for (;;) {
+        guint smallest = i;
+        guint child = 2 * i + 1;
+        gpointer tmp;
+
+        if (child < heap->len &&
+            compare(&heap->pdata[child], &heap->pdata[smallest]) < 0) {
+            smallest = child;
+        }
+        child++;
+        if (child < heap->len &&
+            compare(&heap->pdata[child], &heap->pdata[smallest]) < 0) {
+            smallest = child;
+        }
+        if (smallest == i) {
+            break;
+        }
+        tmp = heap->pdata[i];
+        heap->pdata[i] = heap->pdata[smallest];
+        heap->pdata[smallest] = tmp;
+        i = smallest;
+    }
+    return top;
+}
+
+/*
+ * Sliding window: keep frames in a heap until a frame more than max_skew
+ * later than them has been read, and write them out in time stamp order.
+ * Only as many frames as are read in max_skew are held in memory; a frame
+ * that turns up later than that is written out as soon as it's read, and
+ * counted in late_count.
+ */
+static gboolean
+reorder_window(wtap *wth, wtap_dumper *pdh, const nstime_t *max_skew,
+               const char *infile, const char *outfile,
+               guint *frame_count, guint *wrong_order_count, guint *late_count)
+{
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    GPtrArray *heap = g_ptr_array_new();
+    nstime_t prev_time, latest, threshold, last_written;
+    gboolean have_prev = FALSE;
+
+    nstime_set_unset(&latest);
+    nstime_set_unset(&threshold);
+    nstime_set_unset(&last_written);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+        BufferedFrame_t *frame = buffered_frame_new(&rec, &buf, ++(*frame_count));
+
+        if (have_prev && nstime_cmp(&frame->frame_time, &prev_time) < 0) {
+            (*wrong_order_count)++;
+        }
+        prev_time = frame->frame_time;
+        have_prev = TRUE;
+
+        if (!nstime_is_unset(&frame->frame_time)) {
+            if (nstime_cmp(&frame->frame_time, &last_written) < 0) {
+                (*late_count)++;
+            }
+            if (nstime_cmp(&frame->frame_time, &latest) > 0) {
+                latest = frame->frame_time;
+                nstime_delta(&threshold, &latest, max_skew);
+            }
+        }
+
+        /* Write out every frame that no frame still to come should
+           precede.  Frames with no time stamp go out straight away. */
+        heap_push(heap, frame, buffered_frames_compare);
+        while (heap->len > 0) {
+            BufferedFrame_t *top = (BufferedFrame_t *)heap->pdata[0];
+
+            if (!nstime_is_unset(&top->frame_time) &&
+                nstime_cmp(&top->frame_time, &threshold) > 0) {
+                break;
+            }
+            heap_pop(heap, buffered_frames_compare);
+            buffered_frame_write(top, pdh, infile, outfile,
+                                 wtap_file_type_subtype(wth));
+            if (!nstime_is_unset(&top->frame_time)) {
+                last_written = top->frame_time;
+            }
+            buffered_frame_free(top);
+        }
+        wtap_rec_reset(&rec);
+    }
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    if (err != 0) {
+        /* Print a message noting that the read failed somewhere along the line. */
+        cfile_read_failure_message(infile, err, err_info);
+    }
+
+    /* Write out what's left */
+    while (heap->len > 0) {
+        BufferedFrame_t *frame = (BufferedFrame_t *)heap_pop(heap, buffered_frames_compare);
+
+        buffered_frame_write(frame, pdh, infile, outfile,
+                             wtap_file_type_subtype(wth));
+        buffered_frame_free(frame);
+    }
+    g_ptr_array_free(heap, TRUE);
+    return TRUE;
+}
+
+/* A sorted run in a temporary file, being merged into the output file */
+typedef struct RunReader_t {
+    wtap         *wth;
+    const char   *filename;
+    guint        index;
+    wtap_rec     rec;
+    Buffer       buf;
+
+    nstime_t     frame_time;
+} RunReader_t;
+
+/* Runs are numbered in the order in which they were read, so frames with
+   the same time stamp stay in the order in which they were read. */
+static int
+run_readers_compare(gconstpointer a, gconstpointer b)
+{
+    const RunReader_t *run1 = *(const RunReader_t *const *) a;
+    const RunReader_t *run2 = *(const RunReader_t *const *) b;
+    int cmp;
+
+    cmp = nstime_cmp(&run1->frame_time, &run2->frame_time);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (run1->index > run2->index) - (run1->index < run2->index);
+}
+
+/* Read the next frame of a run; returns FALSE at the end of the run, or
+   on error, with *err set. */
+static gboolean
+run_reader_next(RunReader_t *run, int *err)
+{
+    gchar *err_info;
+    gint64 data_offset;
+
+    wtap_rec_reset(&run->rec);
+    if (!wtap_read(run->wth, &run->rec, &run->buf, err, &err_info,
+                   &data_offset)) {
+        if (*err != 0) {
+            cfile_read_failure_message(run->filename, *err, err_info);
+        }
+        return FALSE;
+    }
+    if (run->rec.presence_flags & WTAP_HAS_TS) {
+        run->frame_time = run->rec.ts;
+    } else {
+        nstime_set_unset(&run->frame_time);
+    }
+    return TRUE;
+}
+
+/*
+ * Maximum number of runs to merge at once.  If there are more runs than
+ * that, they're merged in several passes, each of which merges groups of
+ * this many runs into longer runs in new temporary files, so that huge
+ * inputs don't need one open file per run (as with merge.c's
+ * MERGE_MAX_OPEN_FILES).
+ */
+#define REORDER_MAX_OPEN_RUNS   256
+
+/* Open a new temporary file for a run; its name is added to run_filenames */
+static wtap_dumper *
+run_dump_open(wtap *wth, GPtrArray *run_filenames)
+{
+    wtap_dump_params run_params;
+    wtap_dumper *run_pdh;
+    char *run_filename;
+    int err;
+    gchar *err_info;
+
+    wtap_dump_params_init(&run_params, wth);
+    /* The decryption secrets are written to the output file as they're
+       read from the input file. */
+    wtap_dump_params_discard_decryption_secrets(&run_params);
+    run_pdh = wtap_dump_open_tempfile(&run_filename, "reordercap",
+                                      wtap_file_type_subtype(wth),
+                                      WTAP_UNCOMPRESSED, &run_params,
+                                      &err, &err_info);
+    g_free(run_params.idb_inf);
+    run_params.idb_inf = NULL;
+    wtap_dump_params_cleanup(&run_params);
+    if (run_pdh == NULL) {
+        cfile_dump_open_failure_message(run_filename ? run_filename : "temporary file",
+                                        err, err_info,
+                                        wtap_file_type_subtype(wth));
+        g_free(run_filename);
+        return NULL;
+    }
+    g_ptr_array_add(run_filenames, run_filename);
+    return run_pdh;
+}
+
+/* Sort a run of frames and write it to a new temporary file */
+static gboolean
+run_spill(wtap *wth, GPtrArray *run, GPtrArray *run_filenames,
+          const char *infile)
+{
+    wtap_dumper *run_pdh;
+    const char *run_filename;
+    int err;
+    gchar *err_info;
+    guint i;
+    gboolean ok = TRUE;
+
+    g_ptr_array_sort(run, buffered_frames_compare);
+
+    run_pdh = run_dump_open(wth, run_filenames);
+    if (run_pdh == NULL) {
+        return FALSE;
+    }
+    run_filename = (const char *)run_filenames->pdata[run_filenames->len - 1];
+
+    DEBUG_PRINT("Writing run of %u frames to %s\n", run->len, run_filename);
+    for (i = 0; i < run->len; i++) {
+        BufferedFrame_t *frame = (BufferedFrame_t *)run->pdata[i];
+
+        buffered_frame_write(frame, run_pdh, infile, run_filename,
+                             wtap_file_type_subtype(wth));
+        buffered_frame_free(frame);
+    }
+    g_ptr_array_set_size(run, 0);
+
+    if (!wtap_dump_close(run_pdh, &err, &err_info)) {
+        cfile_close_failure_message(run_filename, err, err_info);
+        ok = FALSE;
+    }
+    return ok;
+}
+
+/* Merge count sorted runs, starting with run first, into pdh */
+static gboolean
+runs_merge(GPtrArray *run_filenames, guint first, guint count,
+           wtap_dumper *pdh, const char *outfile, int file_type_subtype)
+{
+    RunReader_t *runs = g_new0(RunReader_t, count);
+    GPtrArray *heap = g_ptr_array_new();
+    int err;
+    gchar *err_info;
+    guint num = 0;
+    guint i;
+    gboolean ok = TRUE;
+
+    for (i = 0; i < count; i++) {
+        RunReader_t *run = &runs[i];
+
+        run->filename = (const char *)run_filenames->pdata[first + i];
+        run->index = i;
+        wtap_rec_init(&run->rec);
+        ws_buffer_init(&run->buf, 1514);
+    }
+    for (i = 0; i < count; i++) {
+        RunReader_t *run = &runs[i];
+
+        run->wth = wtap_open_offline(run->filename, WTAP_TYPE_AUTO, &err,
+                                     &err_info, FALSE);
+        if (run->wth == NULL) {
+            cfile_open_failure_message(run->filename, err, err_info);
+            ok = FALSE;
+            break;
+        }
+        if (run_reader_next(run, &err)) {
+            heap_push(heap, run, run_readers_compare);
+        } else if (err != 0) {
+            ok = FALSE;
+            break;
+        }
+    }
+
+    while (ok && heap->len > 0) {
+        RunReader_t *run = (RunReader_t *)heap_pop(heap, run_readers_compare);
+
+        num++;
+        if (!wtap_dump(pdh, &run->rec, ws_buffer_start_ptr(&run->buf),
+                       &err, &err_info)) {
+            cfile_write_failure_message(run->filename, outfile, err, err_info,
+                                        num, file_type_subtype);
+            exit(1);
+        }
+        if (run_reader_next(run, &err)) {
+            heap_push(heap, run, run_readers_compare);
+        } else if (err != 0) {
+            ok = FALSE;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (runs[i].wth != NULL) {
+            wtap_close(runs[i].wth);
+        }
+        wtap_rec_cleanup(&runs[i].rec);
+        ws_buffer_free(&runs[i].buf);
+    }
+    g_ptr_array_free(heap, TRUE);
+    g_free(runs);
+    return ok;
+}
+
+/*
+ * Merge the sorted runs into the output file, first merging groups of
+ * REORDER_MAX_OPEN_RUNS runs into new temporary files for as long as
+ * there are more runs than that.  Consecutive runs are merged together,
+ * in order, so frames with the same time stamp stay in the order in
+ * which they were read.  On return, run_filenames holds the names of the
+ * temporary files that are left.
+ */
+static gboolean
+runs_merge_all(wtap *wth, GPtrArray **run_filenames, wtap_dumper *pdh,
+               const char *outfile)
+{
+    int err;
+    gchar *err_info;
+    guint first, count, i;
+    gboolean ok = TRUE;
+
+    while (ok && (*run_filenames)->len > REORDER_MAX_OPEN_RUNS) {
+        GPtrArray *merged_filenames = g_ptr_array_new_with_free_func(g_free);
+
+        DEBUG_PRINT("Merging %u runs into %u\n", (*run_filenames)->len,
+                    ((*run_filenames)->len + REORDER_MAX_OPEN_RUNS - 1) / REORDER_MAX_OPEN_RUNS);
+        for (first = 0; ok && first < (*run_filenames)->len; first += count) {
+            wtap_dumper *run_pdh;
+            const char *run_filename;
+
+            count = MIN((*run_filenames)->len - first, REORDER_MAX_OPEN_RUNS);
+            run_pdh = run_dump_open(wth, merged_filenames);
+            if (run_pdh == NULL) {
+                ok = FALSE;
+                break;
+            }
+            run_filename = (const char *)merged_filenames->pdata[merged_filenames->len - 1];
+            ok = runs_merge(*run_filenames, first, count, run_pdh,
+                            run_filename, wtap_file_type_subtype(wth));
+            if (!wtap_dump_close(run_pdh, &err, &err_info)) {
+                cfile_close_failure_message(run_filename, err, err_info);
+                ok = FALSE;
+            }
+            /* Those runs aren't needed any more */
+            for (i = first; i < first + count; i++) {
+                ws_unlink((const char *)(*run_filenames)->pdata[i]);
+            }
+        }
+        if (ok) {
+            g_ptr_array_free(*run_filenames, TRUE);
+            *run_filenames = merged_filenames;
+        } else {
+            for (i = 0; i < merged_filenames->len; i++) {
+                ws_unlink((const char *)merged_filenames->pdata[i]);
+            }
+            g_ptr_array_free(merged_filenames, TRUE);
+        }
+    }
+    if (ok) {
+        ok = runs_merge(*run_filenames, 0, (*run_filenames)->len, pdh,
+                        outfile, wtap_file_type_subtype(wth));
+    }
+    return ok;
+}
+
+/*
+ * External merge sort: read runs of run_size frames, sort each of them
+ * in memory and write it to a temporary file, then merge the runs.  If
+ * all of the input fits in one run, it's written straight to the output
+ * file.
+ */
+static gboolean
+reorder_external(wtap *wth, wtap_dumper *pdh, guint run_size,
+                 const char *infile, const char *outfile,
+                 guint *frame_count, guint *wrong_order_count)
+{
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info;
+    gint64 data_offset;
+    GPtrArray *run = g_ptr_array_sized_new(run_size);
+    GPtrArray *run_filenames = g_ptr_array_new_with_free_func(g_free);
+    nstime_t prev_time;
+    gboolean have_prev = FALSE;
+    gboolean ok = TRUE;
+    guint i;
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+        BufferedFrame_t *frame = buffered_frame_new(&rec, &buf, ++(*frame_count));
+
+        if (have_prev && nstime_cmp(&frame->frame_time, &prev_time) < 0) {
+            (*wrong_order_count)++;
+        }
+        prev_time = frame->frame_time;
+        have_prev = TRUE;
+
+        g_ptr_array_add(run, frame);
+        if (run->len == run_size) {
+            if (!run_spill(wth, run, run_filenames, infile)) {
+                ok = FALSE;
+                break;
+            }
+        }
+        wtap_rec_reset(&rec);
+    }
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    if (ok && err != 0) {
+        /* Print a message noting that the read failed somewhere along the line. */
+        cfile_read_failure_message(infile, err, err_info);
+    }
+
+    if (ok) {
+        if (run_filenames->len == 0) {
+            g_ptr_array_sort(run, buffered_frames_compare);
+            for (i = 0; i < run->len; i++) {
+                BufferedFrame_t *frame = (BufferedFrame_t *)run->pdata[i];
+
+                buffered_frame_write(frame, pdh, infile, outfile,
+                                     wtap_file_type_subtype(wth));
+                buffered_frame_free(frame);
+            }
+            g_ptr_array_set_size(run, 0);
+        } else {
+            if (run->len > 0) {
+                ok = run_spill(wth, run, run_filenames, infile);
+            }
+            if (ok) {
+                ok = runs_merge_all(wth, &run_filenames, pdh, outfile);
+            }
+        }
+    }
+
+    for (i = 0; i < run->len; i++) {
+        buffered_frame_free((BufferedFrame_t *)run->pdata[i]);
+    }
+    g_ptr_array_free(run, TRUE);
+    for (i = 0; i < run_filenames->len; i++) {
+        ws_unlink((const char *)run_filenames->pdata[i]);
+    }
+    g_ptr_array_free(run_filenames, TRUE);
+    return ok;
+}
+
 /*
  * General errors and warnings are reported with an console message
  * in reordercap.
@@ -179,8 +768,14 @@ main(int argc, char *argv[])
     int err;
     gchar *err_info;
     gint64 data_offset;
+    guint frame_count = 0;
     guint wrong_order_count = 0;
+    guint late_count = 0;
     gboolean write_output_regardless = TRUE;
+    guint run_size = 0;
+    gboolean have_max_skew = FALSE;
+    nstime_t max_skew;
+    FILE *summary;
     guint i;
     wtap_dump_params params;
     int                          ret = EXIT_SUCCESS;
@@ -231,11 +826,23 @@ main(int argc, char *argv[])
     wtap_init(TRUE);
 
     /* Process the options first */
-    while ((opt = ws_getopt_long(argc, argv, "hnv", long_options, NULL)) != -1) {
+    while ((opt = ws_getopt_long(argc, argv, "hm:ns:v", long_options, NULL)) != -1) {
         switch (opt) {
+            case 'm':
+                run_size = get_positive_int(ws_optarg, "number of frames per run");
+                break;
             case 'n':
                 write_output_regardless = FALSE;
                 break;
+            case 's':
+            {
+                double skew = get_positive_double(ws_optarg, "maximum time skew");
+
+                max_skew.secs = (time_t)skew;
+                max_skew.nsecs = (int)((skew - (double)max_skew.secs) * 1000000000.0);
+                have_max_skew = TRUE;
+                break;
+            }
             case 'h':
                 show_help_header("Reorder timestamps of input file frames into output file.");
                 print_usage(stdout);
@@ -262,6 +869,22 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (run_size > 0 && have_max_skew) {
+        cmdarg_err("-m and -s can't be used together.");
+        ret = INVALID_OPTION;
+        goto clean_exit;
+    }
+    if (!write_output_regardless && (run_size > 0 || have_max_skew)) {
+        /* Those modes write the output as they go along. */
+        cmdarg_err("-n can't be used with -m or -s.");
+        ret = INVALID_OPTION;
+        goto clean_exit;
+    }
+
+    /* Don't mix the summary in with the frames if writing to the
+       standard output. */
+    summary = strcmp(outfile, "-") == 0 ? stderr : stdout;
+
     /* Open infile */
     /* TODO: if reordercap is ever changed to give the user a choice of which
        open_routine reader to use, then the following needs to change. */
@@ -294,6 +917,28 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (run_size > 0 || have_max_skew) {
+        gboolean ok;
+
+        if (run_size > 0) {
+            ok = reorder_external(wth, pdh, run_size, infile, outfile,
+                                  &frame_count, &wrong_order_count);
+        } else {
+            ok = reorder_window(wth, pdh, &max_skew, infile, outfile,
+                                &frame_count, &wrong_order_count, &late_count);
+        }
+        if (!ok) {
+            ret = OUTPUT_FILE_ERROR;
+        }
+        fprintf(summary, "%u frames, %u out of order", frame_count,
+                wrong_order_count);
+        if (have_max_skew) {
+            fprintf(summary, ", %u later than the maximum skew", late_count);
+        }
+        fprintf(summary, "\n");
+        goto close_output;
+    }
+
     /* Allocate the array of frame pointers. */
     frames = g_ptr_array_new();
 
@@ -327,7 +972,7 @@ main(int argc, char *argv[])
       cfile_read_failure_message(infile, err, err_info);
     }
 
-    printf("%u frames, %u out of order\n", frames->len, wrong_order_count);
+    fprintf(summary, "%u frames, %u out of order\n", frames->len, wrong_order_count);
 
     /* Sort the frames */
     if (wrong_order_count > 0) {
@@ -350,12 +995,13 @@ main(int argc, char *argv[])
     ws_buffer_free(&buf);
 
     if (!write_output_regardless && (wrong_order_count == 0)) {
-        printf("Not writing output file because input file is already in order.\n");
+        fprintf(summary, "Not writing output file because input file is already in order.\n");
     }
 
     /* Free the whole array */
     g_ptr_array_free(frames, TRUE);
 
+close_output:
     /* Close outfile */
     if (!wtap_dump_close(pdh, &err, &err_info)) {
         cfile_close_failure_message(outfile, err, err_info);
@@ -129,6 +129,11 @@ def cmd_editcap(program):
     return program('editcap')
 
 
+@fixtures.fixture(scope='session')
+def cmd_reordercap(program):
+    return program('reordercap')
+
+
 @fixtures.fixture(scope='session')
 def cmd_wireshark(program):
     return program('wireshark')
@@ -182,6 +187,8 @@ def features(cmd_tshark, make_env):
         have_gnutls='with GnuTLS' in tshark_v,
         have_pkcs11='and PKCS #11 support' in tshark_v,
         have_brotli='with brotli' in tshark_v,
+        have_lz4='with LZ4' in tshark_v,
+        have_zstd='with Zstandard' in tshark_v,
         have_plugins='binary plugins supported' in tshark_v,
     )
 
@@ -9,6 +9,7 @@
 '''Decryption tests'''
 
 import os.path
+import random
 import shutil
 import subprocess
 import subprocesstest
@@ -596,6 +597,86 @@ class case_decrypt_tls(subprocesstest.SubprocessTestCase):
             )).stdout_str
         self.assertEqual('example.com\t\n\t200\nexample.net\t\n\t200\n', output)
 
+    def test_tls13_keylog_index(self, cmd_tshark, dirs, features, capture_file):
+        '''TLS 1.3 with an indexed key log file'''
+        if not features.have_libgcrypt16:
+            self.skipTest('Requires GCrypt 1.6 or later.')
+        with open(os.path.join(dirs.key_dir, 'tls13-rfc8446.keys')) as f:
+            key_lines = [line for line in f.read().splitlines() if line]
+        key_file = self.filename_from_id('tls13-rfc8446.keys')
+        index_file = self.filename_from_id('tls13-rfc8446.keys.idx')
+        expected = [
+            r'5|/first|',
+            r'6||Request for /first, version TLSv1.3, Early data: no\n',
+            r'8|/early|',
+            r'10||Request for /early, version TLSv1.3, Early data: yes\n',
+            r'12|/second|',
+            r'13||Request for /second, version TLSv1.3, Early data: yes\n',
+        ]
+
+        def padding(seed):
+            '''Over a MiB of secrets for other sessions, and wrong secrets
+            for this one, which the right ones that come later replace.'''
+            rng = random.Random(seed)
+            lines = []
+            while sum(len(line) + 1 for line in lines) < 1100 * 1024:
+                label = rng.choice(('CLIENT_RANDOM', 'CLIENT_HANDSHAKE_TRAFFIC_SECRET',
+                                    'SERVER_TRAFFIC_SECRET_0', 'EXPORTER_SECRET'))
+                lines.append('{} {:064x} {:096x}'.format(label, rng.getrandbits(256),
+                                                         rng.getrandbits(384)))
+            for line in key_lines:
+                label, client_random, secret = line.split()
+                lines.insert(rng.randrange(len(lines)),
+                             '{} {} {}'.format(label, client_random, '0' * len(secret)))
+            return lines
+
+        def write_keys(lines, mode='w'):
+            with open(key_file, mode) as f:
+                f.write('\n'.join(lines) + '\n')
+
+        def decrypt(use_index):
+            proc = self.assertRun((cmd_tshark,
+                    '-r', capture_file('tls13-rfc8446.pcap'),
+                    '-otls.keylog_file:{}'.format(key_file),
+                    '-otls.keylog_index_min_size:{}'.format(1 if use_index else 0),
+                    '-Y', 'http',
+                    '-Tfields',
+                    '-e', 'frame.number',
+                    '-e', 'http.request.uri',
+                    '-e', 'http.file_data',
+                    '-E', 'separator=|',
+                ))
+            return proc.stdout_str.splitlines()
+
+        def read_index():
+            with open(index_file, 'rb') as f:
+                return f.read()
+
+        # The index is written, and then used.
+        write_keys(padding(1) + key_lines)
+        self.assertEqual(decrypt(False), expected)
+        self.assertFalse(os.path.exists(index_file))
+        self.assertEqual(decrypt(True), expected)
+        index = read_index()
+        self.assertEqual(index[0:8], b'TLSKIDX\0')
+        self.assertEqual(decrypt(True), expected)
+        self.assertEqual(read_index(), index)
+
+        # Lines appended since the index was written are read without it.
+        write_keys(padding(2))
+        self.assertNotEqual(decrypt(True), expected)
+        index = read_index()
+        write_keys(key_lines, 'a')
+        self.assertEqual(decrypt(False), expected)
+        self.assertEqual(decrypt(True), expected)
+        self.assertEqual(read_index(), index)
+
+        # A rewritten key log file makes the index stale.
+        write_keys(padding(3) + key_lines)
+        self.assertEqual(decrypt(False), expected)
+        self.assertEqual(decrypt(True), expected)
+        self.assertNotEqual(read_index(), index)
+
 
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
@@ -57,3 +57,16 @@ def checkDFilterFail(cmd_dftest, base_env):
             'Unexpected dftest exit code: %d. stdout:\n%s\n' % \
             (proc.returncode, outs)
     return checkDFilterFail_real
+
+
+@fixtures.fixture
+def checkDFilterCode(cmd_dftest, base_env):
+    def checkDFilterCode_real(dfilter, expected_insn):
+        """Compile a display filter and expect dftest to show an instruction."""
+        output = subprocess.check_output([cmd_dftest, dfilter],
+                                         universal_newlines=True,
+                                         stderr=subprocess.STDOUT,
+                                         env=base_env)
+        assert (' %s\t' % (expected_insn,)) in output, \
+            'Expected %s in dftest output:\n%s' % (expected_insn, output)
+    return checkDFilterCode_real
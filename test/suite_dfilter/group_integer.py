@@ -141,6 +141,27 @@ class case_integer(unittest.TestCase):
         dfilter = "ntp.precision <= 246"
         checkDFilterCount(dfilter, 1)
 
+    def test_code_u_eq(self, checkDFilterCode):
+        dfilter = "ip.version == 4"
+        checkDFilterCode(dfilter, "ANY_EQ_INT32")
+
+    def test_code_u_gt(self, checkDFilterCode):
+        dfilter = "ntp.precision > 244"
+        checkDFilterCode(dfilter, "ANY_GT_UINT32")
+
+    def test_code_s_lt(self, checkDFilterCode):
+        dfilter = "ntp.priv.mode7.delay < -1"
+        checkDFilterCode(dfilter, "ANY_LT_SINT32")
+
+    def test_code_in(self, checkDFilterCode):
+        dfilter = "ip.version in {4 6}"
+        checkDFilterCode(dfilter, "ANY_EQ_INT32")
+
+    def test_code_bool_eq(self, checkDFilterCode):
+        # Booleans are stored as 64-bit values.
+        dfilter = "ip.flags.df == 0"
+        checkDFilterCode(dfilter, "ANY_EQ")
+
     def test_bool_eq_1(self, checkDFilterCount):
         dfilter = "ip.flags.df == 0"
         checkDFilterCount(dfilter, 1)
@@ -0,0 +1,337 @@
+#
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Editcap tests'''
+
+import random
+import struct
+import subprocesstest
+import fixtures
+
+
+def write_pcap(path, packets):
+    '''Write an Ethernet pcap file from a list of (time, payload) tuples,
+    with the time in microseconds.'''
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for ts, payload in packets:
+            f.write(struct.pack('<IIII', ts // 1000000, ts % 1000000, len(payload), len(payload)))
+            f.write(payload)
+
+
+def numbered_packets(num_packets, payload_len=60, start=1000000000, interval=1000):
+    '''Packets that differ from each other, in time order.'''
+    packets = []
+    for i in range(num_packets):
+        payload = struct.pack('<I', i) * (payload_len // 4)
+        packets.append((start * 1000000 + i * interval, payload))
+    return packets
+
+
+def packet_summary(self, cmd_tshark, cap_file, extra_args=()):
+    '''Return the time, length and MD5 hash of each packet in a file.'''
+    proc = self.assertRun([cmd_tshark,
+        '-r', cap_file,
+        '-o', 'frame.generate_md5_hash:TRUE',
+        '-T', 'fields',
+        '-e', 'frame.time_epoch',
+        '-e', 'frame.len',
+        '-e', 'frame.md5_hash',
+        ] + list(extra_args), max_lines=20)
+    return proc.stdout_str
+
+
+def read_pcap_payloads(path):
+    '''Return the packet data in a pcap file written by write_pcap.'''
+    payloads = []
+    with open(path, 'rb') as f:
+        data = f.read()
+    pos = 24
+    while pos < len(data):
+        caplen = struct.unpack('<I', data[pos + 8:pos + 12])[0]
+        payloads.append(data[pos + 16:pos + 16 + caplen])
+        pos += 16 + caplen
+    return payloads
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_compress(subprocesstest.SubprocessTestCase):
+    # Enough data for several compressed frames.
+    num_packets = 3000
+    payload_len = 1000
+
+    def check_compress(self, compression, magic, cmd_editcap, cmd_tshark):
+        in_file = self.filename_from_id('in.pcap')
+        write_pcap(in_file, numbered_packets(self.num_packets, self.payload_len))
+        compressed_file = self.filename_from_id('compressed.pcap')
+        self.filename_from_id('compressed.pcap.idx')
+        self.assertRun((cmd_editcap, '--compress', compression, in_file, compressed_file))
+        with open(compressed_file, 'rb') as f:
+            self.assertEqual(f.read(len(magic)), magic)
+
+        # Read it back sequentially.
+        self.assertTrue(self.diffOutput(packet_summary(self, cmd_tshark, in_file),
+                                        packet_summary(self, cmd_tshark, compressed_file)))
+
+        # Select packets from the middle of the file and then from near
+        # the start; the first run indexes the file and the others seek
+        # to the packets in the compressed frames that hold them.
+        for packet_range in ('2500-2510', '2500-2510', '100-110'):
+            expected_file = self.filename_from_id('expected.pcap')
+            selected_file = self.filename_from_id('selected.pcap')
+            self.assertRun((cmd_editcap, '-r', in_file, expected_file, packet_range))
+            self.assertRun((cmd_editcap, '--use-index', '-r', compressed_file, selected_file, packet_range))
+            self.assertTrue(self.diffOutput(packet_summary(self, cmd_tshark, expected_file),
+                                            packet_summary(self, cmd_tshark, selected_file)))
+
+        # Random access in two passes.
+        self.assertTrue(self.diffOutput(packet_summary(self, cmd_tshark, in_file, ('-2',)),
+                                        packet_summary(self, cmd_tshark, compressed_file, ('-2',))))
+
+    def test_editcap_compress_zstd(self, cmd_editcap, cmd_tshark, features):
+        '''Write and read back a zstd-compressed file'''
+        if not features.have_zstd:
+            self.skipTest('Requires zstd.')
+        self.check_compress('zstd', b'\x28\xb5\x2f\xfd', cmd_editcap, cmd_tshark)
+
+    def test_editcap_compress_lz4(self, cmd_editcap, cmd_tshark, features):
+        '''Write and read back an lz4-compressed file'''
+        if not features.have_lz4:
+            self.skipTest('Requires LZ4.')
+        self.check_compress('lz4', b'\x04\x22\x4d\x18', cmd_editcap, cmd_tshark)
+
+    def test_editcap_compress_skippable_frames(self, cmd_tshark, features):
+        '''Read a zstd file with many skippable frames in a row'''
+        if not features.have_zstd:
+            self.skipTest('Requires zstd.')
+        in_file = self.filename_from_id('in.pcap')
+        write_pcap(in_file, numbered_packets(10))
+        with open(in_file, 'rb') as f:
+            data = f.read()
+
+        def zstd_frame(content):
+            # Frame header descriptor: single segment, with a 2-byte
+            # content size (less 256); then a single, last, raw block.
+            return b'\x28\xb5\x2f\xfd' + bytes([0x60]) + \
+                struct.pack('<H', len(content) - 256) + \
+                struct.pack('<I', (len(content) << 3) | 1)[:3] + content
+
+        # Far more back-to-back empty skippable frames than there's
+        # room for on the stack if each one were a level of recursion.
+        skippable = struct.pack('<II', 0x184D2A50, 0) * 200000
+        skip_file = self.filename_from_id('skippable.pcap')
+        with open(skip_file, 'wb') as f:
+            f.write(zstd_frame(data[:400]) + skippable + zstd_frame(data[400:]))
+        self.assertRun((cmd_tshark, '-r', skip_file), max_lines=20)
+        self.assertEqual(self.countOutput(), 10)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_index(subprocesstest.SubprocessTestCase):
+    num_packets = 3000
+
+    # Layout of the packet index file; see wiretap/wtap_index.c.
+    index_header_size = 64
+    index_entry_size = 40
+
+    def select(self, cmd_editcap, cmd_tshark, in_file, packet_ranges, use_index):
+        '''Run editcap -r and return a summary of the packets it selects.'''
+        out_file = self.filename_from_id('selected.pcap')
+        args = [cmd_editcap]
+        if use_index:
+            args.append('--use-index')
+        self.assertRun(args + ['-r', in_file, out_file] + list(packet_ranges))
+        return packet_summary(self, cmd_tshark, out_file)
+
+    def check_select(self, cmd_editcap, cmd_tshark, in_file, packet_ranges):
+        '''Check that editcap selects the same packets with and without the index.'''
+        self.assertTrue(self.diffOutput(
+            self.select(cmd_editcap, cmd_tshark, in_file, packet_ranges, False),
+            self.select(cmd_editcap, cmd_tshark, in_file, packet_ranges, True)))
+
+    def read_index(self, index_file):
+        with open(index_file, 'rb') as f:
+            return f.read()
+
+    def test_editcap_index_write(self, cmd_editcap, cmd_tshark):
+        '''Write a packet index, and select packets with it'''
+        in_file = self.filename_from_id('in.pcap')
+        index_file = self.filename_from_id('in.pcap.idx')
+        write_pcap(in_file, numbered_packets(self.num_packets))
+
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('1000-1010',))
+        index = self.read_index(index_file)
+        self.assertEqual(index[0:8], b'WTAPIDX\0')
+        self.assertEqual(struct.unpack('<Q', index[24:32])[0], self.num_packets)
+
+        # The index is up to date, so it's used, and left alone.
+        for packet_ranges in (('1000-1010',), ('5', '2000-2005', '2999-3000'), ('2990-0',)):
+            self.check_select(cmd_editcap, cmd_tshark, in_file, packet_ranges)
+        self.assertEqual(self.read_index(index_file), index)
+
+    def test_editcap_index_is_used(self, cmd_editcap, cmd_tshark):
+        '''Seek to the offset in the packet index'''
+        in_file = self.filename_from_id('in.pcap')
+        index_file = self.filename_from_id('in.pcap.idx')
+        write_pcap(in_file, numbered_packets(self.num_packets))
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('1000',))
+
+        # Point the entry for packet 1000 at packet 1001; if editcap
+        # seeks using the index, it then selects packet 1001.
+        index = bytearray(self.read_index(index_file))
+        entry_1000 = self.index_header_size + 999 * self.index_entry_size
+        entry_1001 = entry_1000 + self.index_entry_size
+        index[entry_1000:entry_1000 + 8] = index[entry_1001:entry_1001 + 8]
+        with open(index_file, 'wb') as f:
+            f.write(index)
+        self.assertTrue(self.diffOutput(
+            self.select(cmd_editcap, cmd_tshark, in_file, ('1001',), False),
+            self.select(cmd_editcap, cmd_tshark, in_file, ('1000',), True)))
+
+    def test_editcap_index_stale(self, cmd_editcap, cmd_tshark):
+        '''Ignore and rewrite a packet index for a changed file'''
+        in_file = self.filename_from_id('in.pcap')
+        index_file = self.filename_from_id('in.pcap.idx')
+        packets = numbered_packets(self.num_packets)
+        write_pcap(in_file, packets)
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('1000-1010',))
+        index = self.read_index(index_file)
+
+        # Rewrite the file with the packets at different offsets.
+        packets = [(ts, payload + b'\0' * (i % 7)) for i, (ts, payload) in enumerate(packets)]
+        write_pcap(in_file, packets)
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('1000-1010', '2500-2510'))
+        new_index = self.read_index(index_file)
+        self.assertNotEqual(new_index, index)
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('1000-1010', '2500-2510'))
+        self.assertEqual(self.read_index(index_file), new_index)
+
+        # Append to it.
+        packets += numbered_packets(100, start=1000000010)
+        write_pcap(in_file, packets)
+        self.check_select(cmd_editcap, cmd_tshark, in_file, ('3050-3060',))
+        self.assertEqual(struct.unpack('<Q', self.read_index(index_file)[24:32])[0], len(packets))
+
+    def test_editcap_index_time_range(self, cmd_editcap, cmd_tshark):
+        '''Select a time range with the packet index, in a file that goes back in time'''
+        in_file = self.filename_from_id('in.pcap')
+        self.filename_from_id('in.pcap.idx')
+        # One packet every millisecond, except that every 97th packet is
+        # two seconds early, and packets 3000 to 3099 are a second late.
+        packets = numbered_packets(self.num_packets)
+        for i in range(0, self.num_packets, 97):
+            packets[i] = (packets[i][0] - 2000000, packets[i][1])
+        for i in range(3000, 3100):
+            packets[i] = (packets[i][0] + 1000000, packets[i][1])
+        write_pcap(in_file, packets)
+
+        def select_time(start, stop, use_index):
+            out_file = self.filename_from_id('selected.pcap')
+            args = [cmd_editcap]
+            if use_index:
+                args.append('--use-index')
+            if start is not None:
+                args += ['-A', start]
+            if stop is not None:
+                args += ['-B', stop]
+            self.assertRun(args + [in_file, out_file])
+            return packet_summary(self, cmd_tshark, out_file)
+
+        time_ranges = (
+            ('1000000001.5', '1000000002.5'),
+            ('1000000002', None),
+            (None, '1000000000.5'),
+            ('1000000003.05', '1000000003.1'),
+            ('1000000010', None),
+            (None, '999999990'),
+        )
+        # The first run writes the index, and the others use it.
+        for start, stop in time_ranges + time_ranges:
+            self.assertTrue(self.diffOutput(select_time(start, stop, False),
+                                            select_time(start, stop, True)))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_dedup(subprocesstest.SubprocessTestCase):
+    num_packets = 2000
+    interval = 1000
+    # Bytes that re-routed copies of a packet differ in: the IPv4 TTL
+    # and header checksum, in an Ethernet frame.
+    ignore_ranges = ((22, 1), (24, 2))
+
+    def write_with_duplicates(self, in_file):
+        '''One packet every millisecond; some are copies of an earlier
+        packet, either exact or with the ignored bytes changed.'''
+        rng = random.Random(20)
+        payloads = []
+        for i in range(self.num_packets):
+            if i < 20 or rng.random() < 0.5:
+                payloads.append(struct.pack('<I', i) * 15)
+                continue
+            payload = bytearray(payloads[i - rng.choice((1, 2, 3, 4, 6, 9, 20))])
+            if rng.random() < 0.3:
+                payload[22] ^= 0xff
+                payload[24:26] = struct.pack('<H', rng.randrange(65536))
+            payloads.append(bytes(payload))
+        write_pcap(in_file, [(1000000000 * 1000000 + i * self.interval, payload)
+                             for i, payload in enumerate(payloads)])
+        return payloads
+
+    def expected_kept(self, payloads, window, time_window, ignore):
+        '''The packets editcap keeps: those without a copy in the previous
+        window - 1 packets that is at most time_window seconds older.'''
+        def key(payload):
+            if not ignore:
+                return payload
+            payload = bytearray(payload)
+            for offset, length in self.ignore_ranges:
+                payload[offset:offset + length] = b'\0' * length
+            return bytes(payload)
+        max_distance = window - 1
+        if time_window is not None:
+            max_distance = min(max_distance, int(time_window * 1000000) // self.interval)
+        keys = [key(payload) for payload in payloads]
+        return [payload for i, payload in enumerate(payloads)
+                if keys[i] not in keys[max(0, i - max_distance):i]]
+
+    def check_dedup(self, cmd_editcap, args, window, time_window, ignore=False):
+        in_file = self.filename_from_id('in.pcap')
+        out_file = self.filename_from_id('out.pcap')
+        payloads = self.write_with_duplicates(in_file)
+        expected = self.expected_kept(payloads, window, time_window, ignore)
+        self.assertLess(len(expected), len(payloads))
+        if ignore:
+            for offset, length in self.ignore_ranges:
+                args += ('--dup-ignore-bytes', '{}:{}'.format(offset, length))
+        for confirm in ((), ('--dup-confirm',)):
+            proc = self.assertRun((cmd_editcap,) + args + confirm + (in_file, out_file))
+            self.assertIn('{} packets skipped'.format(len(payloads) - len(expected)),
+                          proc.stderr_str)
+            self.assertEqual(read_pcap_payloads(out_file), expected)
+        return len(expected)
+
+    def test_editcap_dedup_default(self, cmd_editcap):
+        '''Remove duplicates of the previous four packets'''
+        kept = self.check_dedup(cmd_editcap, ('-d',), 5, None)
+        self.assertLess(self.check_dedup(cmd_editcap, ('-d',), 5, None, ignore=True), kept)
+        self.assertGreater(self.check_dedup(cmd_editcap, ('-D', '2'), 2, None), kept)
+
+    def test_editcap_dedup_window(self, cmd_editcap):
+        '''Remove duplicates in a large window'''
+        kept = self.check_dedup(cmd_editcap, ('-D', '10'), 10, None)
+        self.assertLess(self.check_dedup(cmd_editcap, ('-D', '100'), 100, None), kept)
+        self.check_dedup(cmd_editcap, ('-D', '100000'), 100000, None, ignore=True)
+
+    def test_editcap_dedup_time(self, cmd_editcap):
+        '''Remove duplicates in a time window'''
+        kept = self.check_dedup(cmd_editcap, ('-w', '0.0045'), 1000000, 0.0045)
+        self.check_dedup(cmd_editcap, ('-w', '0.0095'), 1000000, 0.0095, ignore=True)
+        # Both a count and a time window
+        self.assertGreater(self.check_dedup(cmd_editcap, ('-D', '3', '-w', '0.0045'), 3, 0.0045),
+                           kept)
+        self.check_dedup(cmd_editcap, ('-D', '100', '-w', '0.0065'), 100, 0.0065)
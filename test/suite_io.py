@@ -10,6 +10,7 @@
 
 import io
 import os.path
+import struct
 import subprocesstest
 import sys
 import unittest
@@ -69,6 +70,116 @@ class case_tshark_io(subprocesstest.SubprocessTestCase):
         '''Read direct and write direct using TShark'''
         check_io_4_packets(self, capture_file, cmd=cmd_tshark)
 
+    def test_tshark_io_mmap(self, cmd_tshark, capture_file, test_env):
+        '''Read a file through a memory mapping using TShark'''
+        args = (cmd_tshark, '-r', capture_file('dhcp.pcap'), '-2', '-V')
+        expected = self.assertRun(args, env=test_env).stdout_str
+        mmap_env = dict(test_env, WIRESHARK_MMAP_CAPTURE_FILES='1')
+        self.assertEqual(self.assertRun(args, env=mmap_env).stdout_str, expected)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_use_index(subprocesstest.SubprocessTestCase):
+    # Five seconds of packets, one every millisecond, starting at
+    # 2001-09-09 01:46:40 UTC; each run of 1024 in the packet index
+    # covers about a second.
+    num_packets = 5000
+
+    def write_capture(self):
+        in_file = self.filename_from_id('in.pcap')
+        self.filename_from_id('in.pcap.idx')
+        with open(in_file, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for i in range(self.num_packets):
+                payload = struct.pack('<I', i) * (15 + i % 10)
+                f.write(struct.pack('<IIII', 1000000000 + i // 1000, (i % 1000) * 1000,
+                                    len(payload), len(payload)))
+                f.write(payload)
+        return in_file
+
+    def run_tshark(self, cmd_tshark, in_file, display_filter, use_index, fields=True):
+        args = [cmd_tshark, '-r', in_file, '-Y', display_filter]
+        if use_index:
+            args.append('--use-index')
+        if fields:
+            args += ['-T', 'fields',
+                '-e', 'frame.number',
+                '-e', 'frame.time_relative',
+                '-e', 'frame.time_delta',
+                '-e', 'frame.time_delta_displayed',
+                '-e', 'frame.cum_bytes',
+            ]
+        return self.assertRun(args, max_lines=20).stdout_str
+
+    def check_use_index(self, cmd_tshark, display_filter, uses_index):
+        '''Check whether tshark uses the packet index for a filter, and
+        that its output is the same as without it.'''
+        in_file = self.write_capture()
+        index_file = in_file + '.idx'
+        expected = self.run_tshark(cmd_tshark, in_file, display_filter, False)
+        expected_summary = self.run_tshark(cmd_tshark, in_file, display_filter, False, False)
+        self.assertFalse(os.path.exists(index_file))
+
+        # The index is only written if it can be used.
+        self.assertTrue(self.diffOutput(expected,
+            self.run_tshark(cmd_tshark, in_file, display_filter, True)))
+        self.assertEqual(os.path.exists(index_file), uses_index)
+
+        self.assertTrue(self.diffOutput(expected,
+            self.run_tshark(cmd_tshark, in_file, display_filter, True)))
+        self.assertTrue(self.diffOutput(expected_summary,
+            self.run_tshark(cmd_tshark, in_file, display_filter, True, False)))
+
+    def test_tshark_use_index_epoch(self, cmd_tshark):
+        '''Skip to a range of frame.time_epoch'''
+        self.check_use_index(cmd_tshark,
+            'frame.time_epoch >= 1000000002 && frame.time_epoch < 1000000003', True)
+
+    def test_tshark_use_index_time(self, cmd_tshark):
+        '''Skip to a range of frame.time, including the end'''
+        self.check_use_index(cmd_tshark,
+            'frame.time ge "2001-09-09 01:46:42.5" and frame.time <= "2001-09-09 01:46:43"', True)
+
+    def test_tshark_use_index_reversed(self, cmd_tshark):
+        '''Skip to a range given with parentheses and the time first'''
+        self.check_use_index(cmd_tshark,
+            '(1000000003.25 > frame.time_epoch) && (frame.time_utc > "2001-09-09 01:46:42.75")', True)
+
+    def test_tshark_use_index_start(self, cmd_tshark):
+        '''Skip to a start time'''
+        self.check_use_index(cmd_tshark, 'frame.time_epoch >= 1000000004.5', True)
+
+    def test_tshark_use_index_stop(self, cmd_tshark):
+        '''Stop at a stop time'''
+        self.check_use_index(cmd_tshark, 'frame.time_epoch < 1000000000.5', True)
+
+    def test_tshark_use_index_empty(self, cmd_tshark):
+        '''Skip everything for an empty range'''
+        self.check_use_index(cmd_tshark, 'frame.time_epoch > 1000000010', True)
+
+    def test_tshark_use_index_or(self, cmd_tshark):
+        '''Don't use the index with "or"'''
+        self.check_use_index(cmd_tshark,
+            'frame.time_epoch < 1000000001 || frame.time_epoch >= 1000000004', False)
+
+    def test_tshark_use_index_not(self, cmd_tshark):
+        '''Don't use the index with "not"'''
+        self.check_use_index(cmd_tshark, '!(frame.time_epoch < 1000000002)', False)
+
+    def test_tshark_use_index_other_field(self, cmd_tshark):
+        '''Don't use the index if another field is tested'''
+        self.check_use_index(cmd_tshark,
+            'frame.time_epoch >= 1000000002 && frame.len > 70', False)
+
+    def test_tshark_use_index_relative(self, cmd_tshark):
+        '''Don't use the index for other time fields'''
+        self.check_use_index(cmd_tshark, 'frame.time_relative >= 2', False)
+
+    def test_tshark_use_index_equal(self, cmd_tshark):
+        '''Don't use the index for other comparisons'''
+        self.check_use_index(cmd_tshark, 'frame.time_epoch == 1000000002', False)
+
 
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
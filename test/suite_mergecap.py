@@ -9,6 +9,7 @@
 '''Mergecap tests'''
 
 import re
+import struct
 import subprocesstest
 import fixtures
 
@@ -122,6 +123,54 @@ class case_mergecap_pcap(subprocesstest.SubprocessTestCase):
         check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', 62, 1, 62)
 
 
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_mergecap_many_files(subprocesstest.SubprocessTestCase):
+    # More input files than mergecap keeps open at once.
+    num_files = 300
+    packets_per_file = 3
+
+    def write_many_files(self):
+        '''Write pcap files that each cover a different second, in reverse order of time.'''
+        in_files = []
+        for i in range(self.num_files):
+            in_file = self.filename_from_id('many_{}.pcap'.format(i))
+            with open(in_file, 'wb') as f:
+                f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+                for j in range(self.packets_per_file):
+                    f.write(struct.pack('<IIII', 1000000 + self.num_files - i, j, 60, 60))
+                    f.write(bytes(60))
+            in_files.append(in_file)
+        return in_files
+
+    def test_mergecap_many_files_pcap(self, cmd_mergecap):
+        '''Merge more pcap files than can be kept open, in chronological order'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun([cmd_mergecap,
+            '-v',
+            '-F', 'pcap',
+            '-w', testout_file,
+        ] + self.write_many_files())
+        num_packets = self.num_files * self.packets_per_file
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', num_packets, 1, num_packets)
+        capinfos_testout = self.getCaptureInfo(capinfos_args=('-o',), cap_file=testout_file)
+        self.assertTrue(re.search(r'Strict time order:\s+True', capinfos_testout) is not None)
+
+    def test_mergecap_many_files_append_pcap(self, cmd_mergecap):
+        '''Concatenate more pcap files than can be kept open'''
+        testout_file = self.filename_from_id(testout_pcap)
+        mergecap_proc = self.assertRun([cmd_mergecap,
+            '-v',
+            '-a',
+            '-F', 'pcap',
+            '-w', testout_file,
+        ] + self.write_many_files())
+        num_packets = self.num_files * self.packets_per_file
+        check_mergecap(self, mergecap_proc, 'pcap', 'Ethernet', num_packets, 1, num_packets)
+        capinfos_testout = self.getCaptureInfo(capinfos_args=('-o',), cap_file=testout_file)
+        self.assertTrue(re.search(r'Strict time order:\s+False', capinfos_testout) is not None)
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_mergecap_pcapng(subprocesstest.SubprocessTestCase):
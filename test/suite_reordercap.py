@@ -0,0 +1,83 @@
+#
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Reordercap tests'''
+
+import random
+import struct
+import subprocesstest
+import fixtures
+
+
+def write_pcap(path, packets):
+    '''Write an Ethernet pcap file from a list of (time, payload) tuples,
+    with the time in microseconds.'''
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for ts, payload in packets:
+            f.write(struct.pack('<IIII', ts // 1000000, ts % 1000000, len(payload), len(payload)))
+            f.write(payload)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_reordercap(subprocesstest.SubprocessTestCase):
+    num_packets = 1000
+    # Packets are up to this many microseconds late.
+    max_delay = 50000
+
+    def write_out_of_order(self, in_file):
+        '''One packet every millisecond, each delayed by up to max_delay,
+        with some of them sharing a time stamp.'''
+        rng = random.Random(42)
+        packets = []
+        for i in range(self.num_packets):
+            ts = 1000000000 * 1000000 + i * 1000 + rng.randrange(self.max_delay)
+            if i % 50 == 1:
+                ts = packets[-1][0]
+            packets.append((ts, struct.pack('<I', i) * 15))
+        write_pcap(in_file, packets)
+
+    def reorder(self, cmd_reordercap, in_file, args=()):
+        '''Run reordercap and return the contents of the output file.'''
+        out_file = self.filename_from_id('out.pcap')
+        proc = self.assertRun([cmd_reordercap] + list(args) + [in_file, out_file])
+        self.assertIn('{} frames'.format(self.num_packets), proc.stdout_str)
+        with open(out_file, 'rb') as f:
+            return f.read()
+
+    def check_same_as_default(self, cmd_reordercap, args):
+        in_file = self.filename_from_id('in.pcap')
+        self.write_out_of_order(in_file)
+        expected = self.reorder(cmd_reordercap, in_file)
+        self.assertEqual(self.reorder(cmd_reordercap, in_file, args), expected)
+
+    def test_reordercap_default(self, cmd_reordercap, cmd_tshark):
+        '''Sort an out-of-order file in memory'''
+        in_file = self.filename_from_id('in.pcap')
+        self.write_out_of_order(in_file)
+        self.reorder(cmd_reordercap, in_file)
+        out_file = self.filename_from_id('out.pcap')
+        proc = self.assertRun((cmd_tshark, '-r', out_file,
+            '-T', 'fields', '-e', 'frame.time_delta'), max_lines=20)
+        self.assertFalse([d for d in proc.stdout_str.split() if d.startswith('-')])
+
+    def test_reordercap_external_one_run(self, cmd_reordercap):
+        '''Sort a file that fits in one run'''
+        self.check_same_as_default(cmd_reordercap, ('-m', str(self.num_packets + 1)))
+
+    def test_reordercap_external_runs(self, cmd_reordercap):
+        '''Sort a file in several runs, merged in one pass'''
+        self.check_same_as_default(cmd_reordercap, ('-m', '100'))
+
+    def test_reordercap_external_passes(self, cmd_reordercap):
+        '''Sort a file in more runs than are merged at once'''
+        # More than REORDER_MAX_OPEN_RUNS runs, so they're merged in two
+        # passes.
+        self.check_same_as_default(cmd_reordercap, ('-m', '3'))
+
+    def test_reordercap_window(self, cmd_reordercap):
+        '''Sort a file with a sliding window'''
+        self.check_same_as_default(cmd_reordercap, ('-s', '0.1'))
@@ -52,6 +52,7 @@
 #include <cli_main.h>
 #include <ui/version_info.h>
 #include <wiretap/wtap_opttypes.h>
+#include <wiretap/wtap_index.h>
 
 #include "globals.h"
 #include <epan/timestamp.h>
@@ -128,12 +129,20 @@
 #define INVALID_TAP             2
 #define INVALID_CAPTURE         2
 
+/*
+ * Size of the buffer for writes to a -w file, and how often to flush it
+ * so that a program reading the file doesn't fall too far behind.
+ */
+#define WRITE_BUFFER_SIZE       (1024*1024)
+#define WRITE_FLUSH_INTERVAL_MS 1000
+
 #define LONGOPT_EXPORT_OBJECTS          LONGOPT_BASE_APPLICATION+1
 #define LONGOPT_COLOR                   LONGOPT_BASE_APPLICATION+2
 #define LONGOPT_NO_DUPLICATE_KEYS       LONGOPT_BASE_APPLICATION+3
 #define LONGOPT_ELASTIC_MAPPING_FILTER  LONGOPT_BASE_APPLICATION+4
 #define LONGOPT_EXPORT_TLS_SESSION_KEYS LONGOPT_BASE_APPLICATION+5
 #define LONGOPT_CAPTURE_COMMENT         LONGOPT_BASE_APPLICATION+6
+#define LONGOPT_USE_INDEX               LONGOPT_BASE_APPLICATION+7
 
 capture_file cfile;
 
@@ -192,6 +201,15 @@ static const char *separator = "";
 /* Per-file comments to be added to the output file. */
 static GPtrArray *capture_comments = NULL;
 
+/*
+ * If --use-index was specified, and the display filter only selects
+ * packets in a time range, the range; unset if there's no start or end.
+ */
+static gboolean use_index = FALSE;
+static gboolean have_filter_time_range = FALSE;
+static nstime_t filter_start = NSTIME_INIT_UNSET;
+static nstime_t filter_stop = NSTIME_INIT_UNSET;
+
 static gboolean prefs_loaded = FALSE;
 
 #ifdef HAVE_LIBPCAP
@@ -234,6 +252,7 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, gboolean tree, gboolean visual);
+static gboolean print_tree_visible(void);
 
 typedef enum {
   PROCESS_FILE_SUCCEEDED,
@@ -396,6 +415,10 @@ print_usage(FILE *output)
   fprintf(output, "  -Y <display filter>, --display-filter <display filter>\n");
   fprintf(output, "                           packet displaY filter in Wireshark display filter\n");
   fprintf(output, "                           syntax\n");
+  fprintf(output, "  --use-index              if the display filter only compares frame.time, use\n");
+  fprintf(output, "                           the packet index <infile>.idx to skip the packets\n");
+  fprintf(output, "                           outside that time range, or write one if there isn't\n");
+  fprintf(output, "                           an up-to-date one\n");
   fprintf(output, "  -n                       disable all name resolutions (def: \"mNd\" enabled, or\n");
   fprintf(output, "                           as set in preferences)\n");
   fprintf(output, "  -N <name resolve flags>  enable specific name resolution(s): \"mnNtdv\"\n");
@@ -671,6 +694,17 @@ must_do_dissection(dfilter_t *rfcode, dfilter_t *dfcode,
       tap_listeners_require_dissection() || dissect_color;
 }
 
+/*
+ * The fields holding a packet's time stamp.  If a display filter is
+ * nothing but comparisons of them with times, joined with "and", we
+ * can skip the packets outside the time range it selects.  Packets with
+ * no time stamp have none of these fields, so they're outside the range
+ * as well.
+ */
+static const char *const filter_time_fields[] = {
+  "frame.time", "frame.time_utc", "frame.time_epoch", NULL
+};
+
 int
 main(int argc, char *argv[])
 {
@@ -700,6 +734,7 @@ main(int argc, char *argv[])
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
     {"capture-comment", required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
+    {"use-index", no_argument, NULL, LONGOPT_USE_INDEX},
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -1470,6 +1505,9 @@ main(int argc, char *argv[])
       }
       g_ptr_array_add(capture_comments, g_strdup(ws_optarg));
       break;
+    case LONGOPT_USE_INDEX:
+      use_index = TRUE;
+      break;
     default:
     case '?':        /* Bad flag - print usage message */
       switch(ws_optopt) {
@@ -1978,6 +2016,9 @@ main(int argc, char *argv[])
       exit_status = INVALID_FILTER;
       goto clean_exit;
     }
+    if (use_index)
+      have_filter_time_range = dfilter_get_time_range(dfcode, filter_time_fields,
+                                                      &filter_start, &filter_stop);
   }
   cfile.dfcode = dfcode;
 
@@ -2794,7 +2835,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -2802,7 +2843,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     while (to_read-- && cf->provider.wth) {
       wtap_cleareof(cf->provider.wth);
       ret = wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset);
-      reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+      reset_epan_mem(cf, edt, create_proto_tree, print_tree_visible());
       if (ret == FALSE) {
         /* read from file failed, tell the capture child to stop */
         sync_pipe_stop(cap_session);
@@ -3151,6 +3192,8 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
   }
 
   ws_debug("tshark: reading records for first pass");
+  /* Overlap reading and decompressing the file with dissection. */
+  wtap_start_read_ahead(cf->provider.wth);
   *err = 0;
   while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
     if (read_interrupted) {
@@ -3196,6 +3239,7 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
 
 static gboolean
 process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
+                           const struct packet_provider_data *tvb_prov,
                            frame_data *fdata, wtap_rec *rec,
                            Buffer *buf, guint tap_flags)
 {
@@ -3220,6 +3264,9 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    if (output_action == WRITE_FIELDS)
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3244,7 +3291,7 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
     }
 
     epan_dissect_run_with_taps(edt, cf->cd_t, rec,
-                               frame_tvbuff_new_buffer(&cf->provider, fdata, buf),
+                               frame_tvbuff_new_buffer(tvb_prov, fdata, buf),
                                fdata, cinfo);
 
     /* Run the read/display filter if we have one. */
@@ -3304,13 +3351,153 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, int *err, gchar **err_info)
   return TRUE;
 }
 
+/*
+ * In the second pass we already know the offset of every record we're
+ * going to process, so a separate thread seeks to and reads (and, for
+ * compressed files, decompresses) the records ahead of us into a small
+ * ring of slots, overlapping I/O with dissection and printing.
+ *
+ * The dissection engine isn't thread-safe, so dissecting, tapping,
+ * printing and writing all stay on the main thread, in frame order;
+ * the reader thread only ever touches the random-access side of the
+ * wtap, which nothing else uses during the second pass.
+ */
+#define READ_AHEAD_SLOTS  64
+
+typedef struct {
+  wtap_rec  rec;
+  Buffer    buf;
+  gboolean  ok;
+  int       err;
+  gchar    *err_info;
+} read_ahead_slot_t;
+
+typedef struct {
+  capture_file      *cf;
+  read_ahead_slot_t  slots[READ_AHEAD_SLOTS];
+  guint              head;      /* slot the main thread will consume next */
+  guint              filled;    /* number of slots waiting to be consumed */
+  gboolean           stop;      /* set by the main thread to stop reading */
+  GMutex             lock;
+  GCond              slot_filled;
+  GCond              slot_freed;
+  GThread           *thread;
+} read_ahead_t;
+
+static gpointer
+read_ahead_worker(gpointer data)
+{
+  read_ahead_t      *ra = (read_ahead_t *)data;
+  read_ahead_slot_t *slot;
+  frame_data        *fdata;
+  guint              tail = 0;
+  guint32            framenum;
+
+  for (framenum = 1; framenum <= ra->cf->count; framenum++) {
+    g_mutex_lock(&ra->lock);
+    while (ra->filled == READ_AHEAD_SLOTS && !ra->stop)
+      g_cond_wait(&ra->slot_freed, &ra->lock);
+    if (ra->stop) {
+      g_mutex_unlock(&ra->lock);
+      break;
+    }
+    g_mutex_unlock(&ra->lock);
+
+    /* The frame_data_sequence isn't modified during the second pass. */
+    fdata = frame_data_sequence_find(ra->cf->provider.frames, framenum);
+    slot = &ra->slots[tail];
+    slot->ok = wtap_seek_read(ra->cf->provider.wth, fdata->file_off,
+                              &slot->rec, &slot->buf, &slot->err,
+                              &slot->err_info);
+
+    g_mutex_lock(&ra->lock);
+    ra->filled++;
+    g_cond_signal(&ra->slot_filled);
+    g_mutex_unlock(&ra->lock);
+
+    if (!slot->ok)
+      break;
+    tail = (tail + 1) % READ_AHEAD_SLOTS;
+  }
+  return NULL;
+}
+
+static void
+read_ahead_start(read_ahead_t *ra, capture_file *cf)
+{
+  guint i;
+
+  ra->cf = cf;
+  for (i = 0; i < READ_AHEAD_SLOTS; i++) {
+    wtap_rec_init(&ra->slots[i].rec);
+    ws_buffer_init(&ra->slots[i].buf, 1514);
+    ra->slots[i].ok = FALSE;
+    ra->slots[i].err = 0;
+    ra->slots[i].err_info = NULL;
+  }
+  ra->head = 0;
+  ra->filled = 0;
+  ra->stop = FALSE;
+  g_mutex_init(&ra->lock);
+  g_cond_init(&ra->slot_filled);
+  g_cond_init(&ra->slot_freed);
+  ra->thread = g_thread_new("tshark_read_ahead", read_ahead_worker, ra);
+}
+
+/*
+ * Wait for the next record; the caller must call read_ahead_release()
+ * when it's done with it.
+ */
+static read_ahead_slot_t *
+read_ahead_next(read_ahead_t *ra)
+{
+  g_mutex_lock(&ra->lock);
+  while (ra->filled == 0)
+    g_cond_wait(&ra->slot_filled, &ra->lock);
+  g_mutex_unlock(&ra->lock);
+  return &ra->slots[ra->head];
+}
+
+static void
+read_ahead_release(read_ahead_t *ra)
+{
+  wtap_rec_reset(&ra->slots[ra->head].rec);
+
+  g_mutex_lock(&ra->lock);
+  ra->head = (ra->head + 1) % READ_AHEAD_SLOTS;
+  ra->filled--;
+  g_cond_signal(&ra->slot_freed);
+  g_mutex_unlock(&ra->lock);
+}
+
+static void
+read_ahead_finish(read_ahead_t *ra)
+{
+  guint i;
+
+  g_mutex_lock(&ra->lock);
+  ra->stop = TRUE;
+  g_cond_signal(&ra->slot_freed);
+  g_mutex_unlock(&ra->lock);
+  g_thread_join(ra->thread);
+
+  for (i = 0; i < READ_AHEAD_SLOTS; i++) {
+    ws_buffer_free(&ra->slots[i].buf);
+    wtap_rec_cleanup(&ra->slots[i].rec);
+  }
+  g_cond_clear(&ra->slot_freed);
+  g_cond_clear(&ra->slot_filled);
+  g_mutex_clear(&ra->lock);
+}
+
 static pass_status_t
 process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
                              int *err, gchar **err_info,
                              volatile guint32 *err_framenum)
 {
-  wtap_rec        rec;
-  Buffer          buf;
+  read_ahead_t   *ra;
+  read_ahead_slot_t *slot;
+  struct packet_provider_data tvb_prov;
   guint32         framenum;
   frame_data     *fdata;
   gboolean        filtering_tap_listeners;
@@ -3328,9 +3515,6 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     return PASS_WRITE_ERROR;
   }
 
-  wtap_rec_init(&rec);
-  ws_buffer_init(&buf, 1514);
-
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
@@ -3363,7 +3547,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
   }
 
   /*
@@ -3372,26 +3556,42 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
    */
   set_resolution_synchrony(TRUE);
 
+  /*
+   * Frame tvbuffs normally re-read their data through the random-access
+   * side of the wtap if they're cloned; that belongs to the read-ahead
+   * thread now, so don't give them a wtap to read from, and tvb_clone()
+   * will just copy the data instead.
+   */
+  tvb_prov = cf->provider;
+  tvb_prov.wth = NULL;
+
+  ra = g_new(read_ahead_t, 1);
+  read_ahead_start(ra, cf);
+
   for (framenum = 1; framenum <= cf->count; framenum++) {
     if (read_interrupted) {
       status = PASS_INTERRUPTED;
       break;
     }
     fdata = frame_data_sequence_find(cf->provider.frames, framenum);
-    if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
-                        err_info)) {
+    slot = read_ahead_next(ra);
+    if (!slot->ok) {
       /* Error reading from the input file. */
+      *err = slot->err;
+      *err_info = slot->err_info;
       status = PASS_READ_ERROR;
       break;
     }
     ws_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
-    if (process_packet_second_pass(cf, edt, fdata, &rec, &buf, tap_flags)) {
+    if (process_packet_second_pass(cf, edt, &tvb_prov, fdata, &slot->rec,
+                                   &slot->buf, tap_flags)) {
       /* Either there's no read filtering or this packet passed the
          filter, so, if we're writing to a capture file, write
          this packet out. */
       if (pdh != NULL) {
         ws_debug("tshark: writing packet #%d to outfile", framenum);
-        if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
+        if (!wtap_dump(pdh, &slot->rec, ws_buffer_start_ptr(&slot->buf), err,
+                       err_info)) {
           /* Error writing to the output file. */
           ws_debug("tshark: error writing to a capture file (%d)", *err);
           *err_framenum = framenum;
@@ -3400,18 +3600,47 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
         }
       }
     }
-    wtap_rec_reset(&rec);
+    read_ahead_release(ra);
   }
 
+  read_ahead_finish(ra);
+  g_free(ra);
+
   if (edt)
     epan_dissect_free(edt);
 
-  ws_buffer_free(&buf);
-  wtap_rec_cleanup(&rec);
-
   return status;
 }
 
+/*
+ * We've used the packet index to skip the first first_rec records.
+ * None of them can have passed the display filter, so the previous
+ * displayed packet and the cumulative byte count are as if we'd read
+ * them; set up the first packet, the reference for frame.time_relative,
+ * and the previous captured packet, for frame.time_delta, from the
+ * index.
+ */
+static void
+set_skipped_frame_refs(capture_file *cf, wtap_index *pkt_index, guint64 first_rec)
+{
+  wtap_index_entry entry;
+
+  if (wtap_index_get(pkt_index, 0, &entry)) {
+    memset(&ref_frame, 0, sizeof ref_frame);
+    ref_frame.num = 1;
+    ref_frame.abs_ts = entry.ts;
+    ref_frame.has_ts = (entry.flags & WTAP_INDEX_HAS_TS) ? 1 : 0;
+    cf->provider.ref = &ref_frame;
+  }
+  if (wtap_index_get(pkt_index, first_rec - 1, &entry)) {
+    memset(&prev_cap_frame, 0, sizeof prev_cap_frame);
+    prev_cap_frame.num = (guint32)first_rec;
+    prev_cap_frame.abs_ts = entry.ts;
+    prev_cap_frame.has_ts = (entry.flags & WTAP_INDEX_HAS_TS) ? 1 : 0;
+    cf->provider.prev_cap = &prev_cap_frame;
+  }
+}
+
 static pass_status_t
 process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
                              int max_packet_count, gint64 max_byte_count,
@@ -3427,6 +3656,12 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
   epan_dissect_t *edt = NULL;
   gint64          data_offset;
   pass_status_t   status = PASS_SUCCEEDED;
+  wtap_index     *pkt_index;
+  wtap_index_writer *index_writer = NULL;
+  int             index_err;
+  guint64         first_rec = 0;
+  guint64         end_rec = G_MAXUINT64;
+  gboolean        stopped_early = FALSE;
 
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
@@ -3471,7 +3706,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree, print_tree_visible());
   }
 
   /*
@@ -3481,6 +3716,50 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
    */
   set_resolution_synchrony(TRUE);
 
+  /*
+   * If the display filter only selects packets in a time range, and
+   * nothing else looks at the packets outside it, use the packet index
+   * to skip the packets before the range and to stop after it, or, if
+   * there's no up-to-date index, write one as we read the file.
+   *
+   * The packets that are skipped aren't dissected, so anything the
+   * packets in the range would get from them, such as reassembled
+   * data, isn't there.
+   */
+  if (have_filter_time_range && cf->rfcode == NULL &&
+      !tap_listeners_require_dissection()) {
+    pkt_index = wtap_index_open(cf->provider.wth);
+    if (pkt_index != NULL) {
+      if (wtap_index_find_time_range(pkt_index,
+                                     nstime_is_unset(&filter_start) ? NULL : &filter_start,
+                                     nstime_is_unset(&filter_stop) ? NULL : &filter_stop,
+                                     &first_rec, &end_rec)) {
+        if (first_rec >= wtap_index_count(pkt_index)) {
+          /* Nothing's in the range. */
+          end_rec = 0;
+        } else if (first_rec != 0) {
+          if (wtap_index_seek(cf->provider.wth, pkt_index, first_rec, &index_err)) {
+            /* Number the packets as if we'd read the ones we skipped. */
+            framenum = (guint32)first_rec;
+            cf->count = (guint32)first_rec;
+            set_skipped_frame_refs(cf, pkt_index, first_rec);
+          } else if (index_err != 0) {
+            cmdarg_err("Can't seek using the packet index: %s",
+                       wtap_strerror(index_err));
+          }
+        }
+      }
+      wtap_index_close(pkt_index);
+    } else {
+      index_writer = wtap_index_writer_new(cf->provider.wth, &index_err);
+      if (index_writer == NULL)
+        cmdarg_err("Can't write a packet index for \"%s\": %s",
+                   cf->filename, wtap_strerror(index_err));
+    }
+  }
+
+  /* Overlap reading and decompressing the file with dissection. */
+  wtap_start_read_ahead(cf->provider.wth);
   *err = 0;
   while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
     if (read_interrupted) {
@@ -3489,6 +3768,20 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     }
     framenum++;
 
+    if (index_writer != NULL &&
+        !wtap_index_writer_add(index_writer, cf->provider.wth, data_offset, &rec, &index_err)) {
+      cmdarg_err("Can't write a packet index for \"%s\": %s",
+                 cf->filename, wtap_strerror(index_err));
+      wtap_index_writer_close(index_writer, FALSE, &index_err);
+      index_writer = NULL;
+    }
+
+    if (framenum > end_rec) {
+      /* We're past the last packet the display filter could select. */
+      stopped_early = TRUE;
+      break;
+    }
+
     /*
      * Process whatever IDBs we haven't seen yet.
      */
@@ -3500,7 +3793,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
     ws_debug("tshark: processing packet #%d", framenum);
 
-    reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+    reset_epan_mem(cf, edt, create_proto_tree, print_tree_visible());
 
     if (process_packet_single_pass(cf, edt, data_offset, &rec, &buf, tap_flags)) {
       /* Either there's no read filtering or this packet passed the
@@ -3526,6 +3819,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
       ws_debug("tshark: max_packet_count (%d) or max_byte_count (%" G_GINT64_MODIFIER "d/%" G_GINT64_MODIFIER "d) reached",
                     max_packet_count, data_offset, max_byte_count);
       *err = 0; /* This is not an error */
+      stopped_early = TRUE;
       break;
     }
     wtap_rec_reset(&rec);
@@ -3535,6 +3829,15 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     status = PASS_READ_ERROR;
   }
 
+  if (index_writer != NULL) {
+    /* Only keep the index if we read the whole file. */
+    if (!wtap_index_writer_close(index_writer,
+                                 status == PASS_SUCCEEDED && !stopped_early,
+                                 &index_err))
+      cmdarg_err("Can't write a packet index for \"%s\": %s",
+                 cf->filename, wtap_strerror(index_err));
+  }
+
   if (edt)
     epan_dissect_free(edt);
 
@@ -3597,6 +3900,7 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
       status = PROCESS_FILE_NO_FILE_PROCESSED;
       goto out;
     }
+    wtap_dump_set_write_buffer(pdh, WRITE_BUFFER_SIZE, WRITE_FLUSH_INTERVAL_MS);
   } else {
     /* Set up to print packet information. */
     if (print_packet_info) {
@@ -3831,6 +4135,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    if (output_action == WRITE_FIELDS)
+      output_fields_prime_edt(edt, output_fields);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -4522,6 +4829,26 @@ tshark_cmdarg_err_cont(const char *msg_format, va_list ap)
   fprintf(stderr, "\n");
 }
 
+/*
+ * The protocol tree is "visible", i.e., printed, only if we're printing
+ * packet details, which is true if we're printing stuff ("print_packet_info"
+ * is true) and we're in verbose mode ("print_details" is true).
+ *
+ * With "-T fields", though, only the values of the requested fields are
+ * printed, so an invisible tree primed with those fields will do, and
+ * saves creating items and labels for every other field in the packet -
+ * unless some of the fields are printed using their labels.
+ */
+static gboolean
+print_tree_visible(void)
+{
+  if (!print_packet_info || !print_details)
+    return FALSE;
+  if (output_action == WRITE_FIELDS)
+    return output_fields_need_visible_tree(output_fields);
+  return TRUE;
+}
+
 static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree, gboolean visual)
 {
   if (!epan_auto_reset || (cf->count < epan_auto_reset_count))
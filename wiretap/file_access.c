@@ -2139,7 +2139,7 @@ wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_ZLIB
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
 gboolean
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2169,6 +2169,7 @@ static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int *err,
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
 static int wtap_dump_file_close(wtap_dumper *wdh);
+static gboolean wtap_dump_file_write_out(wtap_dumper *wdh, int *err);
 
 static wtap_dumper *
 wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_type,
@@ -2219,7 +2220,8 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 	   because we can't go back and overwrite something we've
 	   already written. */
 	if (compression_type != WTAP_UNCOMPRESSED &&
-	    !wtap_dump_can_compress(file_type_subtype)) {
+	    (!wtap_dump_can_compress(file_type_subtype) ||
+	     !wtap_can_write_compression_type(compression_type))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return NULL;
 	}
@@ -2574,12 +2576,49 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 {
 	*err = 0;
 	*err_info = NULL;
-	return (wdh->subtype_write)(wdh, rec, pd, err, err_info);
+	if (!(wdh->subtype_write)(wdh, rec, pd, err, err_info))
+		return FALSE;
+
+	/*
+	 * If we're collecting writes in a buffer, don't let what's
+	 * been written get too far ahead of what's in the file; do
+	 * this between records, so that the file never ends with a
+	 * partial record we could have written.
+	 */
+	if (wdh->flush_interval != 0 &&
+	    g_get_monotonic_time() - wdh->last_flush >= wdh->flush_interval)
+		return wtap_dump_flush(wdh, err);
+	return TRUE;
+}
+
+void
+wtap_dump_set_write_buffer(wtap_dumper *wdh, size_t buffer_size,
+			   guint flush_interval_ms)
+{
+	int err;
+
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
+		/* The compressing writers already buffer. */
+		return;
+	}
+	if (wdh->write_buf != NULL) {
+		(void) wtap_dump_file_write_out(wdh, &err);
+		g_free(wdh->write_buf);
+		wdh->write_buf = NULL;
+	}
+	if (buffer_size != 0) {
+		wdh->write_buf = (guint8 *)g_malloc(buffer_size);
+		wdh->write_buf_size = buffer_size;
+		wdh->write_buf_len = 0;
+	}
+	wdh->flush_interval = (gint64)flush_interval_ms * 1000;
+	wdh->last_flush = g_get_monotonic_time();
 }
 
 gboolean
 wtap_dump_flush(wtap_dumper *wdh, int *err)
 {
+	wdh->last_flush = g_get_monotonic_time();
 #ifdef HAVE_ZLIB
 	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		if (gzwfile_flush((GZWFILE_T)wdh->fh) == -1) {
@@ -2588,7 +2627,16 @@ wtap_dump_flush(wtap_dumper *wdh, int *err)
 		}
 	} else
 #endif
+	if (wdh->compression_type == WTAP_ZSTD_COMPRESSED ||
+	    wdh->compression_type == WTAP_LZ4_COMPRESSED) {
+		if (framewfile_flush((FRAMEWFILE_T)wdh->fh) == -1) {
+			*err = framewfile_geterr((FRAMEWFILE_T)wdh->fh);
+			return FALSE;
+		}
+	} else
 	{
+		if (!wtap_dump_file_write_out(wdh, err))
+			return FALSE;
 		if (fflush((FILE *)wdh->fh) == EOF) {
 			*err = errno;
 			return FALSE;
@@ -2691,42 +2739,78 @@ gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh) {
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_open(filename);
-	} else {
+#endif
+
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_open(filename, wdh->compression_type);
+
+	default:
 		return ws_fopen(filename, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
-{
-	return ws_fopen(filename, "wb");
-}
-#endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_fdopen(fd);
-	} else {
+#endif
+
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_fdopen(fd, wdh->compression_type);
+
+	default:
 		return ws_fdopen(fd, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
+
+/* write out raw bytes to an uncompressed file */
+static gboolean
+wtap_dump_file_fwrite(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err)
+{
+	size_t nwritten;
+
+	errno = WTAP_ERR_CANT_WRITE;
+	nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
+	/*
+	 * At least according to the macOS man page,
+	 * this can return a short count on an error.
+	 */
+	if (nwritten != bufsize) {
+		if (ferror((FILE *)wdh->fh))
+			*err = errno;
+		else
+			*err = WTAP_ERR_SHORT_WRITE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* write out whatever's in the write buffer, if we have one */
+static gboolean
+wtap_dump_file_write_out(wtap_dumper *wdh, int *err)
 {
-	return ws_fdopen(fd, "wb");
+	size_t len = wdh->write_buf_len;
+
+	if (len == 0)
+		return TRUE;
+	wdh->write_buf_len = 0;
+	return wtap_dump_file_fwrite(wdh, wdh->write_buf, len, err);
 }
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean
@@ -2746,20 +2830,34 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 		}
 	} else
 #endif
-	{
-		errno = WTAP_ERR_CANT_WRITE;
-		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
+	if (wdh->compression_type == WTAP_ZSTD_COMPRESSED ||
+	    wdh->compression_type == WTAP_LZ4_COMPRESSED) {
+		nwritten = framewfile_write((FRAMEWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
-		 * At least according to the macOS man page,
-		 * this can return a short count on an error.
+		 * framewfile_write() returns 0 on error.
 		 */
-		if (nwritten != bufsize) {
-			if (ferror((FILE *)wdh->fh))
-				*err = errno;
-			else
-				*err = WTAP_ERR_SHORT_WRITE;
+		if (nwritten == 0) {
+			*err = framewfile_geterr((FRAMEWFILE_T)wdh->fh);
 			return FALSE;
 		}
+	} else if (wdh->write_buf != NULL)
+	{
+		/*
+		 * Collect the pieces of records in the write buffer, so
+		 * that we make one large write rather than going through
+		 * the standard I/O library for each of them.
+		 */
+		if (bufsize > wdh->write_buf_size - wdh->write_buf_len) {
+			if (!wtap_dump_file_write_out(wdh, err))
+				return FALSE;
+			if (bufsize >= wdh->write_buf_size)
+				return wtap_dump_file_fwrite(wdh, buf, bufsize, err);
+		}
+		memcpy(wdh->write_buf + wdh->write_buf_len, buf, bufsize);
+		wdh->write_buf_len += bufsize;
+	} else
+	{
+		return wtap_dump_file_fwrite(wdh, buf, bufsize, err);
 	}
 	return TRUE;
 }
@@ -2773,19 +2871,38 @@ wtap_dump_file_close(wtap_dumper *wdh)
 		return gzwfile_close((GZWFILE_T)wdh->fh);
 	else
 #endif
-		return fclose((FILE *)wdh->fh);
+	if (wdh->compression_type == WTAP_ZSTD_COMPRESSED ||
+	    wdh->compression_type == WTAP_LZ4_COMPRESSED)
+		return framewfile_close((FRAMEWFILE_T)wdh->fh);
+	else
+	{
+		int err = 0;
+
+		if (wdh->write_buf != NULL) {
+			(void) wtap_dump_file_write_out(wdh, &err);
+			g_free(wdh->write_buf);
+			wdh->write_buf = NULL;
+		}
+		if (fclose((FILE *)wdh->fh) == EOF)
+			return EOF;
+		if (err != 0) {
+			errno = err;
+			return EOF;
+		}
+		return 0;
+	}
 }
 
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
+		if (!wtap_dump_file_write_out(wdh, err))
+			return -1;
 		if (-1 == ws_fseek64((FILE *)wdh->fh, offset, whence)) {
 			*err = errno;
 			return -1;
@@ -2800,19 +2917,18 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == (rval = ws_ftell64((FILE *)wdh->fh))) {
 			*err = errno;
 			return -1;
 		} else
 		{
-			return rval;
+			/* Count what's still in the write buffer. */
+			return rval + (gint64)wdh->write_buf_len;
 		}
 	}
 }
@@ -24,6 +24,10 @@
 #include <wsutil/file_util.h>
 #include <wsutil/ws_assert.h>
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
@@ -63,19 +67,20 @@
  */
 static struct compression_type {
     wtap_compression_type  type;
+    const char            *name;
     const char            *extension;
     const char            *description;
 } compression_types[] = {
 #ifdef HAVE_ZLIB
-    { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed" },
+    { WTAP_GZIP_COMPRESSED, "gzip", "gz", "gzip compressed" },
 #endif
 #ifdef HAVE_ZSTD
-    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed" },
+    { WTAP_ZSTD_COMPRESSED, "zstd", "zst", "zstd compressed" },
 #endif
 #ifdef USE_LZ4
-    { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed" },
+    { WTAP_LZ4_COMPRESSED, "lz4", "lz4", "lz4 compressed" },
 #endif
-    { WTAP_UNCOMPRESSED, NULL, NULL }
+    { WTAP_UNCOMPRESSED, NULL, NULL, NULL }
 };
 
 static wtap_compression_type file_get_compression_type(FILE_T stream);
@@ -108,6 +113,33 @@ wtap_compression_type_extension(wtap_compression_type compression_type)
 	return NULL;
 }
 
+wtap_compression_type
+wtap_name_to_compression_type(const char *name)
+{
+	if (strcmp(name, "none") == 0)
+		return WTAP_UNCOMPRESSED;
+	for (struct compression_type *p = compression_types;
+	    p->type != WTAP_UNCOMPRESSED; p++) {
+		if (strcmp(name, p->name) == 0 ||
+		    strcmp(name, p->extension) == 0)
+			return p->type;
+	}
+	return WTAP_UNKNOWN_COMPRESSION;
+}
+
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	if (compression_type == WTAP_UNCOMPRESSED)
+		return TRUE;
+	for (struct compression_type *p = compression_types;
+	    p->type != WTAP_UNCOMPRESSED; p++) {
+		if (p->type == compression_type)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 GSList *
 wtap_get_all_compression_type_extensions_list(void)
 {
@@ -203,6 +235,11 @@ struct wtap_reader {
 #ifdef USE_LZ4
     LZ4F_dctx *lz4_dctx;
 #endif
+#ifdef HAVE_MMAP
+    /* memory mapping of the file, if it's a regular file */
+    const guint8 *map;          /* start of the mapping, or NULL */
+    gint64 map_size;            /* size of the file when it was mapped */
+#endif
 };
 
 /* Current read offset within a buffer. */
@@ -266,6 +303,35 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
+#ifdef HAVE_MMAP
+    if (state->map != NULL) {
+        if (state->raw_pos < state->map_size) {
+            /*
+             * Copy from the mapping rather than reading; the file
+             * descriptor's offset isn't kept up to date while we're
+             * doing that.
+             */
+            if ((gint64)to_read > state->map_size - state->raw_pos)
+                to_read = (guint)(state->map_size - state->raw_pos);
+            memcpy(read_ptr, state->map + state->raw_pos, to_read);
+            state->raw_pos += to_read;
+            buf->avail += to_read;
+            return 0;
+        }
+
+        /*
+         * We've run past the end of the mapping; the file may have
+         * grown since we mapped it, so catch the file descriptor up
+         * and try reading.
+         */
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+#endif
+
     ret = ws_read(state->fd, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
@@ -279,6 +345,79 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
     return 0;
 }
 
+#ifdef HAVE_MMAP
+/*
+ * If the file is a regular file, map it, so that uncompressed data can
+ * be copied straight from the page cache without a read() call per
+ * buffer, and, for file_read(), without going through the output
+ * buffer.
+ *
+ * This is only an optimization; if the mapping can't be made, we just
+ * read the file.
+ *
+ * If some other program truncates the file out from under us, touching
+ * the pages past the new end raises SIGBUS and kills the process, where
+ * read() would just return an error or EOF, so files are only mapped if
+ * the WIRESHARK_MMAP_CAPTURE_FILES environment variable is set, for
+ * files that are known not to be truncated while they're being read.
+ */
+static gboolean
+file_map_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+        enabled = g_getenv("WIRESHARK_MMAP_CAPTURE_FILES") != NULL;
+    return enabled;
+}
+
+static void
+file_map(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (!file_map_enabled())
+        return;
+    if (ws_fstat64(state->fd, &st) == -1)
+        return;
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (guint64)st.st_size > G_MAXSIZE)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+        state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+#ifdef HAVE_POSIX_MADVISE
+    /* We start out reading sequentially; let the kernel read ahead. */
+    (void)posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+#endif
+    state->map = (const guint8 *)map;
+    state->map_size = st.st_size;
+}
+
+static void
+file_unmap(FILE_T state)
+{
+    if (state->map != NULL) {
+        munmap((void *)state->map, (size_t)state->map_size);
+        state->map = NULL;
+        state->map_size = 0;
+    }
+}
+#endif
+
+/* TRUE if we know the file can be seeked on without reading it. */
+static gboolean
+file_is_mapped(FILE_T state _U_)
+{
+#ifdef HAVE_MMAP
+    return state->map != NULL;
+#else
+    return FALSE;
+#endif
+}
+
 static int /* gz_avail */
 fill_in_buffer(FILE_T state)
 {
@@ -291,6 +430,49 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/* Make sure there are at least n bytes in the input buffer, unless we
+   hit the end of the file first; moves what's left in the buffer to the
+   beginning of the buffer, so that we don't throw it away if the buffer
+   is full.  Return -1 on error, 0 otherwise. */
+static int
+fill_in_buffer_min(FILE_T state, guint n)
+{
+    if (state->in.avail >= n)
+        return 0;
+    if (state->in.next != state->in.buf) {
+        memmove(state->in.buf, state->in.next, state->in.avail);
+        state->in.next = state->in.buf;
+    }
+    while (state->in.avail < n && !state->eof) {
+        if (fill_in_buffer(state) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+/* Skip n bytes of input.  Return -1, and set state->err, on error or
+   premature end of file; return 0 on success. */
+static int
+skip_in_buffer(FILE_T state, guint32 n)
+{
+    guint m;
+
+    while (n != 0) {
+        if (state->in.avail == 0 && fill_in_buffer(state) == -1)
+            return -1;
+        if (state->in.avail == 0) {
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return -1;
+        }
+        m = state->in.avail > n ? n : state->in.avail;
+        state->in.next += m;
+        state->in.avail -= m;
+        n -= m;
+    }
+    return 0;
+}
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -698,13 +880,40 @@ static int
 gz_head(FILE_T state)
 {
     guint already_read;
+    guint32 frame_size;
 
-    /* get some data in the input buffer */
-    if (state->in.avail == 0) {
-        if (fill_in_buffer(state) == -1)
+    for (;;) {
+        /* get some data in the input buffer */
+        if (state->in.avail == 0) {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            if (state->in.avail == 0)
+                return 0;
+        }
+
+        if (!state->is_compressed)
+            break;
+
+        /*
+         * Skippable frames, with a magic number of 0x184D2A5? (stored
+         * little-endian), are defined by both zstd and lz4; in
+         * particular, the seek table at the end of files we write is in
+         * one.  Skip them, and look at what follows.  Loop rather than
+         * recursing, as a file can contain any number of them back to
+         * back.
+         */
+        if (fill_in_buffer_min(state, 8) == -1)
+            return -1;
+        if (state->in.avail < 8
+            || (state->in.next[0] & 0xf0) != 0x50 || state->in.next[1] != 0x2a
+            || state->in.next[2] != 0x4d || state->in.next[3] != 0x18)
+            break;
+
+        frame_size = pletoh32(&state->in.next[4]);
+        state->in.next += 8;
+        state->in.avail -= 8;
+        if (skip_in_buffer(state, frame_size) == -1)
             return -1;
-        if (state->in.avail == 0)
-            return 0;
     }
 
     /* look for the gzip magic header bytes 31 and 139 */
@@ -861,9 +1070,16 @@ gz_head(FILE_T state)
     /* FD 37 7A 58 5A 00 */
 #endif
 
+    /*
+     * Get enough data to check for a zstd or lz4 magic number; we might
+     * be in the middle of the buffer, after a previous frame.
+     */
+    if (fill_in_buffer_min(state, 4) == -1)
+        return -1;
+
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x28 && state->in.buf[1] == 0xb5
-        && state->in.buf[2] == 0x2f && state->in.buf[3] == 0xfd) {
+        && state->in.next[0] == 0x28 && state->in.next[1] == 0xb5
+        && state->in.next[2] == 0x2f && state->in.next[3] == 0xfd) {
 #ifdef HAVE_ZSTD
         const size_t ret = ZSTD_initDStream(state->zstd_dctx);
         if (ZSTD_isError(ret)) {
@@ -872,6 +1088,15 @@ gz_head(FILE_T state)
             return -1;
         }
 
+        /*
+         * Each frame can be decompressed independently, so remember
+         * where it starts; that lets file_seek() go to the beginning
+         * of the frame containing the target, rather than to the
+         * beginning of the file.
+         */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, ZSTD);
+
         state->compression = ZSTD;
         state->is_compressed = TRUE;
         return 0;
@@ -883,8 +1108,8 @@ gz_head(FILE_T state)
     }
 
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x04 && state->in.buf[1] == 0x22
-        && state->in.buf[2] == 0x4d && state->in.buf[3] == 0x18) {
+        && state->in.next[0] == 0x04 && state->in.next[1] == 0x22
+        && state->in.next[2] == 0x4d && state->in.next[3] == 0x18) {
 #ifdef USE_LZ4
 #if LZ4_VERSION_NUMBER >= 10800
         LZ4F_resetDecompressionContext(state->lz4_dctx);
@@ -897,6 +1122,10 @@ gz_head(FILE_T state)
             return -1;
         }
 #endif
+        /* As with zstd, each frame is independent. */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, LZ4);
+
         state->compression = LZ4;
         state->is_compressed = TRUE;
         return 0;
@@ -917,9 +1146,9 @@ gz_head(FILE_T state)
     state->out.next = state->out.buf;
     /* not a compressed file -- copy everything we've read into the
        input buffer to the output buffer and fall to raw i/o */
-    already_read = bytes_in_buffer(&state->in);
+    already_read = state->in.avail;
     if (already_read != 0) {
-        memcpy(state->out.buf, state->in.buf, already_read);
+        memcpy(state->out.buf, state->in.next, already_read);
         state->out.avail = already_read;
 
         /* Now discard everything in the input buffer */
@@ -1198,6 +1427,10 @@ file_fdopen(int fd)
     }
 #endif
 
+#ifdef HAVE_MMAP
+    file_map(state);
+#endif
+
     /* return stream */
     return state;
 
@@ -1274,6 +1507,15 @@ void
 file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_MADVISE)
+    /*
+     * The random-access handle jumps around the file, so aggressive
+     * sequential readahead, and dropping pages behind us, is the
+     * wrong thing to do for it.
+     */
+    if (random_flag && stream->map != NULL)
+        (void)posix_madvise((void *)stream->map, (size_t)stream->map_size, POSIX_MADV_NORMAL);
+#endif
 }
 
 gint64
@@ -1411,6 +1653,11 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off2 = here->out;
         } else
 #endif
+        if (here->compression == ZSTD || here->compression == LZ4) {
+            /* Start of a frame; decompress it again from there. */
+            off = here->in;
+            off2 = here->out;
+        } else
         {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
@@ -1463,6 +1710,11 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             file->compression = ZLIB;
         } else
 #endif
+        if (here->compression == ZSTD || here->compression == LZ4) {
+            /* Have gz_head() reread the frame header and reset the
+               decompression context. */
+            file->compression = UNKNOWN;
+        } else
             file->compression = here->compression;
 
         offset = (file->pos + offset) - off2;
@@ -1487,16 +1739,19 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
      *
      * Again, note that this will never be true on a pipe, as
      * file_set_random_access() should never be called if we're
-     * reading from a pipe.
+     * reading from a pipe, and we only map regular files.
      */
     if (file->compression == UNCOMPRESSED && file->pos + offset >= file->raw
         && (offset < 0 || offset >= file->out.avail)
-        && (file->fast_seek != NULL))
+        && (file->fast_seek != NULL || file_is_mapped(file)))
     {
         /*
          * Yes.  Just seek there within the file.
+         *
+         * Seek to an absolute position computed from raw_pos, as the
+         * descriptor's offset isn't maintained if the file is mapped.
          */
-        if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
+        if (ws_lseek64(file->fd, file->raw_pos + (offset - file->out.avail), SEEK_SET) == -1) {
             *err = errno;
             return -1;
         }
@@ -1671,6 +1926,30 @@ file_read(void *buf, unsigned int len, FILE_T file)
                we're at the end of the input; just return
                with what we've gotten so far. */
             break;
+#ifdef HAVE_MMAP
+        } else if (file->compression == UNCOMPRESSED &&
+                   file->map != NULL && file->raw_pos < file->map_size) {
+            /* We have nothing in the output buffer, and
+               the data is uncompressed and mapped; copy
+               it straight from the mapping, rather than
+               copying it into the output buffer and then
+               copying it out again.
+
+               Discard the output buffer, so that seeking
+               backwards doesn't try to do it within a
+               buffer that no longer precedes the current
+               position. */
+            buf_reset(&file->out);
+            n = file->map_size - file->raw_pos > len ? len : (guint)(file->map_size - file->raw_pos);
+            if (buf != NULL) {
+                memcpy(buf, file->map + file->raw_pos, n);
+                buf = (char *)buf + n;
+            }
+            file->raw_pos += n;
+            len -= n;
+            got += n;
+            file->pos += n;
+#endif
         } else {
             /* We have nothing in the output buffer, and
                we can generate more data; get more output,
@@ -1867,6 +2146,9 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_MMAP
+    file_unmap(file);
+#endif
     ws_close(file->fd);
     file->fd = -1;
 }
@@ -1879,6 +2161,11 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
     file->fd = fd;
+#ifdef HAVE_MMAP
+    /* Map whatever is now at that path, not what used to be there. */
+    file_unmap(file);
+    file_map(file);
+#endif
     return TRUE;
 }
 
@@ -1901,6 +2188,9 @@ file_close(FILE_T file)
         g_free(file->out.buf);
         g_free(file->in.buf);
     }
+#ifdef HAVE_MMAP
+    file_unmap(file);
+#endif
     g_free(file->fast_seek_cur);
     file->err = 0;
     file->err_info = NULL;
@@ -2203,6 +2493,453 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif
 
+/*
+ * Writing zstd and lz4 compressed files.
+ *
+ * Rather than compressing everything as a single stream, we compress
+ * the data as a sequence of independent frames, each holding
+ * FRAMEW_FRAME_SIZE bytes of uncompressed data (other than the last
+ * frame), so that a reader can start decompressing at the beginning of
+ * any frame instead of at the beginning of the file; see the fast seek
+ * handling in gz_head().  A flush writes out everything that's been
+ * written so far without ending the current frame, so flushing often
+ * doesn't produce lots of tiny frames.
+ *
+ * At the end of the file we write a seek table, listing the compressed
+ * and decompressed size of each frame, in the format used by the
+ * zstd seekable format:
+ *
+ *     https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * It's in a skippable frame, which both zstd and lz4 define, so it's
+ * ignored by anything that doesn't know about it, including the
+ * zstd and lz4 command-line tools and older versions of Wireshark.
+ */
+#define FRAMEW_FRAME_SIZE       (1U << 20)
+#define FRAMEW_IN_SIZE          (64U << 10) /* data handed to the compressor at a time */
+#define FRAMEW_ZSTD_LEVEL       3           /* zstd's default level */
+#define SKIPPABLE_FRAME_MAGIC   0x184D2A5EU
+#define SEEKABLE_MAGIC          0x8F92EAB1U
+
+#ifdef USE_LZ4
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX    19
+#endif
+#endif
+
+struct seek_table_entry {
+    guint32 compressed_size;
+    guint32 decompressed_size;
+};
+
+/* What to do after compressing the buffered data */
+typedef enum {
+    FRAMEW_CONTINUE,            /* nothing; more data is coming */
+    FRAMEW_FLUSH,               /* write out everything compressed so far */
+    FRAMEW_END                  /* end the frame */
+} framew_op_t;
+
+struct wtap_frame_writer {
+    int fd;                     /* file descriptor */
+    wtap_compression_type type; /* WTAP_ZSTD_COMPRESSED or WTAP_LZ4_COMPRESSED */
+    unsigned char *in;          /* uncompressed data not yet compressed */
+    guint in_len;               /* amount of data in the input buffer */
+    unsigned char *out;         /* compressed data */
+    size_t out_size;            /* size of the output buffer */
+    gboolean in_frame;          /* a frame has been started */
+    guint32 frame_in_len;       /* uncompressed size of the current frame */
+    guint32 frame_out_len;      /* compressed size of the current frame so far */
+    GArray *seek_table;         /* struct seek_table_entry for each frame */
+    int err;                    /* error code */
+    const char *err_info;       /* additional error information string for some errors */
+#ifdef HAVE_ZSTD
+    ZSTD_CStream *zstd_cstream;
+#endif
+#ifdef USE_LZ4
+    LZ4F_compressionContext_t lz4_cctx;
+    LZ4F_preferences_t lz4_prefs;
+#endif
+};
+
+FRAMEWFILE_T
+framewfile_open(const char *path, wtap_compression_type type)
+{
+    int fd;
+    FRAMEWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = framewfile_fdopen(fd, type);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+FRAMEWFILE_T
+framewfile_fdopen(int fd, wtap_compression_type type)
+{
+    FRAMEWFILE_T state;
+
+    /* allocate wtap_frame_writer structure to return */
+    state = g_try_new0(struct wtap_frame_writer, 1);
+    if (state == NULL)
+        return NULL;
+    state->fd = fd;
+    state->type = type;
+
+    switch (type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->out_size = ZSTD_CStreamOutSize();
+        state->zstd_cstream = ZSTD_createCStream();
+        if (state->zstd_cstream == NULL)
+            goto err;
+        break;
+#endif
+
+#ifdef USE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        /* The default preferences; the size of a frame isn't known
+           until it's ended, so it's not in the frame header. */
+        memset(&state->lz4_prefs, 0, sizeof state->lz4_prefs);
+        state->out_size = LZ4F_compressBound(FRAMEW_IN_SIZE, &state->lz4_prefs);
+        if (state->out_size < LZ4F_HEADER_SIZE_MAX)
+            state->out_size = LZ4F_HEADER_SIZE_MAX;
+        if (LZ4F_isError(LZ4F_createCompressionContext(&state->lz4_cctx, LZ4F_VERSION)))
+            goto err;
+        break;
+#endif
+
+    default:
+        g_free(state);
+        errno = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return NULL;
+    }
+
+    state->in = (unsigned char *)g_try_malloc(FRAMEW_IN_SIZE);
+    state->out = (unsigned char *)g_try_malloc(state->out_size);
+    if (state->in == NULL || state->out == NULL)
+        goto err;
+    state->seek_table = g_array_new(FALSE, FALSE, sizeof(struct seek_table_entry));
+
+    /* return stream */
+    return state;
+
+err:
+#ifdef HAVE_ZSTD
+    ZSTD_freeCStream(state->zstd_cstream);
+#endif
+#ifdef USE_LZ4
+    if (state->lz4_cctx != NULL)
+        LZ4F_freeCompressionContext(state->lz4_cctx);
+#endif
+    g_free(state->out);
+    g_free(state->in);
+    g_free(state);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/* Write len bytes from buf to the output file.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+framew_write_raw(FRAMEWFILE_T state, const void *buf, size_t len)
+{
+    ssize_t got;
+
+    while (len != 0) {
+        got = ws_write(state->fd, buf, (unsigned int)len);
+        if (got < 0) {
+            state->err = errno;
+            return -1;
+        }
+        if (got == 0) {
+            state->err = WTAP_ERR_SHORT_WRITE;
+            return -1;
+        }
+        buf = (const char *)buf + got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+/* Write len bytes of compressed data from the output buffer, as part of
+   the current frame.  Return -1, and set state->err, on failure; return 0
+   on success. */
+static int
+framew_write_out(FRAMEWFILE_T state, size_t len)
+{
+    if (framew_write_raw(state, state->out, len) == -1)
+        return -1;
+    state->frame_out_len += (guint32)len;
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+/* Returns -1, and sets state->err and state->err_info, if ret is a zstd
+   error; returns 0 otherwise. */
+static int
+framew_zstd_check(FRAMEWFILE_T state, size_t ret)
+{
+    if (ZSTD_isError(ret)) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = ZSTD_getErrorName(ret);
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+#ifdef USE_LZ4
+/* Write out the len bytes an lz4 compression call put in the output
+   buffer, or, if len is an lz4 error, return -1 and set state->err and
+   state->err_info.  Return 0 on success. */
+static int
+framew_lz4_write_out(FRAMEWFILE_T state, size_t len)
+{
+    if (LZ4F_isError(len)) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = LZ4F_getErrorName(len);
+        return -1;
+    }
+    return framew_write_out(state, len);
+}
+#endif
+
+/* Compress the data in the input buffer, starting a frame if there
+   isn't one, and then, as op says, carry on, write out everything
+   compressed so far, or end the frame and add it to the seek table.
+   Return -1, and set state->err and possibly state->err_info, on
+   failure; return 0 on success. */
+static int
+framew_comp(FRAMEWFILE_T state, framew_op_t op)
+{
+    struct seek_table_entry entry;
+
+    if (!state->in_frame) {
+        /* Don't write empty frames */
+        if (state->in_len == 0)
+            return 0;
+
+        switch (state->type) {
+
+#ifdef HAVE_ZSTD
+        case WTAP_ZSTD_COMPRESSED:
+            if (framew_zstd_check(state, ZSTD_initCStream(state->zstd_cstream, FRAMEW_ZSTD_LEVEL)) == -1)
+                return -1;
+            break;
+#endif
+
+#ifdef USE_LZ4
+        case WTAP_LZ4_COMPRESSED:
+            if (framew_lz4_write_out(state,
+                    LZ4F_compressBegin(state->lz4_cctx, state->out, state->out_size,
+                                       &state->lz4_prefs)) == -1)
+                return -1;
+            break;
+#endif
+
+        default:
+            ws_assert_not_reached();
+        }
+        state->in_frame = TRUE;
+    }
+
+    switch (state->type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+    {
+        ZSTD_inBuffer input = {state->in, state->in_len, 0};
+        ZSTD_outBuffer output;
+        size_t ret;
+
+        while (input.pos < input.size) {
+            output.dst = state->out;
+            output.size = state->out_size;
+            output.pos = 0;
+            if (framew_zstd_check(state, ZSTD_compressStream(state->zstd_cstream, &output, &input)) == -1 ||
+                framew_write_out(state, output.pos) == -1)
+                return -1;
+        }
+        if (op != FRAMEW_CONTINUE) {
+            /* Both return the amount of data still to be written out. */
+            do {
+                output.dst = state->out;
+                output.size = state->out_size;
+                output.pos = 0;
+                if (op == FRAMEW_FLUSH)
+                    ret = ZSTD_flushStream(state->zstd_cstream, &output);
+                else
+                    ret = ZSTD_endStream(state->zstd_cstream, &output);
+                if (framew_zstd_check(state, ret) == -1 ||
+                    framew_write_out(state, output.pos) == -1)
+                    return -1;
+            } while (ret != 0);
+        }
+        break;
+    }
+#endif
+
+#ifdef USE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        if (state->in_len != 0 &&
+            framew_lz4_write_out(state,
+                LZ4F_compressUpdate(state->lz4_cctx, state->out, state->out_size,
+                                    state->in, state->in_len, NULL)) == -1)
+            return -1;
+        if (op == FRAMEW_FLUSH &&
+            framew_lz4_write_out(state,
+                LZ4F_flush(state->lz4_cctx, state->out, state->out_size, NULL)) == -1)
+            return -1;
+        if (op == FRAMEW_END &&
+            framew_lz4_write_out(state,
+                LZ4F_compressEnd(state->lz4_cctx, state->out, state->out_size, NULL)) == -1)
+            return -1;
+        break;
+#endif
+
+    default:
+        ws_assert_not_reached();
+    }
+    state->in_len = 0;
+
+    if (op == FRAMEW_END) {
+        entry.compressed_size = state->frame_out_len;
+        entry.decompressed_size = state->frame_in_len;
+        g_array_append_val(state->seek_table, entry);
+        state->in_frame = FALSE;
+        state->frame_in_len = 0;
+        state->frame_out_len = 0;
+    }
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+guint
+framewfile_write(FRAMEWFILE_T state, const void *buf, guint len)
+{
+    guint put = len;
+    guint n;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    while (len != 0) {
+        n = MIN(FRAMEW_IN_SIZE - state->in_len,
+                FRAMEW_FRAME_SIZE - state->frame_in_len);
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->in_len, buf, n);
+        state->in_len += n;
+        state->frame_in_len += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->frame_in_len == FRAMEW_FRAME_SIZE) {
+            if (framew_comp(state, FRAMEW_END) == -1)
+                return 0;
+        } else if (state->in_len == FRAMEW_IN_SIZE) {
+            if (framew_comp(state, FRAMEW_CONTINUE) == -1)
+                return 0;
+        }
+    }
+    return put;
+}
+
+/* Flush out what we've written so far, without ending the current
+   frame.
+   Returns -1, and sets state->err, on failure; returns 0 on success. */
+int
+framewfile_flush(FRAMEWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    return framew_comp(state, FRAMEW_FLUSH);
+}
+
+/* Write out the seek table.  Return -1, and set state->err, on failure;
+   return 0 on success. */
+static int
+framew_write_seek_table(FRAMEWFILE_T state)
+{
+    guint8 *table, *p;
+    guint32 frame_size;
+    guint i;
+    int ret;
+
+    /* entries, plus a footer of the number of frames, a descriptor
+       byte, and the seekable magic number */
+    frame_size = state->seek_table->len * 8 + 9;
+    table = (guint8 *)g_try_malloc(8 + frame_size);
+    if (table == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+    p = table;
+    phtole32(p, SKIPPABLE_FRAME_MAGIC);
+    phtole32(p + 4, frame_size);
+    p += 8;
+    for (i = 0; i < state->seek_table->len; i++) {
+        struct seek_table_entry *entry = &g_array_index(state->seek_table, struct seek_table_entry, i);
+
+        phtole32(p, entry->compressed_size);
+        phtole32(p + 4, entry->decompressed_size);
+        p += 8;
+    }
+    phtole32(p, state->seek_table->len);
+    p[4] = 0;   /* no checksums */
+    phtole32(p + 5, SEEKABLE_MAGIC);
+
+    ret = framew_write_raw(state, table, 8 + (size_t)frame_size);
+    g_free(table);
+    return ret;
+}
+
+/* Flush out all data written, write the seek table, and close the file.
+   Returns a Wiretap error on failure; returns 0 on success. */
+int
+framewfile_close(FRAMEWFILE_T state)
+{
+    int ret = 0;
+
+    if (state->err != 0)
+        ret = state->err;
+    else if (framew_comp(state, FRAMEW_END) == -1 ||
+             framew_write_seek_table(state) == -1)
+        ret = state->err;
+#ifdef HAVE_ZSTD
+    ZSTD_freeCStream(state->zstd_cstream);
+#endif
+#ifdef USE_LZ4
+    if (state->lz4_cctx != NULL)
+        LZ4F_freeCompressionContext(state->lz4_cctx);
+#endif
+    g_array_free(state->seek_table, TRUE);
+    g_free(state->out);
+    g_free(state->in);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+framewfile_geterr(FRAMEWFILE_T state)
+{
+    return state->err;
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -45,4 +45,14 @@ extern int gzwfile_close(GZWFILE_T state);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_ZLIB */
 
+/* zstd or lz4, as a sequence of independent frames plus a seek table */
+typedef struct wtap_frame_writer *FRAMEWFILE_T;
+
+extern FRAMEWFILE_T framewfile_open(const char *path, wtap_compression_type type);
+extern FRAMEWFILE_T framewfile_fdopen(int fd, wtap_compression_type type);
+extern guint framewfile_write(FRAMEWFILE_T state, const void *buf, guint len);
+extern int framewfile_flush(FRAMEWFILE_T state);
+extern int framewfile_close(FRAMEWFILE_T state);
+extern int framewfile_geterr(FRAMEWFILE_T state);
+
 #endif /* __FILE_H__ */
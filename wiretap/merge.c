@@ -68,21 +68,60 @@ merge_idb_merge_mode_to_string(const int mode)
 }
 
 
+/*
+ * Maximum number of input files to keep open while they wait for their
+ * first record to be the earliest one; files beyond that are closed
+ * after their first record has been read, and reopened when it's their
+ * turn, so that merging thousands of files that each cover a different
+ * stretch of time doesn't need thousands of open files.
+ */
+#define MERGE_MAX_OPEN_FILES    256
+
 static void
 cleanup_in_file(merge_in_file_t *in_file)
 {
     ws_assert(in_file != NULL);
 
-    wtap_close(in_file->wth);
-    in_file->wth = NULL;
+    if (in_file->wth != NULL) {
+        wtap_close(in_file->wth);
+        in_file->wth = NULL;
+    }
 
-    g_array_free(in_file->idb_index_map, TRUE);
-    in_file->idb_index_map = NULL;
+    if (in_file->idb_index_map != NULL) {
+        g_array_free(in_file->idb_index_map, TRUE);
+        in_file->idb_index_map = NULL;
+    }
+
+    wtap_free_idb_info(in_file->idb_inf);
+    in_file->idb_inf = NULL;
 
     wtap_rec_cleanup(&in_file->rec);
     ws_buffer_free(&in_file->frame_buffer);
 }
 
+/*
+ * Take references to the IDBs read when a file was opened, so that
+ * we still have them when the file has been closed.
+ */
+static wtapng_iface_descriptions_t *
+copy_idb_info(wtap *wth)
+{
+    wtapng_iface_descriptions_t *idb_inf;
+    GArray *interface_data;
+    wtap_block_t idb;
+    guint i;
+
+    idb_inf = wtap_file_get_idb_info(wth);
+    interface_data = g_array_sized_new(FALSE, FALSE, sizeof(wtap_block_t),
+                                       idb_inf->interface_data->len);
+    for (i = 0; i < idb_inf->interface_data->len; i++) {
+        idb = wtap_block_ref(g_array_index(idb_inf->interface_data, wtap_block_t, i));
+        g_array_append_val(interface_data, idb);
+    }
+    idb_inf->interface_data = interface_data;
+    return idb_inf;
+}
+
 static void
 add_idb_index_map(merge_in_file_t *in_file, const guint orig_index _U_, const guint found_index)
 {
@@ -111,7 +150,8 @@ add_idb_index_map(merge_in_file_t *in_file, const guint orig_index _U_, const gu
  */
 static gboolean
 merge_open_in_files(guint in_file_count, const char *const *in_file_names,
-                    merge_in_file_t **out_files, merge_progress_callback_t* cb,
+                    merge_in_file_t **out_files, const gboolean do_append,
+                    merge_progress_callback_t* cb,
                     int *err, gchar **err_info, guint *err_fileno)
 {
     guint i;
@@ -119,6 +159,7 @@ merge_open_in_files(guint in_file_count, const char *const *in_file_names,
     size_t files_size = in_file_count * sizeof(merge_in_file_t);
     merge_in_file_t *files;
     gint64 size;
+    gint64 data_offset;
 
     files = (merge_in_file_t *)g_malloc0(files_size);
     *out_files = NULL;
@@ -149,6 +190,35 @@ merge_open_in_files(guint in_file_count, const char *const *in_file_names,
         ws_buffer_init(&files[i].frame_buffer, 1514);
         files[i].size = size;
         files[i].idb_index_map = g_array_new(FALSE, FALSE, sizeof(guint));
+        files[i].file_type_subtype = wtap_file_type_subtype(files[i].wth);
+        files[i].file_encap = wtap_file_encap(files[i].wth);
+        files[i].idb_inf = copy_idb_info(files[i].wth);
+
+        if (i >= MERGE_MAX_OPEN_FILES) {
+            /*
+             * Too many files open; close this one until it's needed.
+             * If we're merging by time stamp, first read its first
+             * record, so that we know when it will be needed.
+             */
+            if (!do_append) {
+                if (wtap_read(files[i].wth, &files[i].rec,
+                              &files[i].frame_buffer, err, err_info,
+                              &data_offset)) {
+                    files[i].state = RECORD_PRESENT;
+                    wtap_rec_reset(&files[i].rec);
+                } else if (*err == 0) {
+                    files[i].state = AT_EOF;
+                } else {
+                    for (j = 0; j <= i; j++)
+                        cleanup_in_file(&files[j]);
+                    g_free(files);
+                    *err_fileno = i;
+                    return FALSE;
+                }
+            }
+            wtap_close(files[i].wth);
+            files[i].wth = NULL;
+        }
     }
 
     if (cb)
@@ -190,10 +260,10 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
     int i;
     int selected_frame_type;
 
-    selected_frame_type = wtap_file_encap(in_files[0].wth);
+    selected_frame_type = in_files[0].file_encap;
 
     for (i = 1; i < in_file_count; i++) {
-        int this_frame_type = wtap_file_encap(in_files[i].wth);
+        int this_frame_type = in_files[i].file_encap;
         if (selected_frame_type != this_frame_type) {
             selected_frame_type = WTAP_ENCAP_PER_PACKET;
             break;
@@ -207,7 +277,7 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
  * returns TRUE if first argument is earlier than second
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+is_earlier(const nstime_t *l, const nstime_t *r) /* XXX, move to nstime.c */
 {
     if (l->secs > r->secs) {  /* left is later */
         return FALSE;
@@ -222,6 +292,130 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
     return TRUE;
 }
 
+/*
+ * The files that have a record ready to be written, as a binary heap
+ * ordered so that the file whose record is to be written next is at the
+ * top, so that we don't have to look at every file for every record.
+ */
+typedef struct {
+    guint   *files;     /* indices into in_files */
+    guint    count;     /* number of files in the heap */
+    int      last;      /* file from which the last record came, or -1 */
+    gboolean started;   /* TRUE once the first record of each file has been read */
+} merge_heap_t;
+
+/*
+ * Returns TRUE if the record from in_files[a] is to be written before
+ * the record from in_files[b].
+ *
+ * Records with no time stamp are treated as earlier than all other
+ * records.  Yes, this means you won't get a chronological merge of
+ * those records, but you obviously *can't* get that.  Ties are broken
+ * the way a scan over the files in order would break them: the first
+ * file with no time stamp, or the last file with the earliest time
+ * stamp.
+ */
+static gboolean
+merge_heap_before(const merge_in_file_t in_files[], guint a, guint b)
+{
+    const wtap_rec *rec_a = &in_files[a].rec;
+    const wtap_rec *rec_b = &in_files[b].rec;
+
+    if (!(rec_a->presence_flags & WTAP_HAS_TS)) {
+        if (!(rec_b->presence_flags & WTAP_HAS_TS))
+            return a < b;
+        return TRUE;
+    }
+    if (!(rec_b->presence_flags & WTAP_HAS_TS))
+        return FALSE;
+    if (!is_earlier(&rec_b->ts, &rec_a->ts))
+        return TRUE;    /* a is earlier than b */
+    if (!is_earlier(&rec_a->ts, &rec_b->ts))
+        return FALSE;   /* b is earlier than a */
+    return a > b;
+}
+
+static void
+merge_heap_push(merge_heap_t *heap, const merge_in_file_t in_files[], guint file)
+{
+    guint i = heap->count++;
+
+    while (i > 0 && merge_heap_before(in_files, file, heap->files[(i - 1) / 2])) {
+        heap->files[i] = heap->files[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->files[i] = file;
+}
+
+static guint
+merge_heap_pop(merge_heap_t *heap, const merge_in_file_t in_files[])
+{
+    guint top = heap->files[0];
+    guint file = heap->files[--heap->count];
+    guint i = 0;
+    guint child;
+
+    while ((child = 2 * i + 1) < heap->count) {
+        if (child + 1 < heap->count &&
+            merge_heap_before(in_files, heap->files[child + 1], heap->files[child]))
+            child++;
+        if (!merge_heap_before(in_files, heap->files[child], file))
+            break;
+        heap->files[i] = heap->files[child];
+        i = child;
+    }
+    if (heap->count != 0)
+        heap->files[i] = file;
+    return top;
+}
+
+/*
+ * Read the next record from an input file into its merge_in_file_t,
+ * opening the file if it was closed to save file descriptors, and
+ * closing it when it reaches EOF.
+ *
+ * While *read_ahead_left is non-zero, files are read ahead on their own
+ * threads, so that decompressing and parsing the input files is spread
+ * over the available processors and the merging thread only has to
+ * pick records and write them.
+ *
+ * Returns FALSE, with in_file->state set to AT_EOF or GOT_ERROR, if
+ * there's no record.
+ */
+static gboolean
+merge_read_in_file(merge_in_file_t *in_file, guint *read_ahead_left,
+                   int *err, gchar **err_info)
+{
+    gint64 data_offset;
+
+    if (in_file->wth == NULL) {
+        in_file->wth = wtap_open_offline(in_file->filename, WTAP_TYPE_AUTO,
+                                         err, err_info, FALSE);
+        if (in_file->wth == NULL) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+    }
+    if (*read_ahead_left != 0 && in_file->wth->read_ahead == NULL &&
+        wtap_start_read_ahead(in_file->wth))
+        (*read_ahead_left)--;
+    if (!wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                   err, err_info, &data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
+        if (in_file->wth->read_ahead != NULL)
+            (*read_ahead_left)++;
+        wtap_close(in_file->wth);
+        in_file->wth = NULL;
+        return FALSE;
+    }
+    in_file->state = RECORD_PRESENT;
+    return TRUE;
+}
+
 /** Read the next packet, in chronological order, from the set of files to
  * be merged.
  *
@@ -236,6 +430,8 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap files with a record available, ordered by time stamp
+ * @param read_ahead_left number of further files that can be read ahead
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -244,69 +440,63 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
+                  merge_heap_t *heap, guint *read_ahead_left,
                   int *err, gchar **err_info)
 {
     int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    guint ei;
 
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
+    if (!heap->started) {
+        /*
+         * Make sure we have a record available from each file that's
+         * not at EOF; files that were closed by merge_open_in_files()
+         * already had their first record read.
+         */
+        for (i = 0; i < in_file_count; i++) {
+            if (in_files[i].state == RECORD_NOT_PRESENT) {
+                if (!merge_read_in_file(&in_files[i], read_ahead_left, err, err_info)) {
+                    if (*err != 0)
+                        return &in_files[i];
+                    continue;
                 }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
-
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
             }
+            if (in_files[i].state == RECORD_PRESENT)
+                merge_heap_push(heap, in_files, i);
         }
+        heap->started = TRUE;
+    } else if (heap->last != -1) {
+        /* We need another record from the file the last one came from. */
+        if (merge_read_in_file(&in_files[heap->last], read_ahead_left, err, err_info))
+            merge_heap_push(heap, in_files, heap->last);
+        else if (*err != 0)
+            return &in_files[heap->last];
     }
 
-    if (ei == -1) {
-        /* All the streams are at EOF.  Return an EOF indication. */
-        *err = 0;
-        return NULL;
+    for (;;) {
+        if (heap->count == 0) {
+            /* All the streams are at EOF.  Return an EOF indication. */
+            heap->last = -1;
+            *err = 0;
+            return NULL;
+        }
+
+        ei = merge_heap_pop(heap, in_files);
+        if (in_files[ei].wth != NULL)
+            break;
+
+        /*
+         * This file was closed after its first record was read; open
+         * it again and re-read that record.
+         */
+        if (merge_read_in_file(&in_files[ei], read_ahead_left, err, err_info))
+            break;
+        if (*err != 0)
+            return &in_files[ei];
     }
 
     /* We'll need to read another packet from this file. */
     in_files[ei].state = RECORD_NOT_PRESENT;
+    heap->last = ei;
 
     /* Count this packet. */
     in_files[ei].packet_num++;
@@ -333,6 +523,7 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param read_ahead_left number of further files that can be read ahead
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -341,10 +532,9 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  */
 static merge_in_file_t *
 merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
-                         int *err, gchar **err_info)
+                         guint *read_ahead_left, int *err, gchar **err_info)
 {
     int i;
-    gint64 data_offset;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
@@ -352,17 +542,13 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec,
-                      &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
+        if (merge_read_in_file(&in_files[i], read_ahead_left, err, err_info))
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
-            in_files[i].state = GOT_ERROR;
             return &in_files[i];
         }
-        /* EOF - flag this file as being at EOF, and try the next one. */
-        in_files[i].state = AT_EOF;
+        /* EOF - this file is now flagged as being at EOF; try the next one. */
     }
     if (i == in_file_count) {
         /* All the streams are at EOF.  Return an EOF indication. */
@@ -631,22 +817,20 @@ all_idbs_are_duplicates(const merge_in_file_t *in_files, const guint in_file_cou
     ws_assert(in_files != NULL);
 
     /* get the first file's info */
-    first_idb_list = wtap_file_get_idb_info(in_files[0].wth);
+    first_idb_list = in_files[0].idb_inf;
     ws_assert(first_idb_list->interface_data);
 
     first_idb_list_size = first_idb_list->interface_data->len;
 
     /* now compare the other input files with that */
     for (i = 1; i < in_file_count; i++) {
-        other_idb_list = wtap_file_get_idb_info(in_files[i].wth);
+        other_idb_list = in_files[i].idb_inf;
         ws_assert(other_idb_list->interface_data);
         other_idb_list_size = other_idb_list->interface_data->len;
 
         if (other_idb_list_size != first_idb_list_size) {
             ws_debug("sizes of IDB lists don't match: first=%u, other=%u",
                          first_idb_list_size, other_idb_list_size);
-            g_free(other_idb_list);
-            g_free(first_idb_list);
             return FALSE;
         }
 
@@ -656,18 +840,13 @@ all_idbs_are_duplicates(const merge_in_file_t *in_files, const guint in_file_cou
 
             if (!is_duplicate_idb(first_file_idb, other_file_idb)) {
                 ws_debug("IDBs at index %d do not match, returning FALSE", j);
-                g_free(other_idb_list);
-                g_free(first_idb_list);
                 return FALSE;
             }
         }
-        g_free(other_idb_list);
     }
 
     ws_debug("returning TRUE");
 
-    g_free(first_idb_list);
-
     return TRUE;
 }
 
@@ -751,7 +930,7 @@ generate_merged_idbs(merge_in_file_t *in_files, const guint in_file_count, const
         ws_debug("mode ALL set and all IDBs are duplicates");
 
         /* they're all the same, so just get the first file's IDBs */
-        input_file_idb_list = wtap_file_get_idb_info(in_files[0].wth);
+        input_file_idb_list = in_files[0].idb_inf;
         /* this is really one more than number of IDBs, but that's good for the for-loops */
         num_idbs = input_file_idb_list->interface_data->len;
 
@@ -769,12 +948,10 @@ generate_merged_idbs(merge_in_file_t *in_files, const guint in_file_count, const
                 add_idb_index_map(&in_files[i], itf_count, itf_count);
             }
         }
-
-        g_free(input_file_idb_list);
     }
     else {
         for (i = 0; i < in_file_count; i++) {
-            input_file_idb_list = wtap_file_get_idb_info(in_files[i].wth);
+            input_file_idb_list = in_files[i].idb_inf;
 
             for (itf_count = 0; itf_count < input_file_idb_list->interface_data->len; itf_count++) {
                 input_file_idb = g_array_index(input_file_idb_list->interface_data,
@@ -801,8 +978,6 @@ generate_merged_idbs(merge_in_file_t *in_files, const guint in_file_count, const
                     add_idb_index_map(&in_files[i], itf_count, merged_index);
                 }
             }
-
-            g_free(input_file_idb_list);
         }
     }
 
@@ -848,17 +1023,30 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        heap;
+    guint               read_ahead_left;
+
+    /*
+     * Leave one processor for the merging thread; with only one,
+     * read everything on this thread.
+     */
+    read_ahead_left = g_get_num_processors() - 1;
+
+    heap.files = g_new(guint, in_file_count);
+    heap.count = 0;
+    heap.last = -1;
+    heap.started = FALSE;
 
     for (;;) {
         *err = 0;
 
         if (do_append) {
-            in_file = merge_append_read_packet(in_file_count, in_files, err,
-                                               err_info);
+            in_file = merge_append_read_packet(in_file_count, in_files,
+                                               &read_ahead_left, err, err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(in_file_count, in_files, &heap,
+                                        &read_ahead_left, err, err_info);
         }
 
         if (in_file == NULL) {
@@ -934,7 +1122,11 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         if (dsb_combined && in_file->wth->dsbs) {
             GArray *in_dsb = in_file->wth->dsbs;
             for (guint i = in_file->dsbs_seen; i < in_dsb->len; i++) {
-                wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
+                /*
+                 * Keep a reference, as the input file is closed when
+                 * it reaches EOF.
+                 */
+                wtap_block_t wblock = wtap_block_ref(g_array_index(in_dsb, wtap_block_t, i));
                 g_array_append_val(dsb_combined, wblock);
                 in_file->dsbs_seen++;
             }
@@ -972,6 +1164,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
      * those DSBs are only written when wtap_dump is called and nothing bad will
      * happen now, let's keep all pointers in pdh valid for correctness sake. */
     merge_close_in_files(in_file_count, in_files);
+    g_free(heap.files);
 
     if (status == MERGE_OK || in_file == NULL) {
         *err_fileno = 0;
@@ -1015,8 +1208,8 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
     ws_debug("merge_files: begin");
 
     /* open the input files */
-    if (!merge_open_in_files(in_file_count, in_filenames, &in_files, cb,
-                             err, err_info, err_fileno)) {
+    if (!merge_open_in_files(in_file_count, in_filenames, &in_files, do_append,
+                             cb, err, err_info, err_fileno)) {
         ws_debug("merge_open_in_files() failed with err=%d", *err);
         *err_framenum = 0;
         return MERGE_ERR_CANT_OPEN_INFILE;
@@ -1082,7 +1275,7 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
         wtap_block_array_free(shb_hdrs);
         wtap_free_idb_info(idb_inf);
         if (dsb_combined) {
-            g_array_free(dsb_combined, TRUE);
+            wtap_block_array_free(dsb_combined);
         }
         *err_framenum = 0;
         return MERGE_ERR_CANT_OPEN_OUTFILE;
@@ -1099,7 +1292,7 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
     wtap_block_array_free(shb_hdrs);
     wtap_free_idb_info(idb_inf);
     if (dsb_combined) {
-        g_array_free(dsb_combined, TRUE);
+        wtap_block_array_free(dsb_combined);
     }
 
     return status;
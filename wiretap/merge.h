@@ -29,7 +29,7 @@ typedef enum {
  */
 typedef struct merge_in_file_s {
     const char     *filename;
-    wtap           *wth;
+    wtap           *wth;            /* NULL while the file is closed, waiting for its turn or at EOF */
     wtap_rec        rec;
     Buffer          frame_buffer;
     in_file_state_e state;
@@ -37,6 +37,9 @@ typedef struct merge_in_file_s {
     gint64          size;           /* file size */
     GArray         *idb_index_map;  /* used for mapping the old phdr interface_id values to new during merge */
     guint           dsbs_seen;      /* number of elements processed so far from wth->dsbs */
+    int             file_type_subtype; /* file type/subtype */
+    int             file_encap;     /* file encapsulation type when the file was opened */
+    wtapng_iface_descriptions_t *idb_inf; /* the IDBs read when the file was opened */
 } merge_in_file_t;
 
 /** Return values from merge_files(). */
@@ -3096,6 +3096,31 @@ pcapng_read_and_check_block_trailer(FILE_T fh, pcapng_block_header_t *bh,
     return TRUE;
 }
 
+/*
+ * Is this a block that we only return as a record?  Reading any other
+ * block can change the file's encapsulation type, interfaces, section
+ * headers, name resolution or secrets, or call back into the
+ * application.
+ */
+static gboolean
+pcapng_block_is_record_only(guint32 block_type)
+{
+    switch (block_type) {
+
+        case(BLOCK_TYPE_PB):
+        case(BLOCK_TYPE_SPB):
+        case(BLOCK_TYPE_EPB):
+        case(BLOCK_TYPE_CB_COPY):
+        case(BLOCK_TYPE_CB_NO_COPY):
+        case(BLOCK_TYPE_SYSDIG_EVENT):
+        case(BLOCK_TYPE_SYSDIG_EVENT_V2):
+            return TRUE;
+
+        default:
+            return FALSE;
+    }
+}
+
 static gboolean
 pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
                   section_info_t *section_info,
@@ -3139,6 +3164,8 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
 
         ws_debug("block_type 0x%08x", bh.block_type);
 
+        wtap_read_ahead_sync(wth);
+
         /*
          * Fill in the section_info_t passed to us for use when
          * there's a new SHB; don't overwrite the existing SHB,
@@ -3210,6 +3237,9 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
             return FALSE;
         }
 
+        if (!pcapng_block_is_record_only(bh.block_type))
+            wtap_read_ahead_sync(wth);
+
         /*
          * ***DO NOT*** add any items to this table that are not
          * standardized block types in the current pcapng spec at
@@ -4789,6 +4819,7 @@ pcapng_write_enhanced_packet_block(wtap_dumper *wdh, const wtap_rec *rec,
     guint32 options_total_length = 0;
     wtap_block_t int_data;
     wtapng_if_descr_mandatory_t *int_data_mand;
+    guint8 hdr[sizeof bh + sizeof epb];
 
     /* Don't write anything we're not willing to read. */
     if (rec->rec_header.packet_header.caplen > wtap_max_snaplen_for_encap(wdh->encap)) {
@@ -4808,15 +4839,11 @@ pcapng_write_enhanced_packet_block(wtap_dumper *wdh, const wtap_rec *rec,
         options_size = compute_options_size(rec->block, compute_epb_option_size);
     }
 
-    /* write (enhanced) packet block header */
+    /* (enhanced) packet block header */
     bh.block_type = BLOCK_TYPE_EPB;
     bh.block_total_length = (guint32)sizeof(bh) + (guint32)sizeof(epb) + phdr_len + rec->rec_header.packet_header.caplen + pad_len + options_total_length + options_size + 4;
 
-    if (!wtap_dump_file_write(wdh, &bh, sizeof bh, err))
-        return FALSE;
-    wdh->bytes_dumped += sizeof bh;
-
-    /* write block fixed content */
+    /* block fixed content */
     if (rec->presence_flags & WTAP_HAS_INTERFACE_ID)
         epb.interface_id        = rec->rec_header.packet_header.interface_id;
     else {
@@ -4861,9 +4888,12 @@ pcapng_write_enhanced_packet_block(wtap_dumper *wdh, const wtap_rec *rec,
     epb.captured_len        = rec->rec_header.packet_header.caplen + phdr_len;
     epb.packet_len          = rec->rec_header.packet_header.len + phdr_len;
 
-    if (!wtap_dump_file_write(wdh, &epb, sizeof epb, err))
+    /* write the block header and fixed content together */
+    memcpy(hdr, &bh, sizeof bh);
+    memcpy(hdr + sizeof bh, &epb, sizeof epb);
+    if (!wtap_dump_file_write(wdh, hdr, sizeof hdr, err))
         return FALSE;
-    wdh->bytes_dumped += sizeof epb;
+    wdh->bytes_dumped += sizeof hdr;
 
     /* write pseudo header */
     if (!pcap_write_phdr(wdh, rec->rec_header.packet_header.pkt_encap, pseudo_header, err)) {
@@ -75,8 +75,17 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    struct wtap_read_ahead      *read_ahead;    /**< read-ahead thread state, or NULL */
 };
 
+/*
+ * Called by a read routine before it changes anything in the wtap
+ * structure other than its private data, or calls one of the
+ * callbacks, so that, if the file is being read ahead on another
+ * thread, the application isn't looking at those while they change.
+ */
+void wtap_read_ahead_sync(wtap *wth);
+
 struct wtap_dumper;
 
 /*
@@ -120,6 +129,12 @@ struct wtap_dumper {
      */
     const GArray            *dsbs_growing;          /**< A reference to an array of DSBs (of type wtap_block_t) */
     guint                   dsbs_growing_written;   /**< Number of already processed DSBs in dsbs_growing. */
+
+    guint8                  *write_buf;      /**< buffer collecting writes to an uncompressed file, or NULL */
+    size_t                  write_buf_size;
+    size_t                  write_buf_len;   /**< bytes in write_buf not yet written to the file */
+    gint64                  flush_interval;  /**< microseconds between flushes in wtap_dump(), or 0 */
+    gint64                  last_flush;      /**< g_get_monotonic_time() at the last flush */
 };
 
 WS_DLL_PUBLIC gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf,
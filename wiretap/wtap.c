@@ -1388,6 +1388,8 @@ wtap_strerror(int err)
 		return g_strerror(err);
 }
 
+static void wtap_stop_read_ahead(wtap *wth);
+
 /* Close only the sequential side, freeing up memory it uses.
 
    Note that we do *not* want to call the subtype's close function,
@@ -1399,6 +1401,8 @@ wtap_strerror(int err)
 void
 wtap_sequential_close(wtap *wth)
 {
+	wtap_stop_read_ahead(wth);
+
 	if (wth->subtype_sequential_close != NULL)
 		(*wth->subtype_sequential_close)(wth);
 
@@ -1423,6 +1427,7 @@ g_fast_seek_item_free(gpointer data, gpointer user_data _U_)
 void
 wtap_fdclose(wtap *wth)
 {
+	wtap_stop_read_ahead(wth);
 	if (wth->fh != NULL)
 		file_fdclose(wth->fh);
 	if (wth->random_fh != NULL)
@@ -1519,8 +1524,8 @@ wtap_init_rec(wtap *wth, wtap_rec *rec)
 	rec->block_was_modified = FALSE;
 }
 
-gboolean
-wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+static gboolean
+wtap_read_record(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	gchar **err_info, gint64 *offset)
 {
 	/*
@@ -1575,6 +1580,248 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	return TRUE;	/* success */
 }
 
+/*
+ * Reading ahead.
+ *
+ * A thread reads records from the sequential stream, decompressing
+ * and parsing them, into a ring of records and buffers; wtap_read()
+ * hands the caller the oldest of them, swapping the caller's record
+ * and buffer into the ring to be read into again, so nothing is
+ * copied.
+ *
+ * Anything that the application can look at other than the record
+ * itself - the section header, interface description, name resolution
+ * and decryption secrets blocks, the file encapsulation type, and the
+ * callbacks for new addresses and secrets - may only be changed by the
+ * reading thread after it's called wtap_read_ahead_sync(), which waits
+ * until the application has taken every record already read and is
+ * blocked in wtap_read().
+ *
+ * The sequential stream and the random-access stream share the fast
+ * seek points for compressed files, so the reading thread holds
+ * io_lock while reading a record and wtap_seek_read() holds it while
+ * reading one.
+ */
+#define READ_AHEAD_RECORDS	64
+
+typedef struct {
+	wtap_rec	rec;
+	Buffer		buf;
+	gint64		offset;		/* offset to return from wtap_read() */
+	gint64		raw_pos;	/* file_tell_raw() after reading the record */
+} read_ahead_slot;
+
+struct wtap_read_ahead {
+	GThread		*thread;
+	GMutex		lock;		/* protects everything below */
+	GCond		cond;
+	GMutex		io_lock;	/* held while reading from the file */
+	read_ahead_slot	slots[READ_AHEAD_RECORDS];
+	guint		head;		/* next slot for wtap_read() to return */
+	guint		count;		/* number of slots read but not returned */
+	gboolean	done;		/* reading thread got EOF or an error */
+	int		err;		/* and what error, if any */
+	gchar		*err_info;
+	gboolean	stop;		/* reading thread should stop */
+	gboolean	reader_waiting;	/* wtap_read() is waiting for a record */
+	gboolean	writer_waiting;	/* reading thread is waiting for a slot */
+	gint64		raw_pos;	/* file_tell_raw() after the last record returned */
+};
+
+/* The wtap whose records the current thread is reading ahead, if any. */
+static GPrivate read_ahead_wth = G_PRIVATE_INIT(NULL);
+
+static gpointer
+wtap_read_ahead_thread(gpointer data)
+{
+	wtap *wth = (wtap *)data;
+	struct wtap_read_ahead *ra = wth->read_ahead;
+	read_ahead_slot *slot;
+	gboolean ok;
+	int err;
+	gchar *err_info;
+
+	g_private_set(&read_ahead_wth, wth);
+
+	g_mutex_lock(&ra->lock);
+	for (;;) {
+		while (ra->count == READ_AHEAD_RECORDS && !ra->stop) {
+			ra->writer_waiting = TRUE;
+			g_cond_wait(&ra->cond, &ra->lock);
+		}
+		ra->writer_waiting = FALSE;
+		if (ra->stop)
+			break;
+
+		/* The slot after the last one read isn't in use by wtap_read(). */
+		slot = &ra->slots[(ra->head + ra->count) % READ_AHEAD_RECORDS];
+		g_mutex_unlock(&ra->lock);
+
+		g_mutex_lock(&ra->io_lock);
+		ok = wtap_read_record(wth, &slot->rec, &slot->buf, &err,
+		    &err_info, &slot->offset);
+		slot->raw_pos = file_tell_raw(wth->fh);
+		g_mutex_unlock(&ra->io_lock);
+
+		g_mutex_lock(&ra->lock);
+		if (!ok) {
+			ra->done = TRUE;
+			ra->err = err;
+			ra->err_info = err_info;
+		} else
+			ra->count++;
+		if (ra->reader_waiting)
+			g_cond_broadcast(&ra->cond);
+		if (!ok)
+			break;
+	}
+	g_mutex_unlock(&ra->lock);
+
+	g_private_set(&read_ahead_wth, NULL);
+	return NULL;
+}
+
+gboolean
+wtap_start_read_ahead(wtap *wth)
+{
+	struct wtap_read_ahead *ra;
+	guint i;
+
+	if (wth->fh == NULL || wth->read_ahead != NULL)
+		return FALSE;
+
+	/*
+	 * Don't read ahead from a pipe; the reading thread could block
+	 * reading it indefinitely, and we'd have to wait for it when
+	 * closing the file.
+	 */
+	if (wth->ispipe)
+		return FALSE;
+
+	/*
+	 * Only file types whose read routines change nothing the
+	 * application can see, other than after wtap_read_ahead_sync(),
+	 * can be read ahead.  pcap files with ERF encapsulation add
+	 * interfaces as they're seen in the records.
+	 */
+	if (wth->file_type_subtype != wtap_pcap_file_type_subtype() &&
+	    wth->file_type_subtype != wtap_pcap_nsec_file_type_subtype() &&
+	    wth->file_type_subtype != wtap_pcapng_file_type_subtype())
+		return FALSE;
+	if (wth->file_encap == WTAP_ENCAP_ERF)
+		return FALSE;
+
+	ra = g_new0(struct wtap_read_ahead, 1);
+	g_mutex_init(&ra->lock);
+	g_cond_init(&ra->cond);
+	g_mutex_init(&ra->io_lock);
+	for (i = 0; i < READ_AHEAD_RECORDS; i++) {
+		wtap_rec_init(&ra->slots[i].rec);
+		ws_buffer_init(&ra->slots[i].buf, 1514);
+	}
+	ra->raw_pos = file_tell_raw(wth->fh);
+	wth->read_ahead = ra;
+	ra->thread = g_thread_new("wtap read-ahead", wtap_read_ahead_thread, wth);
+	return TRUE;
+}
+
+static void
+wtap_stop_read_ahead(wtap *wth)
+{
+	struct wtap_read_ahead *ra = wth->read_ahead;
+	guint i;
+
+	if (ra == NULL)
+		return;
+
+	g_mutex_lock(&ra->lock);
+	ra->stop = TRUE;
+	g_cond_broadcast(&ra->cond);
+	g_mutex_unlock(&ra->lock);
+	g_thread_join(ra->thread);
+
+	for (i = 0; i < READ_AHEAD_RECORDS; i++) {
+		wtap_rec_cleanup(&ra->slots[i].rec);
+		ws_buffer_free(&ra->slots[i].buf);
+	}
+	g_free(ra->err_info);
+	g_mutex_clear(&ra->io_lock);
+	g_cond_clear(&ra->cond);
+	g_mutex_clear(&ra->lock);
+	g_free(ra);
+	wth->read_ahead = NULL;
+}
+
+void
+wtap_read_ahead_sync(wtap *wth)
+{
+	struct wtap_read_ahead *ra = wth->read_ahead;
+
+	/*
+	 * This is a no-op unless we're on the thread reading ahead;
+	 * read routines are also called to read records directly, and
+	 * the records in pcapng files are read by the same code for
+	 * wtap_seek_read().
+	 */
+	if (ra == NULL || g_private_get(&read_ahead_wth) != wth)
+		return;
+
+	g_mutex_unlock(&ra->io_lock);
+	g_mutex_lock(&ra->lock);
+	while (!(ra->reader_waiting && ra->count == 0) && !ra->stop)
+		g_cond_wait(&ra->cond, &ra->lock);
+	g_mutex_unlock(&ra->lock);
+	g_mutex_lock(&ra->io_lock);
+}
+
+gboolean
+wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
+	gchar **err_info, gint64 *offset)
+{
+	struct wtap_read_ahead *ra = wth->read_ahead;
+	read_ahead_slot *slot;
+	wtap_rec tmp_rec;
+	Buffer tmp_buf;
+
+	if (ra == NULL)
+		return wtap_read_record(wth, rec, buf, err, err_info, offset);
+
+	g_mutex_lock(&ra->lock);
+	while (ra->count == 0 && !ra->done) {
+		ra->reader_waiting = TRUE;
+		/* The reading thread might be waiting in wtap_read_ahead_sync(). */
+		g_cond_broadcast(&ra->cond);
+		g_cond_wait(&ra->cond, &ra->lock);
+	}
+	ra->reader_waiting = FALSE;
+	if (ra->count == 0) {
+		/* EOF or an error */
+		g_mutex_unlock(&ra->lock);
+		*err = ra->err;
+		*err_info = g_strdup(ra->err_info);
+		return FALSE;
+	}
+
+	slot = &ra->slots[ra->head];
+	tmp_rec = *rec;
+	*rec = slot->rec;
+	slot->rec = tmp_rec;
+	tmp_buf = *buf;
+	*buf = slot->buf;
+	slot->buf = tmp_buf;
+	*offset = slot->offset;
+	ra->raw_pos = slot->raw_pos;
+	ra->head = (ra->head + 1) % READ_AHEAD_RECORDS;
+	ra->count--;
+	if (ra->writer_waiting)
+		g_cond_broadcast(&ra->cond);
+	g_mutex_unlock(&ra->lock);
+
+	*err = 0;
+	*err_info = NULL;
+	return TRUE;
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -1661,6 +1908,15 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 gint64
 wtap_read_so_far(wtap *wth)
 {
+	struct wtap_read_ahead *ra = wth->read_ahead;
+	gint64 raw_pos;
+
+	if (ra != NULL) {
+		g_mutex_lock(&ra->lock);
+		raw_pos = ra->raw_pos;
+		g_mutex_unlock(&ra->lock);
+		return raw_pos;
+	}
 	return file_tell_raw(wth->fh);
 }
 
@@ -1697,6 +1953,8 @@ gboolean
 wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec, Buffer *buf,
     int *err, gchar **err_info)
 {
+	gboolean ok;
+
 	/*
 	 * Initialize the record to default values.
 	 */
@@ -1704,7 +1962,12 @@ wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec, Buffer *buf,
 
 	*err = 0;
 	*err_info = NULL;
-	if (!wth->subtype_seek_read(wth, seek_off, rec, buf, err, err_info)) {
+	if (wth->read_ahead != NULL)
+		g_mutex_lock(&wth->read_ahead->io_lock);
+	ok = wth->subtype_seek_read(wth, seek_off, rec, buf, err, err_info);
+	if (wth->read_ahead != NULL)
+		g_mutex_unlock(&wth->read_ahead->io_lock);
+	if (!ok) {
 		if (rec->block != NULL) {
 			/*
 			 * Unreference any block created for this record.
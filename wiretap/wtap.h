@@ -1737,6 +1737,23 @@ WS_DLL_PUBLIC
 gboolean wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     gchar **err_info, gint64 *offset);
 
+/** Start reading records ahead of wtap_read() on a separate thread, so
+ * that reading, decompressing and parsing the file overlaps with what
+ * the caller does with the records.  wtap_read() then returns records
+ * from those read ahead, and swaps the wtap_rec and Buffer passed to it
+ * for the ones they were read into.
+ *
+ * This can only be done for files being read from start to end, not
+ * for files being tailed with wtap_cleareof().  Reading ahead stops
+ * when the sequential side of the file is closed.
+ *
+ * @wth a wtap * returned by wtap_open_offline().
+ * @return TRUE if reading ahead was started, FALSE if the file is a
+ * pipe or isn't of a type that supports it.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_start_read_ahead(wtap *wth);
+
 /** Read the record at a specified offset in a capture file, filling in
  * *phdr and *buf.
  *
@@ -1776,7 +1793,8 @@ typedef enum {
     WTAP_UNCOMPRESSED,
     WTAP_GZIP_COMPRESSED,
     WTAP_ZSTD_COMPRESSED,
-    WTAP_LZ4_COMPRESSED
+    WTAP_LZ4_COMPRESSED,
+    WTAP_UNKNOWN_COMPRESSION
 } wtap_compression_type;
 
 WS_DLL_PUBLIC
@@ -1788,6 +1806,21 @@ const char *wtap_compression_type_extension(wtap_compression_type compression_ty
 WS_DLL_PUBLIC
 GSList *wtap_get_all_compression_type_extensions_list(void);
 
+/**
+ * Look up a compression type by name ("gzip", "zstd", "lz4", or "none")
+ * or by file extension; returns WTAP_UNKNOWN_COMPRESSION if there's no
+ * such type, or if support for it wasn't built in.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_name_to_compression_type(const char *name);
+
+/**
+ * Return TRUE if we can write files with this type of compression,
+ * FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
 /*** get various information snippets about the current file ***/
 
 /** Return an approximation of the amount of data we've read sequentially
@@ -2091,6 +2124,24 @@ gboolean wtap_dump(wtap_dumper *, const wtap_rec *, const guint8 *,
      int *err, gchar **err_info);
 WS_DLL_PUBLIC
 gboolean wtap_dump_flush(wtap_dumper *, int *);
+
+/**
+ * Collect what's written to an uncompressed capture file in a buffer,
+ * writing it to the file in one piece when the buffer fills, rather
+ * than through the standard I/O library a piece of a record at a time.
+ * This does nothing for compressed files, which are already written
+ * in large pieces.
+ *
+ * @param wdh The dumper.
+ * @param buffer_size The size of the buffer; 0 means don't buffer.
+ * @param flush_interval_ms If not 0, wtap_dump() also calls
+ * wtap_dump_flush() after a record if it's been at least this many
+ * milliseconds since the file was last flushed, so that programs reading
+ * the file don't fall too far behind.
+ */
+WS_DLL_PUBLIC
+void wtap_dump_set_write_buffer(wtap_dumper *wdh, size_t buffer_size,
+     guint flush_interval_ms);
 WS_DLL_PUBLIC
 int wtap_dump_file_type_subtype(wtap_dumper *wdh);
 WS_DLL_PUBLIC
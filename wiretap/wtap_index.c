@@ -0,0 +1,626 @@
+/* wtap_index.c
+ * Routines for reading and writing sidecar packet index files
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#define WS_LOG_DOMAIN LOG_DOMAIN_WIRETAP
+
+#include <errno.h>
+#include <string.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include "wtap_index.h"
+
+#include <wsutil/file_util.h>
+#include <wsutil/wslog.h>
+
+/*
+ * Index file format; all integers are little-endian.
+ *
+ * Header:
+ *
+ *     magic, "WTAPIDX\0"                      8 bytes
+ *     version, WTAP_INDEX_VERSION             4 bytes
+ *     entry size, WTAP_INDEX_ENTRY_SIZE       4 bytes
+ *     size of the capture file                8 bytes
+ *     number of entries                       8 bytes
+ *     SHA-256 of the capture file's first
+ *     and last WTAP_INDEX_HASH_SPAN bytes    32 bytes
+ *
+ * followed by one entry per record:
+ *
+ *     offset                                  8 bytes
+ *     time stamp seconds                      8 bytes
+ *     time stamp nanoseconds                  4 bytes
+ *     captured length                         4 bytes
+ *     interface ID                            4 bytes
+ *     flags                                   4 bytes
+ *     number of non-record blocks             4 bytes
+ *     reserved                                4 bytes
+ *
+ * followed by a sparse time index, with one entry for each run of
+ * WTAP_INDEX_TIME_SPAN records:
+ *
+ *     earliest time stamp seconds             8 bytes
+ *     earliest time stamp nanoseconds         4 bytes
+ *     latest time stamp seconds               8 bytes
+ *     latest time stamp nanoseconds           4 bytes
+ *     flags, WTAP_INDEX_HAS_TS if any of the
+ *     records has a time stamp                4 bytes
+ *     reserved                                4 bytes
+ */
+#define WTAP_INDEX_MAGIC        "WTAPIDX"
+#define WTAP_INDEX_VERSION      2
+#define WTAP_INDEX_HEADER_SIZE  64
+#define WTAP_INDEX_ENTRY_SIZE   40
+#define WTAP_INDEX_TIME_SIZE    32
+#define WTAP_INDEX_TIME_SPAN    1024
+#define WTAP_INDEX_HASH_SIZE    32
+#define WTAP_INDEX_HASH_SPAN    65536
+
+/* Earliest and latest time stamps in a run of records. */
+typedef struct {
+    nstime_t earliest;
+    nstime_t latest;
+    gboolean has_ts;
+} wtap_index_span;
+
+/*
+ * Files aren't always in time order, so, for each run of records, we
+ * keep the latest time stamp up to the end of the run and the earliest
+ * time stamp from the start of the run on; those are in order, so they
+ * can be searched, and still give the right answer for files that go
+ * back in time here and there.
+ */
+typedef struct {
+    nstime_t latest_before;     /* latest time stamp up to the end of the run */
+    nstime_t earliest_after;    /* earliest time stamp from the start of the run */
+    gboolean any_before;        /* if FALSE, there is no latest_before */
+    gboolean any_after;         /* if FALSE, there is no earliest_after */
+} wtap_index_time;
+
+struct wtap_index {
+    FILE    *fh;
+    guint64  count;
+    guint64  n_spans;
+    wtap_index_time *times;
+};
+
+struct wtap_index_writer {
+    FILE    *fh;
+    char    *capture_path;
+    char    *index_path;
+    char    *tmp_path;
+    guint64  count;
+    GArray  *spans;     /* wtap_index_span for each run of records */
+};
+
+static guint64
+wtap_index_n_spans(guint64 count)
+{
+    return (count + WTAP_INDEX_TIME_SPAN - 1) / WTAP_INDEX_TIME_SPAN;
+}
+
+/*
+ * Number of non-record blocks the reader has handed to libwiretap so
+ * far; each of these is appended to one of these arrays when read.
+ */
+static guint32
+wtap_index_meta_blocks(wtap *wth)
+{
+    guint32 n = 0;
+
+    if (wth->shb_hdrs != NULL)
+        n += wth->shb_hdrs->len;
+    if (wth->interface_data != NULL)
+        n += wth->interface_data->len;
+    if (wth->nrb_hdrs != NULL)
+        n += wth->nrb_hdrs->len;
+    if (wth->dsbs != NULL)
+        n += wth->dsbs->len;
+    return n;
+}
+
+/*
+ * Hash the size and the first and last WTAP_INDEX_HASH_SPAN bytes of a
+ * capture file; that's enough to catch a file that's been rewritten or
+ * appended to, without reading all of a large file.
+ */
+static gboolean
+wtap_index_hash_file(const char *path, gint64 *sizep, guint8 *hash, int *err)
+{
+    ws_statb64 statb;
+    GChecksum *checksum;
+    guint8 *buf;
+    gsize hash_len = WTAP_INDEX_HASH_SIZE;
+    gint64 size, tail_start;
+    ssize_t got;
+    int fd;
+
+    fd = ws_open(path, O_RDONLY|O_BINARY, 0000);
+    if (fd == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    if (ws_fstat64(fd, &statb) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return FALSE;
+    }
+    size = statb.st_size;
+
+    buf = (guint8 *)g_malloc(WTAP_INDEX_HASH_SPAN);
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+    got = ws_read(fd, buf, WTAP_INDEX_HASH_SPAN);
+    if (got < 0)
+        goto fail;
+    g_checksum_update(checksum, buf, got);
+
+    if (size > WTAP_INDEX_HASH_SPAN) {
+        tail_start = size - WTAP_INDEX_HASH_SPAN;
+        if (tail_start < WTAP_INDEX_HASH_SPAN)
+            tail_start = WTAP_INDEX_HASH_SPAN;
+        if (ws_lseek64(fd, tail_start, SEEK_SET) == -1)
+            goto fail;
+        got = ws_read(fd, buf, WTAP_INDEX_HASH_SPAN);
+        if (got < 0)
+            goto fail;
+        g_checksum_update(checksum, buf, got);
+    }
+
+    g_checksum_get_digest(checksum, hash, &hash_len);
+    g_checksum_free(checksum);
+    g_free(buf);
+    ws_close(fd);
+    *sizep = size;
+    return TRUE;
+
+fail:
+    *err = errno;
+    g_checksum_free(checksum);
+    g_free(buf);
+    ws_close(fd);
+    return FALSE;
+}
+
+wtap_index_writer *
+wtap_index_writer_new(wtap *wth, int *err)
+{
+    wtap_index_writer *writer;
+    guint8 header[WTAP_INDEX_HEADER_SIZE];
+
+    *err = 0;
+    if (wth->ispipe || wth->pathname == NULL ||
+        strcmp(wth->pathname, "-") == 0) {
+        *err = WTAP_ERR_CANT_SEEK;
+        return NULL;
+    }
+
+    writer = g_new0(wtap_index_writer, 1);
+    writer->capture_path = g_strdup(wth->pathname);
+    writer->index_path = g_strdup_printf("%s.idx", wth->pathname);
+    writer->tmp_path = g_strdup_printf("%s.idx.tmp", wth->pathname);
+    writer->spans = g_array_new(FALSE, FALSE, sizeof(wtap_index_span));
+    writer->fh = ws_fopen(writer->tmp_path, "wb");
+    if (writer->fh == NULL) {
+        *err = errno;
+        goto fail;
+    }
+
+    /* Reserve space for the header; it's filled in when we're done. */
+    memset(header, 0, sizeof header);
+    if (fwrite(header, 1, sizeof header, writer->fh) != sizeof header) {
+        *err = ferror(writer->fh) ? errno : WTAP_ERR_SHORT_WRITE;
+        fclose(writer->fh);
+        ws_unlink(writer->tmp_path);
+        goto fail;
+    }
+    return writer;
+
+fail:
+    g_array_free(writer->spans, TRUE);
+    g_free(writer->tmp_path);
+    g_free(writer->index_path);
+    g_free(writer->capture_path);
+    g_free(writer);
+    return NULL;
+}
+
+gboolean
+wtap_index_writer_add(wtap_index_writer *writer, wtap *wth,
+    gint64 data_offset, const wtap_rec *rec, int *err)
+{
+    guint8 entry[WTAP_INDEX_ENTRY_SIZE];
+    guint32 flags = 0;
+    guint32 caplen = 0;
+    guint32 interface_id = 0;
+    wtap_index_span *span;
+
+    if (rec->presence_flags & WTAP_HAS_TS)
+        flags |= WTAP_INDEX_HAS_TS;
+    if (rec->rec_type == REC_TYPE_PACKET) {
+        caplen = rec->rec_header.packet_header.caplen;
+        if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
+            flags |= WTAP_INDEX_HAS_INTERFACE_ID;
+            interface_id = rec->rec_header.packet_header.interface_id;
+        }
+    }
+
+    phtole64(&entry[0], (guint64)data_offset);
+    phtole64(&entry[8], (guint64)rec->ts.secs);
+    phtole32(&entry[16], (guint32)rec->ts.nsecs);
+    phtole32(&entry[20], caplen);
+    phtole32(&entry[24], interface_id);
+    phtole32(&entry[28], flags);
+    phtole32(&entry[32], wtap_index_meta_blocks(wth));
+    phtole32(&entry[36], 0);
+
+    if (fwrite(entry, 1, sizeof entry, writer->fh) != sizeof entry) {
+        *err = ferror(writer->fh) ? errno : WTAP_ERR_SHORT_WRITE;
+        return FALSE;
+    }
+
+    if (writer->count % WTAP_INDEX_TIME_SPAN == 0)
+        g_array_set_size(writer->spans, writer->spans->len + 1);
+    span = &g_array_index(writer->spans, wtap_index_span, writer->spans->len - 1);
+    if (flags & WTAP_INDEX_HAS_TS) {
+        if (!span->has_ts || nstime_cmp(&rec->ts, &span->earliest) < 0)
+            span->earliest = rec->ts;
+        if (!span->has_ts || nstime_cmp(&rec->ts, &span->latest) > 0)
+            span->latest = rec->ts;
+        span->has_ts = TRUE;
+    }
+    writer->count++;
+    return TRUE;
+}
+
+gboolean
+wtap_index_writer_close(wtap_index_writer *writer, gboolean commit, int *err)
+{
+    guint8 header[WTAP_INDEX_HEADER_SIZE];
+    guint8 time_entry[WTAP_INDEX_TIME_SIZE];
+    wtap_index_span *span;
+    gint64 size;
+    gboolean ok = TRUE;
+    guint i;
+
+    *err = 0;
+    if (commit) {
+        /* The entries were written in order, so we're at the end. */
+        for (i = 0; i < writer->spans->len; i++) {
+            span = &g_array_index(writer->spans, wtap_index_span, i);
+            memset(time_entry, 0, sizeof time_entry);
+            if (span->has_ts) {
+                phtole64(&time_entry[0], (guint64)span->earliest.secs);
+                phtole32(&time_entry[8], (guint32)span->earliest.nsecs);
+                phtole64(&time_entry[12], (guint64)span->latest.secs);
+                phtole32(&time_entry[20], (guint32)span->latest.nsecs);
+                phtole32(&time_entry[24], WTAP_INDEX_HAS_TS);
+            }
+            if (fwrite(time_entry, 1, sizeof time_entry, writer->fh) != sizeof time_entry) {
+                *err = ferror(writer->fh) ? errno : WTAP_ERR_SHORT_WRITE;
+                ok = FALSE;
+                break;
+            }
+        }
+    }
+    if (commit && ok) {
+        memset(header, 0, sizeof header);
+        memcpy(&header[0], WTAP_INDEX_MAGIC, sizeof WTAP_INDEX_MAGIC);
+        phtole32(&header[8], WTAP_INDEX_VERSION);
+        phtole32(&header[12], WTAP_INDEX_ENTRY_SIZE);
+        if (!wtap_index_hash_file(writer->capture_path, &size, &header[32], err)) {
+            ok = FALSE;
+        } else {
+            phtole64(&header[16], (guint64)size);
+            phtole64(&header[24], writer->count);
+            if (ws_fseek64(writer->fh, 0, SEEK_SET) == -1 ||
+                fwrite(header, 1, sizeof header, writer->fh) != sizeof header) {
+                *err = errno;
+                ok = FALSE;
+            }
+        }
+    }
+    if (fclose(writer->fh) == EOF && ok) {
+        *err = errno;
+        ok = FALSE;
+    }
+
+    if (commit && ok) {
+        /* Windows won't rename over an existing file. */
+        ws_unlink(writer->index_path);
+        if (ws_rename(writer->tmp_path, writer->index_path) == -1) {
+            *err = errno;
+            ok = FALSE;
+        }
+    }
+    if (!commit || !ok)
+        ws_unlink(writer->tmp_path);
+
+    g_array_free(writer->spans, TRUE);
+    g_free(writer->tmp_path);
+    g_free(writer->index_path);
+    g_free(writer->capture_path);
+    g_free(writer);
+    return ok;
+}
+
+wtap_index *
+wtap_index_open(wtap *wth)
+{
+    wtap_index *idx;
+    FILE *fh;
+    char *index_path;
+    guint8 header[WTAP_INDEX_HEADER_SIZE];
+    guint8 hash[WTAP_INDEX_HASH_SIZE];
+    guint8 time_entry[WTAP_INDEX_TIME_SIZE];
+    gint64 size, index_size;
+    guint64 count, n_spans, i;
+    wtap_index_time *times;
+    int err;
+
+    if (wth->ispipe || wth->pathname == NULL ||
+        strcmp(wth->pathname, "-") == 0)
+        return NULL;
+
+    index_path = g_strdup_printf("%s.idx", wth->pathname);
+    fh = ws_fopen(index_path, "rb");
+    g_free(index_path);
+    if (fh == NULL)
+        return NULL;
+
+    if (fread(header, 1, sizeof header, fh) != sizeof header ||
+        memcmp(&header[0], WTAP_INDEX_MAGIC, sizeof WTAP_INDEX_MAGIC) != 0 ||
+        pletoh32(&header[8]) != WTAP_INDEX_VERSION ||
+        pletoh32(&header[12]) != WTAP_INDEX_ENTRY_SIZE)
+        goto stale;
+    count = pletoh64(&header[24]);
+
+    /* Is the index complete? */
+    if (ws_fseek64(fh, 0, SEEK_END) == -1)
+        goto stale;
+    index_size = ws_ftell64(fh);
+    n_spans = wtap_index_n_spans(count);
+    if (index_size < 0 || count > G_MAXINT64 / (WTAP_INDEX_ENTRY_SIZE + WTAP_INDEX_TIME_SIZE) ||
+        (guint64)index_size != WTAP_INDEX_HEADER_SIZE + count * WTAP_INDEX_ENTRY_SIZE +
+                               n_spans * WTAP_INDEX_TIME_SIZE)
+        goto stale;
+
+    /* Is it for this version of the capture file? */
+    if (!wtap_index_hash_file(wth->pathname, &size, hash, &err))
+        goto stale;
+    if ((guint64)size != pletoh64(&header[16]) ||
+        memcmp(hash, &header[32], WTAP_INDEX_HASH_SIZE) != 0) {
+        ws_debug("Ignoring stale index for %s", wth->pathname);
+        goto stale;
+    }
+
+    /*
+     * Read the time index, working out the latest time stamp up to
+     * the end of each run of records as we go.
+     */
+    if (ws_fseek64(fh, WTAP_INDEX_HEADER_SIZE + count * WTAP_INDEX_ENTRY_SIZE, SEEK_SET) == -1)
+        goto stale;
+    times = g_new0(wtap_index_time, n_spans);
+    for (i = 0; i < n_spans; i++) {
+        if (fread(time_entry, 1, sizeof time_entry, fh) != sizeof time_entry) {
+            g_free(times);
+            goto stale;
+        }
+        if (pletoh32(&time_entry[24]) & WTAP_INDEX_HAS_TS) {
+            times[i].earliest_after.secs = (time_t)(gint64)pletoh64(&time_entry[0]);
+            times[i].earliest_after.nsecs = (int)pletoh32(&time_entry[8]);
+            times[i].any_after = TRUE;
+            times[i].latest_before.secs = (time_t)(gint64)pletoh64(&time_entry[12]);
+            times[i].latest_before.nsecs = (int)pletoh32(&time_entry[20]);
+            times[i].any_before = TRUE;
+        }
+        if (i > 0 && times[i - 1].any_before &&
+            (!times[i].any_before ||
+             nstime_cmp(&times[i - 1].latest_before, &times[i].latest_before) > 0)) {
+            times[i].latest_before = times[i - 1].latest_before;
+            times[i].any_before = TRUE;
+        }
+    }
+    /* ...and then the earliest time stamp from the start of each run on. */
+    for (i = n_spans; i > 1; i--) {
+        if (times[i - 1].any_after &&
+            (!times[i - 2].any_after ||
+             nstime_cmp(&times[i - 1].earliest_after, &times[i - 2].earliest_after) < 0)) {
+            times[i - 2].earliest_after = times[i - 1].earliest_after;
+            times[i - 2].any_after = TRUE;
+        }
+    }
+
+    idx = g_new(wtap_index, 1);
+    idx->fh = fh;
+    idx->count = count;
+    idx->n_spans = n_spans;
+    idx->times = times;
+    return idx;
+
+stale:
+    fclose(fh);
+    return NULL;
+}
+
+guint64
+wtap_index_count(const wtap_index *idx)
+{
+    return idx->count;
+}
+
+gboolean
+wtap_index_get(wtap_index *idx, guint64 recno, wtap_index_entry *entry)
+{
+    guint8 buf[WTAP_INDEX_ENTRY_SIZE];
+
+    if (recno >= idx->count)
+        return FALSE;
+    if (ws_fseek64(idx->fh, WTAP_INDEX_HEADER_SIZE + recno * WTAP_INDEX_ENTRY_SIZE, SEEK_SET) == -1 ||
+        fread(buf, 1, sizeof buf, idx->fh) != sizeof buf)
+        return FALSE;
+
+    entry->offset = (gint64)pletoh64(&buf[0]);
+    entry->ts.secs = (time_t)(gint64)pletoh64(&buf[8]);
+    entry->ts.nsecs = (int)pletoh32(&buf[16]);
+    entry->caplen = pletoh32(&buf[20]);
+    entry->interface_id = pletoh32(&buf[24]);
+    entry->flags = pletoh32(&buf[28]);
+    entry->meta_blocks = pletoh32(&buf[32]);
+    return TRUE;
+}
+
+gboolean
+wtap_index_seek(wtap *wth, wtap_index *idx, guint64 recno, int *err)
+{
+    wtap_index_entry entry;
+
+    *err = 0;
+
+    /*
+     * Other readers may keep state that depends on having read every
+     * record in turn; the pcap and pcapng readers only keep state
+     * from non-record blocks, which we check for below.
+     */
+    if (wth->file_type_subtype != wtap_pcap_file_type_subtype() &&
+        wth->file_type_subtype != wtap_pcap_nsec_file_type_subtype() &&
+        wth->file_type_subtype != wtap_pcapng_file_type_subtype())
+        return FALSE;
+
+    if (!wtap_index_get(idx, recno, &entry))
+        return FALSE;
+
+    /*
+     * If any section headers, interface descriptions, name resolution
+     * or decryption secrets blocks would be read before that record,
+     * we can't skip over them.
+     */
+    if (entry.meta_blocks != wtap_index_meta_blocks(wth))
+        return FALSE;
+
+    if (file_seek(wth->fh, entry.offset, SEEK_SET, err) == -1)
+        return FALSE;
+    return TRUE;
+}
+
+/*
+ * Does any record from the start of the file to the end of the given
+ * run of records have a time stamp at or after ts?
+ */
+static gboolean
+wtap_index_any_at_or_after(const wtap_index *idx, guint64 span, const nstime_t *ts)
+{
+    return idx->times[span].any_before &&
+           nstime_cmp(&idx->times[span].latest_before, ts) >= 0;
+}
+
+/*
+ * Does any record from the start of the given run of records to the
+ * end of the file have a time stamp before ts?
+ */
+static gboolean
+wtap_index_any_before(const wtap_index *idx, guint64 span, const nstime_t *ts)
+{
+    return idx->times[span].any_after &&
+           nstime_cmp(&idx->times[span].earliest_after, ts) < 0;
+}
+
+gboolean
+wtap_index_find_time_range(wtap_index *idx, const nstime_t *start,
+    const nstime_t *stop, guint64 *first, guint64 *end)
+{
+    wtap_index_entry entry;
+    guint64 lo, hi, mid, recno, span_end;
+
+    if (start != NULL) {
+        /* Find the first run with a record at or after start... */
+        lo = 0;
+        hi = idx->n_spans;
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (wtap_index_any_at_or_after(idx, mid, start))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        /* ...and the first such record in it. */
+        recno = lo * WTAP_INDEX_TIME_SPAN;
+        span_end = MIN(recno + WTAP_INDEX_TIME_SPAN, idx->count);
+        for (; recno < span_end; recno++) {
+            if (!wtap_index_get(idx, recno, &entry))
+                return FALSE;
+            if ((entry.flags & WTAP_INDEX_HAS_TS) &&
+                nstime_cmp(&entry.ts, start) >= 0)
+                break;
+        }
+        *first = lo < idx->n_spans ? recno : idx->count;
+    }
+
+    if (stop != NULL) {
+        /* Find the last run with a record before stop... */
+        lo = 0;
+        hi = idx->n_spans;
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (wtap_index_any_before(idx, mid, stop))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        /* ...and the last such record in it. */
+        *end = 0;
+        if (lo > 0) {
+            span_end = MIN(lo * WTAP_INDEX_TIME_SPAN, idx->count);
+            for (recno = (lo - 1) * WTAP_INDEX_TIME_SPAN; recno < span_end; recno++) {
+                if (!wtap_index_get(idx, recno, &entry))
+                    return FALSE;
+                if ((entry.flags & WTAP_INDEX_HAS_TS) &&
+                    nstime_cmp(&entry.ts, stop) < 0)
+                    *end = recno + 1;
+            }
+        }
+    }
+    return TRUE;
+}
+
+gboolean
+wtap_seek_to_time(wtap *wth, wtap_index *idx, const nstime_t *ts,
+    guint64 *recno, int *err)
+{
+    *err = 0;
+    if (!wtap_index_find_time_range(idx, ts, NULL, recno, NULL))
+        return FALSE;
+    if (*recno >= idx->count)
+        return FALSE;
+    return wtap_index_seek(wth, idx, *recno, err);
+}
+
+void
+wtap_index_close(wtap_index *idx)
+{
+    fclose(idx->fh);
+    g_free(idx->times);
+    g_free(idx);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indent=4:tabSize=8:noTabs=true:
+ */
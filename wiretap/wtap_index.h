@@ -0,0 +1,176 @@
+/* wtap_index.h
+ * Definitions for sidecar packet index files
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WTAP_INDEX_H__
+#define __WTAP_INDEX_H__
+
+#include "wiretap/wtap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A packet index is a file, next to a capture file and with ".idx"
+ * appended to its name, listing, for each record in the capture file,
+ * where the record starts and a few things about it, so that a program
+ * can find a given record without reading all the records before it.
+ *
+ * The index includes the size of the capture file and a hash of its
+ * first and last 64 KiB, and isn't used if they don't match the capture
+ * file, so a capture file that's been changed since the index was
+ * written doesn't get looked up using a stale index.
+ */
+
+#define WTAP_INDEX_HAS_TS            0x00000001  /**< ts is valid */
+#define WTAP_INDEX_HAS_INTERFACE_ID  0x00000002  /**< interface_id is valid */
+
+/**
+ * An entry in a packet index.
+ */
+typedef struct {
+    gint64   offset;        /**< data_offset returned by wtap_read() for the record */
+    nstime_t ts;            /**< time stamp, if flags has WTAP_INDEX_HAS_TS */
+    guint32  caplen;        /**< captured length, for packet records */
+    guint32  interface_id;  /**< interface ID, if flags has WTAP_INDEX_HAS_INTERFACE_ID */
+    guint32  flags;
+    guint32  meta_blocks;   /**< number of non-record blocks (section headers,
+                                 interface descriptions, name resolution,
+                                 decryption secrets) read up to this record */
+} wtap_index_entry;
+
+typedef struct wtap_index wtap_index;
+typedef struct wtap_index_writer wtap_index_writer;
+
+/**
+ * Start writing a packet index for a capture file opened with
+ * wtap_open_offline(); the records must then be added, in order, with
+ * wtap_index_writer_add() as they're read with wtap_read().
+ *
+ * @param wth The capture file.
+ * @param[out] err Set to an errno or WTAP_ERR_ value on failure.
+ * @return The writer, or NULL if the index can't be written (for
+ * example, because the capture file is a pipe).
+ */
+WS_DLL_PUBLIC
+wtap_index_writer *wtap_index_writer_new(wtap *wth, int *err);
+
+/**
+ * Add the record just read with wtap_read() to the index.
+ *
+ * @return TRUE on success, FALSE and *err set on a write error.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_index_writer_add(wtap_index_writer *writer, wtap *wth,
+    gint64 data_offset, const wtap_rec *rec, int *err);
+
+/**
+ * Finish writing the index.  If commit is TRUE, all the records in the
+ * capture file must have been added, and the index is put in place;
+ * otherwise it's discarded.  The writer is freed in either case.
+ *
+ * @return TRUE on success, FALSE and *err set on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_index_writer_close(wtap_index_writer *writer, gboolean commit,
+    int *err);
+
+/**
+ * Open the packet index for a capture file opened with
+ * wtap_open_offline().
+ *
+ * @return The index, or NULL if there isn't one or it doesn't match
+ * the capture file.
+ */
+WS_DLL_PUBLIC
+wtap_index *wtap_index_open(wtap *wth);
+
+/** Return the number of records in the index. */
+WS_DLL_PUBLIC
+guint64 wtap_index_count(const wtap_index *idx);
+
+/**
+ * Get the entry for a record.
+ *
+ * @param idx The index.
+ * @param recno The record number, starting at 0.
+ * @param[out] entry The entry.
+ * @return TRUE on success, FALSE if recno is out of range or the index
+ * couldn't be read.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_index_get(wtap_index *idx, guint64 recno, wtap_index_entry *entry);
+
+/**
+ * Position the capture file so that the next wtap_read() returns the
+ * given record.  This is only possible for pcap and pcapng files, and
+ * only if no non-record blocks lie between the current position and the
+ * record, as they would otherwise be skipped.
+ *
+ * @param wth The capture file.
+ * @param idx The index for the capture file.
+ * @param recno The record number, starting at 0.
+ * @param[out] err Set to 0 if the seek can't be done, or to an error
+ * code if the seek failed.
+ * @return TRUE if the capture file was positioned, FALSE otherwise, in
+ * which case the file position is unchanged if *err is 0.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_index_seek(wtap *wth, wtap_index *idx, guint64 recno, int *err);
+
+/**
+ * Find the records that can have a time stamp in a range.  Records
+ * with no time stamp are taken to be outside every range.  Capture
+ * files needn't be in time order; the records outside the range that
+ * are found this way are the ones before the first record in the range
+ * and after the last one, however the records in between are ordered.
+ *
+ * @param idx The index.
+ * @param start If not NULL, the start of the range.
+ * @param stop If not NULL, the end of the range, which isn't in it.
+ * @param[out] first If start isn't NULL, set to the number of the first
+ * record with a time stamp at or after start, or to the number of
+ * records if there isn't one.
+ * @param[out] end If stop isn't NULL, set to one more than the number of
+ * the last record with a time stamp before stop, or to 0 if there
+ * isn't one.
+ * @return TRUE on success, FALSE if the index couldn't be read.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_index_find_time_range(wtap_index *idx, const nstime_t *start,
+    const nstime_t *stop, guint64 *first, guint64 *end);
+
+/**
+ * Position the capture file so that the next wtap_read() returns the
+ * first record with a time stamp at or after ts, as for
+ * wtap_index_seek().
+ *
+ * @param wth The capture file.
+ * @param idx The index for the capture file.
+ * @param ts The time stamp.
+ * @param[out] recno Set to the number of the record, starting at 0, or
+ * to the number of records if no record has a time stamp at or after
+ * ts; it's set even if the seek can't be done.
+ * @param[out] err Set to 0 if the seek can't be done, or to an error
+ * code if the seek failed.
+ * @return TRUE if the capture file was positioned, FALSE otherwise.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_seek_to_time(wtap *wth, wtap_index *idx, const nstime_t *ts,
+    guint64 *recno, int *err);
+
+/** Close a packet index. */
+WS_DLL_PUBLIC
+void wtap_index_close(wtap_index *idx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WTAP_INDEX_H__ */
@@ -0,0 +1,109 @@
+/* murmur3.c
+ * MurmurHash3, a fast non-cryptographic hash function
+ * Based on the public domain MurmurHash3 code by Austin Appleby
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <wsutil/murmur3.h>
+#include <wsutil/pint.h>
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline guint64
+fmix64(guint64 k)
+{
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
+
+void murmur3_x64_128(const guint8 *buf, size_t len, guint32 seed,
+                     guint8 digest[MURMUR3_128_LEN])
+{
+  const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+  const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+  const guint8 *tail;
+  guint64 h1 = seed;
+  guint64 h2 = seed;
+  guint64 k1, k2;
+  size_t nblocks = len / 16;
+  size_t i;
+
+  /* body */
+  for (i = 0; i < nblocks; i++) {
+    k1 = pletoh64(buf + i * 16);
+    k2 = pletoh64(buf + i * 16 + 8);
+
+    k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  /* tail */
+  tail = buf + nblocks * 16;
+  k1 = 0;
+  k2 = 0;
+  switch (len & 15) {
+  case 15: k2 ^= ((guint64)tail[14]) << 48; /* FALLTHROUGH */
+  case 14: k2 ^= ((guint64)tail[13]) << 40; /* FALLTHROUGH */
+  case 13: k2 ^= ((guint64)tail[12]) << 32; /* FALLTHROUGH */
+  case 12: k2 ^= ((guint64)tail[11]) << 24; /* FALLTHROUGH */
+  case 11: k2 ^= ((guint64)tail[10]) << 16; /* FALLTHROUGH */
+  case 10: k2 ^= ((guint64)tail[ 9]) << 8;  /* FALLTHROUGH */
+  case  9: k2 ^= ((guint64)tail[ 8]);
+           k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+           /* FALLTHROUGH */
+  case  8: k1 ^= ((guint64)tail[ 7]) << 56; /* FALLTHROUGH */
+  case  7: k1 ^= ((guint64)tail[ 6]) << 48; /* FALLTHROUGH */
+  case  6: k1 ^= ((guint64)tail[ 5]) << 40; /* FALLTHROUGH */
+  case  5: k1 ^= ((guint64)tail[ 4]) << 32; /* FALLTHROUGH */
+  case  4: k1 ^= ((guint64)tail[ 3]) << 24; /* FALLTHROUGH */
+  case  3: k1 ^= ((guint64)tail[ 2]) << 16; /* FALLTHROUGH */
+  case  2: k1 ^= ((guint64)tail[ 1]) << 8;  /* FALLTHROUGH */
+  case  1: k1 ^= ((guint64)tail[ 0]);
+           k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+
+  /* finalization */
+  h1 ^= (guint64)len;
+  h2 ^= (guint64)len;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  phtole64(digest, h1);
+  phtole64(digest + 8, h2);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local Variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
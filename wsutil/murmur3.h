@@ -0,0 +1,38 @@
+/* murmur3.h
+ * MurmurHash3, a fast non-cryptographic hash function
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef MURMUR3_H
+#define MURMUR3_H
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define MURMUR3_128_LEN 16
+
+/*
+ * Compute the 128-bit x64 variant of MurmurHash3 of a buffer.  It's
+ * much faster than a cryptographic hash, and good for hash tables and
+ * for spotting duplicate data, but mustn't be relied upon where someone
+ * could deliberately construct collisions.  The result is the same on
+ * big- and little-endian hosts.
+ */
+WS_DLL_PUBLIC void murmur3_x64_128(const guint8 *buf, size_t len, guint32 seed,
+                                   guint8 digest[MURMUR3_128_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* MURMUR3_H */
@@ -9,6 +9,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <wsutil/utf8_entities.h>
 
@@ -294,6 +295,47 @@ void test_int64_to_str_back(void)
     g_assert_cmpstr(str, ==, "9223372036854775807");
 }
 
+#include "murmur3.h"
+
+static void test_murmur3_x64_128(void)
+{
+    /* Known answers from the reference MurmurHash3_x64_128, with the
+     * digest as h1 then h2, each little-endian. */
+    static const struct {
+        const char *data;
+        guint32 seed;
+        guint8 digest[MURMUR3_128_LEN];
+    } vectors[] = {
+        { "", 0,
+          { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+        { "", 1,
+          { 0xb5, 0x5c, 0xff, 0x6e, 0xe5, 0xab, 0x10, 0x46,
+            0x83, 0x35, 0xf8, 0x78, 0xaa, 0x2d, 0x62, 0x51 } },
+        { "a", 0,
+          { 0x89, 0x78, 0x59, 0xf6, 0x65, 0x55, 0x55, 0x85,
+            0x5a, 0x89, 0x0e, 0x51, 0x48, 0x3a, 0xb5, 0xe6 } },
+        /* One block, no tail */
+        { "0123456789abcdef", 0,
+          { 0xa7, 0xd1, 0x4a, 0xcf, 0x94, 0x6d, 0xe0, 0x4b,
+            0xda, 0x08, 0xa7, 0x63, 0x5c, 0x5b, 0xc3, 0x87 } },
+        /* One block and a 15-byte tail */
+        { "0123456789abcdefghijklmnopqrstu", 0x9747b28c,
+          { 0xe0, 0x07, 0xe2, 0x3c, 0x6b, 0x0a, 0x71, 0x76,
+            0x18, 0xc9, 0x67, 0xc6, 0xef, 0x56, 0xa2, 0x49 } },
+        { "The quick brown fox jumps over the lazy dog", 0,
+          { 0x6c, 0x1b, 0x07, 0xbc, 0x7b, 0xbc, 0x4b, 0xe3,
+            0x47, 0x93, 0x9a, 0xc4, 0xa9, 0x3c, 0x43, 0x7a } },
+    };
+    guint8 digest[MURMUR3_128_LEN];
+
+    for (size_t i = 0; i < G_N_ELEMENTS(vectors); i++) {
+        murmur3_x64_128((const guint8 *)vectors[i].data,
+                        strlen(vectors[i].data), vectors[i].seed, digest);
+        g_assert_true(memcmp(digest, vectors[i].digest, sizeof digest) == 0);
+    }
+}
+
 #include "ws_getopt.h"
 
 #define ARGV_MAX 31
@@ -454,6 +496,8 @@ int main(int argc, char **argv)
     g_test_add_func("/to_str/int_to_str_back", test_int_to_str_back);
     g_test_add_func("/to_str/int64_to_str_back", test_int64_to_str_back);
 
+    g_test_add_func("/murmur3/x64_128", test_murmur3_x64_128);
+
     g_test_add_func("/ws_getopt/basic1", test_getopt_long_basic1);
     g_test_add_func("/ws_getopt/basic2", test_getopt_long_basic2);
     g_test_add_func("/ws_getopt/opterr1", test_getopt_opterr1);
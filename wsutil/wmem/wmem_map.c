@@ -10,15 +10,19 @@
  */
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
+#include <wsutil/bits_ctz.h>
+
 #include "wmem_core.h"
 #include "wmem_list.h"
 #include "wmem_map.h"
 #include "wmem_map_int.h"
 #include "wmem_user_cb.h"
 
-static guint32 x; /* Used for universal integer hashing (see the HASH macro) */
+static guint64 x; /* Used for universal integer hashing (see wmem_map_hash) */
 
 /* Used for the wmem_strong_hash() function */
 static guint32 preseed;
@@ -27,22 +31,37 @@ static guint32 postseed;
 void
 wmem_init_hashing(void)
 {
-    x = g_random_int();
-    if (G_UNLIKELY(x == 0))
-        x = 1;
+    /* Multiply-shift hashing needs an odd multiplier */
+    x = ((guint64)g_random_int() << 32 | g_random_int()) | 1;
 
     preseed  = g_random_int();
     postseed = g_random_int();
 }
 
+/* The map is an open-addressed table in the style of Abseil's "Swiss tables".
+ * Items are stored inline in an array of slots, and a parallel array holds one
+ * control byte per slot: either EMPTY, DELETED (a tombstone), or, for a full
+ * slot, 7 bits of the item's hash. Lookups load a group of control bytes at a
+ * time and compare all of them against the hash bits at once, so the key
+ * comparison function is (almost) only ever called on the item being looked
+ * for, and no pointers need to be chased to get there.
+ *
+ * Growing the table does not rehash everything at once. The old table is kept
+ * around and its items are moved over a few at a time by each subsequent
+ * insertion or removal; until that has finished, lookups check both tables.
+ */
+
 typedef struct _wmem_map_item_t {
     const void *key;
     void *value;
-    struct _wmem_map_item_t *next;
 } wmem_map_item_t;
 
-struct _wmem_map_t {
-    guint count; /* number of items stored */
+typedef struct _wmem_map_table_t {
+    /* CAPACITY + GROUP_WIDTH control bytes. The last GROUP_WIDTH bytes mirror
+     * the first ones, so that a group can always be loaded with a single read
+     * even when it wraps around the end of the table. */
+    guint8 *ctrl;
+    wmem_map_item_t *slots;
 
     /* The base-2 logarithm of the actual size of the table. We store this
      * value for efficiency in hashing, since finding the actual capacity
@@ -50,7 +69,19 @@ struct _wmem_map_t {
      * logarithms is expensive. */
     size_t capacity;
 
-    wmem_map_item_t **table;
+    guint count;       /* number of items stored in this table */
+    size_t growth_left; /* number of EMPTY slots that may still be used */
+} wmem_map_table_t;
+
+struct _wmem_map_t {
+    guint count; /* number of items stored */
+
+    wmem_map_table_t table;
+
+    /* The previous table while it is being drained into 'table' after a
+     * resize (ctrl is NULL otherwise), and the next slot of it to move. */
+    wmem_map_table_t old_table;
+    size_t migrate_pos;
 
     GHashFunc  hash_func;
     GEqualFunc eql_func;
@@ -62,26 +93,250 @@ struct _wmem_map_t {
     wmem_allocator_t *data_allocator;
 };
 
-/* As per the comment on the 'capacity' member of the wmem_map_t struct, this is
- * the base-2 logarithm, meaning the actual default capacity is 2^5 = 32 */
+/* As per the comment on the 'capacity' member of the wmem_map_table_t struct,
+ * this is the base-2 logarithm, meaning the actual default capacity is
+ * 2^5 = 32 */
 #define WMEM_MAP_DEFAULT_CAPACITY 5
 
-/* Macro for calculating the real capacity of the map by using a left-shift to
+/* Macro for calculating the real capacity of a table by using a left-shift to
  * do the 2^x operation. */
-#define CAPACITY(MAP) (((size_t)1) << (MAP)->capacity)
+#define CAPACITY(TABLE) (((size_t)1) << (TABLE)->capacity)
+
+/* Tables are kept at most 7/8 full (counting tombstones), which guarantees
+ * that every probe sequence ends at an EMPTY slot. */
+#define MAX_LOAD(CAP) ((CAP) - (CAP) / 8)
+
+/* Number of old-table slots moved to the new table by each insertion or
+ * removal while a resize is in progress. Any value of at least 2 finishes the
+ * move before the new table can fill up. */
+#define MIGRATE_SLOTS 16
+
+/* Control bytes. Full slots have the top bit clear. */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+#define CTRL_IS_FULL(C) (((C) & 0x80) == 0)
 
 /* Efficient universal integer hashing:
  * https://en.wikipedia.org/wiki/Universal_hashing#Avoiding_modular_arithmetic
+ * The slot is taken from the top bits of the product, and the 7 bits below
+ * those are what is stored in the control byte (H1 and H2 respectively).
  */
-#define HASH(MAP, KEY) \
-    ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
+#define H1(HASH, TABLE) ((size_t)((HASH) >> (64 - (TABLE)->capacity)))
+#define H2(HASH, TABLE) ((guint8)(((HASH) >> (57 - (TABLE)->capacity)) & 0x7F))
+
+static inline guint64
+wmem_map_hash(const wmem_map_t *map, const void *key)
+{
+    return (guint64)map->hash_func(key) * x;
+}
+
+/* Control bytes are matched a group at a time using SIMD-within-a-register
+ * operations on a 64-bit word, which works on every platform. Each match
+ * function returns a mask with the top bit of every matching byte set. */
+#define GROUP_WIDTH 8
+#define GROUP_LSBS  G_GUINT64_CONSTANT(0x0101010101010101)
+#define GROUP_MSBS  G_GUINT64_CONSTANT(0x8080808080808080)
+
+/* Index of the first and last matching byte in a (non-zero) mask, and the
+ * mask with the first match cleared. */
+#define MATCH_FIRST(MASK) ((size_t)ws_ctz(MASK) >> 3)
+#define MATCH_LAST(MASK)  ((size_t)ws_ilog2(MASK) >> 3)
+#define MATCH_NEXT(MASK)  ((MASK) & ((MASK) - 1))
+
+#ifdef __GNUC__
+#define PREFETCH(ADDR) __builtin_prefetch(ADDR)
+#else
+#define PREFETCH(ADDR)
+#endif
+
+static inline guint64
+group_load(const guint8 *ctrl)
+{
+    guint64 group;
+
+    memcpy(&group, ctrl, sizeof group);
+    return GUINT64_FROM_LE(group);
+}
+
+/* May report false positives for a byte directly after a real match, which
+ * costs a wasted key comparison but is otherwise harmless. Never matches
+ * EMPTY or DELETED bytes. */
+static inline guint64
+group_match(guint64 group, guint8 h2)
+{
+    guint64 v = group ^ (GROUP_LSBS * h2);
+
+    return (v - GROUP_LSBS) & ~v & GROUP_MSBS;
+}
+
+static inline guint64
+group_match_empty(guint64 group)
+{
+    /* EMPTY is the only control byte with the top bit set and bit 1 clear */
+    return group & (~group << 6) & GROUP_MSBS;
+}
+
+static inline guint64
+group_match_empty_or_deleted(guint64 group)
+{
+    /* EMPTY and DELETED are the only control bytes with the top bit set and
+     * bit 0 clear */
+    return group & (~group << 7) & GROUP_MSBS;
+}
+
+static inline void
+table_set_ctrl(wmem_map_table_t *table, size_t i, guint8 ctrl)
+{
+    table->ctrl[i] = ctrl;
+    /* Update the mirrored copy as well; for i >= GROUP_WIDTH this is just
+     * the same byte again. */
+    table->ctrl[((i - GROUP_WIDTH) & (CAPACITY(table) - 1)) + GROUP_WIDTH] = ctrl;
+}
+
+static void
+table_init(wmem_map_t *map, wmem_map_table_t *table, size_t capacity)
+{
+    table->capacity    = capacity;
+    table->ctrl        = (guint8 *)wmem_alloc(map->data_allocator, CAPACITY(table) + GROUP_WIDTH);
+    table->slots       = wmem_alloc_array(map->data_allocator, wmem_map_item_t, CAPACITY(table));
+    table->count       = 0;
+    table->growth_left = MAX_LOAD(CAPACITY(table));
+
+    memset(table->ctrl, CTRL_EMPTY, CAPACITY(table) + GROUP_WIDTH);
+}
+
+static void
+table_free(wmem_map_t *map, wmem_map_table_t *table)
+{
+    wmem_free(map->data_allocator, table->ctrl);
+    wmem_free(map->data_allocator, table->slots);
+    table->ctrl  = NULL;
+    table->slots = NULL;
+    table->count = 0;
+}
+
+/* Returns the slot holding key, or -1 if it isn't in this table. The probe
+ * sequence visits groups at triangular offsets from the home slot, which
+ * covers the whole table since its size is a power of two. */
+static gssize
+table_find(const wmem_map_t *map, const wmem_map_table_t *table,
+        guint64 hash, const void *key)
+{
+    size_t  mask   = CAPACITY(table) - 1;
+    size_t  pos    = H1(hash, table);
+    size_t  stride = 0;
+    guint8  h2     = H2(hash, table);
+    guint64 group, match;
+    size_t  i;
+
+    /* The item is almost always in the first group; start fetching it while
+     * the control bytes are being loaded and matched. */
+    PREFETCH(&table->slots[pos]);
+
+    for (;;) {
+        group = group_load(&table->ctrl[pos]);
+
+        for (match = group_match(group, h2); match; match = MATCH_NEXT(match)) {
+            i = (pos + MATCH_FIRST(match)) & mask;
+            if (map->eql_func(key, table->slots[i].key)) {
+                return (gssize)i;
+            }
+        }
+
+        if (group_match_empty(group)) {
+            return -1;
+        }
+
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* Adds an item that is known not to be in the table yet. The caller must have
+ * made sure that growth_left is non-zero. */
+static void
+table_insert_new(wmem_map_table_t *table, guint64 hash, const void *key, void *value)
+{
+    size_t  mask   = CAPACITY(table) - 1;
+    size_t  pos    = H1(hash, table);
+    size_t  stride = 0;
+    guint64 match;
+    size_t  i;
+
+    for (;;) {
+        match = group_match_empty_or_deleted(group_load(&table->ctrl[pos]));
+        if (match) {
+            break;
+        }
+        stride += GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+
+    i = (pos + MATCH_FIRST(match)) & mask;
+    if (table->ctrl[i] == CTRL_EMPTY) {
+        table->growth_left--;
+    }
+    table_set_ctrl(table, i, H2(hash, table));
+    table->slots[i].key   = key;
+    table->slots[i].value = value;
+    table->count++;
+}
+
+static void
+table_erase(wmem_map_table_t *table, size_t i)
+{
+    size_t  mask = CAPACITY(table) - 1;
+    guint64 empty_before, empty_after;
+
+    /* If the slot lies in a run of fewer than GROUP_WIDTH non-empty slots, no
+     * probe can ever have gone past it, so it can simply become EMPTY again.
+     * Otherwise it has to be a tombstone. */
+    empty_before = group_match_empty(group_load(&table->ctrl[(i - GROUP_WIDTH) & mask]));
+    empty_after  = group_match_empty(group_load(&table->ctrl[i]));
+
+    if (empty_before && empty_after &&
+            MATCH_FIRST(empty_after) + (GROUP_WIDTH - 1 - MATCH_LAST(empty_before)) < GROUP_WIDTH) {
+        table_set_ctrl(table, i, CTRL_EMPTY);
+        table->growth_left++;
+    } else {
+        table_set_ctrl(table, i, CTRL_DELETED);
+    }
+    table->count--;
+}
+
+/* Moves up to 'slots' slots worth of items from the old table to the current
+ * one, freeing the old table once it is empty. */
+static void
+wmem_map_migrate(wmem_map_t *map, size_t slots)
+{
+    wmem_map_table_t *old = &map->old_table;
+    size_t            end, i;
+
+    end = CAPACITY(old) - map->migrate_pos;
+    end = map->migrate_pos + MIN(slots, end);
+
+    for (i = map->migrate_pos; i < end && old->count > 0; i++) {
+        if (CTRL_IS_FULL(old->ctrl[i])) {
+            table_insert_new(&map->table, wmem_map_hash(map, old->slots[i].key),
+                    old->slots[i].key, old->slots[i].value);
+            /* keep probe sequences through this slot intact for lookups
+             * of items that haven't been moved yet */
+            table_set_ctrl(old, i, CTRL_DELETED);
+            old->count--;
+        }
+    }
+    map->migrate_pos = i;
+
+    if (old->count == 0) {
+        table_free(map, old);
+    }
+}
 
 static void
 wmem_map_init_table(wmem_map_t *map)
 {
-    map->count     = 0;
-    map->capacity  = WMEM_MAP_DEFAULT_CAPACITY;
-    map->table     = wmem_alloc0_array(map->data_allocator, wmem_map_item_t*, CAPACITY(map));
+    map->count = 0;
+    table_init(map, &map->table, WMEM_MAP_DEFAULT_CAPACITY);
 }
 
 wmem_map_t *
@@ -90,14 +345,12 @@ wmem_map_new(wmem_allocator_t *allocator,
 {
     wmem_map_t *map;
 
-    map = wmem_new(allocator, wmem_map_t);
+    map = wmem_new0(allocator, wmem_map_t);
 
     map->hash_func = hash_func;
     map->eql_func  = eql_func;
     map->metadata_allocator    = allocator;
     map->data_allocator = allocator;
-    map->count = 0;
-    map->table = NULL;
 
     return map;
 }
@@ -109,7 +362,8 @@ wmem_map_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
     wmem_map_t *map = (wmem_map_t*)user_data;
 
     map->count = 0;
-    map->table = NULL;
+    map->table.ctrl = NULL;
+    map->old_table.ctrl = NULL;
 
     if (event == WMEM_CB_DESTROY_EVENT) {
         wmem_unregister_callback(map->metadata_allocator, map->metadata_scope_cb_id);
@@ -136,14 +390,12 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
 {
     wmem_map_t *map;
 
-    map = wmem_new(metadata_scope, wmem_map_t);
+    map = wmem_new0(metadata_scope, wmem_map_t);
 
     map->hash_func = hash_func;
     map->eql_func  = eql_func;
     map->metadata_allocator = metadata_scope;
     map->data_allocator = data_scope;
-    map->count = 0;
-    map->table = NULL;
 
     map->metadata_scope_cb_id = wmem_register_callback(metadata_scope, wmem_map_destroy_cb, map);
     map->data_scope_cb_id  = wmem_register_callback(data_scope, wmem_map_reset_cb, map);
@@ -151,77 +403,100 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
     return map;
 }
 
-static inline void
+/* Called when the current table has no EMPTY slots left to use. */
+static void
 wmem_map_grow(wmem_map_t *map)
 {
-    wmem_map_item_t **old_table, *cur, *nxt;
-    size_t            old_cap, i;
-    guint             slot;
-
-    /* store the old table and capacity */
-    old_table = map->table;
-    old_cap   = CAPACITY(map);
+    size_t capacity = map->table.capacity;
+
+    /* The previous resize should have finished long before now, but make
+     * sure we never have more than two tables. */
+    if (map->old_table.ctrl != NULL) {
+        wmem_map_migrate(map, CAPACITY(&map->old_table));
+        if (map->table.growth_left > 0) {
+            return;
+        }
+    }
 
     /* double the size (capacity is base-2 logarithm, so this just means
-     * increment it) and allocate new table */
-    map->capacity++;
-    map->table = wmem_alloc0_array(map->data_allocator, wmem_map_item_t*, CAPACITY(map));
-
-    /* copy all the elements over from the old table */
-    for (i=0; i<old_cap; i++) {
-        cur = old_table[i];
-        while (cur) {
-            nxt              = cur->next;
-            slot             = HASH(map, cur->key);
-            cur->next        = map->table[slot];
-            map->table[slot] = cur;
-            cur              = nxt;
+     * increment it), unless the table is mostly tombstones, in which case
+     * a table of the same size is enough to get rid of them */
+    if (map->table.count >= MAX_LOAD(CAPACITY(&map->table)) / 2) {
+        capacity++;
+    }
+
+    map->old_table   = map->table;
+    map->migrate_pos = 0;
+    table_init(map, &map->table, capacity);
+
+    wmem_map_migrate(map, MIGRATE_SLOTS);
+}
+
+/* Looks the key up in both tables. */
+static wmem_map_item_t *
+wmem_map_find_hashed(wmem_map_t *map, guint64 hash, const void *key)
+{
+    gssize i;
+
+    i = table_find(map, &map->table, hash, key);
+    if (i >= 0) {
+        return &map->table.slots[i];
+    }
+
+    if (map->old_table.ctrl != NULL) {
+        i = table_find(map, &map->old_table, hash, key);
+        if (i >= 0) {
+            return &map->old_table.slots[i];
         }
     }
 
-    /* free the old table */
-    wmem_free(map->data_allocator, old_table);
+    return NULL;
+}
+
+static wmem_map_item_t *
+wmem_map_find(wmem_map_t *map, const void *key)
+{
+    /* Make sure we have a table */
+    if (map->table.ctrl == NULL) {
+        return NULL;
+    }
+
+    return wmem_map_find_hashed(map, wmem_map_hash(map, key), key);
 }
 
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
-    wmem_map_item_t **item;
+    wmem_map_item_t *item;
+    guint64 hash;
     void *old_val;
 
     /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (map->table.ctrl == NULL) {
         wmem_map_init_table(map);
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
+    hash = wmem_map_hash(map, key);
+    item = wmem_map_find_hashed(map, hash, key);
+    if (item) {
+        /* replace and return old value for this key */
+        old_val = item->value;
+        item->value = value;
+        return old_val;
+    }
 
-    /* check existing items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* replace and return old value for this key */
-            old_val = (*item)->value;
-            (*item)->value = value;
-            return old_val;
-        }
-        item = &((*item)->next);
+    /* make room if we are over-full, otherwise help along a resize that
+     * is in progress */
+    if (map->table.growth_left == 0) {
+        wmem_map_grow(map);
+    } else if (map->old_table.ctrl != NULL) {
+        wmem_map_migrate(map, MIGRATE_SLOTS);
     }
 
     /* insert new item */
-    (*item) = wmem_new(map->data_allocator, wmem_map_item_t);
-
-    (*item)->key   = key;
-    (*item)->value = value;
-    (*item)->next  = NULL;
-
+    table_insert_new(&map->table, hash, key, value);
     map->count++;
 
-    /* increase size if we are over-full */
-    if (map->count >= CAPACITY(map)) {
-        wmem_map_grow(map);
-    }
-
     /* no previous entry, return NULL */
     return NULL;
 }
@@ -229,25 +504,7 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 gboolean
 wmem_map_contains(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t *item;
-
-    /* Make sure we have a table */
-    if (map->table == NULL) {
-        return FALSE;
-    }
-
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return TRUE;
-        }
-        item = item->next;
-    }
-
-    return FALSE;
+    return wmem_map_find(map, key) != NULL;
 }
 
 void *
@@ -255,23 +512,9 @@ wmem_map_lookup(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
-        return NULL;
-    }
+    item = wmem_map_find(map, key);
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
-
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return item->value;
-        }
-        item = item->next;
-    }
-
-    return NULL;
+    return item ? item->value : NULL;
 }
 
 gboolean
@@ -279,108 +522,99 @@ wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key
 {
     wmem_map_item_t *item;
 
+    item = wmem_map_find(map, key);
+    if (!item) {
+        return FALSE;
+    }
+
+    if (orig_key) {
+        *orig_key = item->key;
+    }
+    if (value) {
+        *value = item->value;
+    }
+    return TRUE;
+}
+
+/* Removes the key from whichever table holds it, returning its value. */
+static gboolean
+wmem_map_take(wmem_map_t *map, const void *key, void **value)
+{
+    wmem_map_table_t *table;
+    guint64 hash;
+    gssize  i;
+
     /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (map->table.ctrl == NULL) {
         return FALSE;
     }
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
+    hash  = wmem_map_hash(map, key);
+    table = &map->table;
+    i     = table_find(map, table, hash, key);
+    if (i < 0 && map->old_table.ctrl != NULL) {
+        table = &map->old_table;
+        i     = table_find(map, table, hash, key);
+    }
 
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            if (orig_key) {
-                *orig_key = item->key;
-            }
-            if (value) {
-                *value = item->value;
-            }
-            return TRUE;
-        }
-        item = item->next;
+    if (i < 0) {
+        /* didn't find it */
+        return FALSE;
     }
 
-    return FALSE;
+    *value = table->slots[i].value;
+    table_erase(table, i);
+    map->count--;
+
+    if (table == &map->old_table && table->count == 0) {
+        table_free(map, table);
+    } else if (map->old_table.ctrl != NULL) {
+        wmem_map_migrate(map, MIGRATE_SLOTS);
+    }
+
+    return TRUE;
 }
 
 void *
 wmem_map_remove(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
     void *value;
 
-    /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (!wmem_map_take(map, key, &value)) {
         return NULL;
     }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            value   = tmp->value;
-            (*item) = tmp->next;
-            wmem_free(map->data_allocator, tmp);
-            map->count--;
-            return value;
-        }
-        item = &((*item)->next);
-    }
-
-    /* didn't find it */
-    return NULL;
+    return value;
 }
 
 gboolean
 wmem_map_steal(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
-
-    /* Make sure we have a table */
-    if (map->table == NULL) {
-        return FALSE;
-    }
-
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            (*item) = tmp->next;
-            map->count--;
-            return TRUE;
-        }
-        item = &((*item)->next);
-    }
+    void *value;
 
-    /* didn't find it */
-    return FALSE;
+    /* Items are stored inline in the table, so there is nothing to free and
+     * this is the same as removing the key. */
+    return wmem_map_take(map, key, &value);
 }
 
 wmem_list_t*
 wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 {
-    size_t capacity, i;
-    wmem_map_item_t *cur;
+    wmem_map_table_t *tables[2];
+    size_t capacity, i, t;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
-    if (map->table != NULL) {
-        capacity = CAPACITY(map);
-
-        /* copy all the elements into the list over from table */
-        for (i=0; i<capacity; i++) {
-            cur = map->table[i];
-            while (cur) {
-                wmem_list_prepend(list, (void*)cur->key);
-                cur = cur->next;
+    if (map->table.ctrl != NULL) {
+        tables[0] = &map->table;
+        tables[1] = &map->old_table;
+
+        /* copy all the elements into the list over from the tables */
+        for (t = 0; t < 2 && tables[t]->ctrl != NULL; t++) {
+            capacity = CAPACITY(tables[t]);
+            for (i=0; i<capacity; i++) {
+                if (CTRL_IS_FULL(tables[t]->ctrl[i])) {
+                    wmem_list_prepend(list, (void*)tables[t]->slots[i].key);
+                }
             }
         }
     }
@@ -391,19 +625,22 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
 void
 wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
 {
-    wmem_map_item_t *cur;
-    unsigned i;
+    wmem_map_table_t *tables[2];
+    size_t i, t;
 
     /* Make sure we have a table */
-    if (map->table == NULL) {
+    if (map->table.ctrl == NULL) {
         return;
     }
 
-    for (i = 0; i < CAPACITY(map); i++) {
-        cur = map->table[i];
-        while (cur) {
-            foreach_func((gpointer)cur->key, (gpointer)cur->value, user_data);
-            cur = cur->next;
+    tables[0] = &map->table;
+    tables[1] = &map->old_table;
+
+    for (t = 0; t < 2 && tables[t]->ctrl != NULL; t++) {
+        for (i = 0; i < CAPACITY(tables[t]); i++) {
+            if (CTRL_IS_FULL(tables[t]->ctrl[i])) {
+                foreach_func((gpointer)tables[t]->slots[i].key, (gpointer)tables[t]->slots[i].value, user_data);
+            }
         }
     }
 }
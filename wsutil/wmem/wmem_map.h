@@ -26,9 +26,10 @@ extern "C" {
  *
  *    A hash map implementation on top of wmem. Provides insertion, deletion and
  *    lookup in expected amortized constant time. Uses universal hashing to map
- *    keys into buckets, and provides a generic strong hash function that makes
- *    it secure against algorithmic complexity attacks, and suitable for use
- *    even with untrusted data.
+ *    keys into an open-addressed table which is resized incrementally, and
+ *    provides a generic strong hash function that makes it secure against
+ *    algorithmic complexity attacks, and suitable for use even with untrusted
+ *    data.
  *
  *    @{
  */
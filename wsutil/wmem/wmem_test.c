@@ -910,7 +910,7 @@ wmem_test_map(void)
     wmem_map_t       *map;
     gchar            *str_key;
     const void       *str_key_ret;
-    unsigned int      i;
+    unsigned int      i, count;
     unsigned int     *key_ret;
     unsigned int     *value_ret;
     void             *ret;
@@ -956,6 +956,34 @@ wmem_test_map(void)
     }
     wmem_free_all(allocator);
 
+    /* interleaved insertion and removal, so that items get moved between
+     * tables and removed from both while resizes are in progress */
+    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    g_assert_true(map);
+    memset(value_seen, 0, sizeof(value_seen));
+    for (i=0; i<CONTAINER_ITERS*4; i++) {
+        unsigned int k = g_random_int_range(0, CONTAINER_ITERS);
+
+        if (g_random_int_range(0, 3) == 0) {
+            ret = wmem_map_remove(map, GINT_TO_POINTER(k+1));
+            g_assert_true((ret != NULL) == value_seen[k]);
+            value_seen[k] = FALSE;
+        } else {
+            ret = wmem_map_insert(map, GINT_TO_POINTER(k+1), GINT_TO_POINTER(k+1));
+            g_assert_true((ret != NULL) == value_seen[k]);
+            value_seen[k] = TRUE;
+        }
+    }
+    count = 0;
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_map_contains(map, GINT_TO_POINTER(i+1)) == value_seen[i]);
+        if (value_seen[i]) {
+            count++;
+        }
+    }
+    g_assert_true(wmem_map_size(map) == count);
+    wmem_free_all(allocator);
+
     /* test auto-reset functionality */
     map = wmem_map_new_autoreset(allocator, extra_allocator, g_direct_hash, g_direct_equal);
     g_assert_true(map);
@@ -1011,6 +1039,93 @@ wmem_test_map(void)
     wmem_destroy_allocator(allocator);
 }
 
+/* NOTE: You have to run "wmem_test -m perf --verbose" to see results. */
+static void
+wmem_test_mapperf(void)
+{
+    static const guint sizes[] = { 1000, 1000 * 1000, 10 * 1000 * 1000 };
+    wmem_allocator_t   *allocator;
+    wmem_map_t         *map;
+    GHashTable         *hash_table;
+    guint               size, i, j;
+    guint               rep, reps;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+    double              insert_ms, lookup_ms, remove_ms;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+    for (j = 0; j < G_N_ELEMENTS(sizes); j++) {
+        size = sizes[j];
+        /* do about the same total amount of work at every size */
+        reps = sizes[G_N_ELEMENTS(sizes) - 1] / size;
+
+        insert_ms = lookup_ms = remove_ms = 0;
+        for (rep = 0; rep < reps; rep++) {
+            map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                wmem_map_insert(map, GUINT_TO_POINTER(i), GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            insert_ms += utime_ms + stime_ms;
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                g_assert_true(wmem_map_lookup(map, GUINT_TO_POINTER(i)) == GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            lookup_ms += utime_ms + stime_ms;
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                wmem_map_remove(map, GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            remove_ms += utime_ms + stime_ms;
+
+            wmem_free_all(allocator);
+        }
+        g_test_minimized_result(insert_ms + lookup_ms + remove_ms,
+            "wmem_map %u entries x %u: insert %.3f ms lookup %.3f ms remove %.3f ms",
+            size, reps, insert_ms, lookup_ms, remove_ms);
+
+        /* the same again with a GHashTable, for comparison */
+        insert_ms = lookup_ms = remove_ms = 0;
+        for (rep = 0; rep < reps; rep++) {
+            hash_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                g_hash_table_insert(hash_table, GUINT_TO_POINTER(i), GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            insert_ms += utime_ms + stime_ms;
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                g_assert_true(g_hash_table_lookup(hash_table, GUINT_TO_POINTER(i)) == GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            lookup_ms += utime_ms + stime_ms;
+
+            RESOURCE_USAGE_START;
+            for (i = 1; i <= size; i++) {
+                g_hash_table_remove(hash_table, GUINT_TO_POINTER(i));
+            }
+            RESOURCE_USAGE_END;
+            remove_ms += utime_ms + stime_ms;
+
+            g_hash_table_destroy(hash_table);
+        }
+        g_test_minimized_result(insert_ms + lookup_ms + remove_ms,
+            "GHashTable %u entries x %u: insert %.3f ms lookup %.3f ms remove %.3f ms",
+            size, reps, insert_ms, lookup_ms, remove_ms);
+    }
+
+    wmem_destroy_allocator(allocator);
+}
+
 static void
 wmem_test_queue(void)
 {
@@ -1458,6 +1573,9 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
     g_test_add_func("/wmem/datastruct/list",   wmem_test_list);
     g_test_add_func("/wmem/datastruct/map",    wmem_test_map);
+    if (g_test_perf ()) {
+        g_test_add_func("/wmem/datastruct/mapperf", wmem_test_mapperf);
+    }
     g_test_add_func("/wmem/datastruct/queue",  wmem_test_queue);
     g_test_add_func("/wmem/datastruct/stack",  wmem_test_stack);
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);